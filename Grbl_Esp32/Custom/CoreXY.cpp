@@ -142,8 +142,10 @@ bool user_defined_homing(uint8_t cycle_mask) {
                         approach ? target[axis] = max_travel : target[axis] = -max_travel;
                     }
 
+                    int32_t steps[MAX_N_AXIS];
+                    st_get_position(steps);
                     for (int axis = Z_AXIS; axis < n_axis; axis++) {
-                        target[axis] = sys_position[axis] / axis_settings[axis]->steps_per_mm->get();
+                        target[axis] = steps[axis] / axis_settings[axis]->steps_per_mm->get();
                     }
 
                     // convert back to motor steps
@@ -198,7 +200,7 @@ bool user_defined_homing(uint8_t cycle_mask) {
 #ifdef USE_I2S_STEPS
                     if (current_stepper == ST_I2S_STREAM) {
                         if (!approach) {
-                            delay_ms(I2S_OUT_DELAY_MS);
+                            delay_ms(i2s_out_delay_ms());
                         }
                     }
 #endif
@@ -233,8 +235,10 @@ bool user_defined_homing(uint8_t cycle_mask) {
     last_cartesian[X_AXIS] = target[X_AXIS];
     last_cartesian[Y_AXIS] = target[Y_AXIS];
 
+    int32_t steps[MAX_N_AXIS];
+    st_get_position(steps);
     for (int axis = Z_AXIS; axis < n_axis; axis++) {
-        last_cartesian[axis] = sys_position[axis] / axis_settings[axis]->steps_per_mm->get();
+        last_cartesian[axis] = steps[axis] / axis_settings[axis]->steps_per_mm->get();
     }
 
     // convert to motors
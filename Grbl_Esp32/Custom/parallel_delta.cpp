@@ -368,9 +368,11 @@ void kinematics_post_homing() {
 #ifdef USE_CUSTOM_HOMING
 
 #else
-    last_angle[X_AXIS] = sys_position[X_AXIS] / axis_settings[X_AXIS]->steps_per_mm->get();
-    last_angle[Y_AXIS] = sys_position[Y_AXIS] / axis_settings[Y_AXIS]->steps_per_mm->get();
-    last_angle[Z_AXIS] = sys_position[Z_AXIS] / axis_settings[Z_AXIS]->steps_per_mm->get();
+    int32_t steps[MAX_N_AXIS];
+    st_get_position(steps);
+    last_angle[X_AXIS] = steps[X_AXIS] / axis_settings[X_AXIS]->steps_per_mm->get();
+    last_angle[Y_AXIS] = steps[Y_AXIS] / axis_settings[Y_AXIS]->steps_per_mm->get();
+    last_angle[Z_AXIS] = steps[Z_AXIS] / axis_settings[Z_AXIS]->steps_per_mm->get();
 
     motors_to_cartesian(last_cartesian, last_angle, 3);
 
@@ -69,7 +69,9 @@ bool kinematics_pre_homing(uint8_t cycle_mask) {
 
 void kinematics_post_homing() {
     // sync the X axis (do not need sync but make it for the fail safe)
-    last_radius = sys_position[X_AXIS];
+    int32_t steps[MAX_N_AXIS];
+    st_get_position(steps);
+    last_radius = steps[X_AXIS];
     // reset the internal angle value
     last_angle = 0;
 }
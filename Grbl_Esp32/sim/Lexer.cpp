@@ -0,0 +1,200 @@
+/*
+  Lexer.cpp - number lexer check and benchmark for the simulator
+
+  Reads the value of every g-code word in the files with read_float(), and
+  with the implementation it replaced. Checks that both accept the same words
+  and stop at the same character, that read_float() rounds correctly, and
+  reports how many words each reads per second.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../src/Grbl.h"
+
+#include "Simulator.h"
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// read_float() as it was before the table-driven lexer, for comparison
+static uint8_t legacy_read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
+    const char*   ptr = line + *char_counter;
+    unsigned char c;
+    c               = *ptr++;
+    bool isnegative = false;
+    if (c == '-') {
+        isnegative = true;
+        c          = *ptr++;
+    } else if (c == '+') {
+        c = *ptr++;
+    }
+    uint32_t intval    = 0;
+    int8_t   exp       = 0;
+    uint8_t  ndigit    = 0;
+    bool     isdecimal = false;
+    while (1) {
+        c -= '0';
+        if (c <= 9) {
+            ndigit++;
+            if (ndigit <= 8) {
+                if (isdecimal) {
+                    exp--;
+                }
+                intval = intval * 10 + c;
+            } else {
+                if (!(isdecimal)) {
+                    exp++;
+                }
+            }
+        } else if (c == (('.' - '0') & 0xff) && !(isdecimal)) {
+            isdecimal = true;
+        } else {
+            break;
+        }
+        c = *ptr++;
+    }
+    if (!ndigit) {
+        return false;
+    }
+    float fval;
+    fval = (float)intval;
+    if (fval != 0) {
+        while (exp <= -2) {
+            fval *= 0.01;
+            exp += 2;
+        }
+        if (exp < 0) {
+            fval *= 0.1;
+        } else if (exp > 0) {
+            do {
+                fval *= 10.0;
+            } while (--exp > 0);
+        }
+    }
+    if (isnegative) {
+        *float_ptr = -fval;
+    } else {
+        *float_ptr = fval;
+    }
+    *char_counter = ptr - line - 1;
+    return true;
+}
+
+// Digits of a number from its first nonzero digit on
+static size_t sim_significant_digits(const std::string& word) {
+    size_t first = word.find_first_of("123456789");
+    if (first == std::string::npos) {
+        return 0;
+    }
+    size_t digits = 0;
+    for (size_t i = first; i < word.size(); i++) {
+        digits += isdigit(word[i]) != 0;
+    }
+    return digits;
+}
+
+typedef uint8_t (*sim_lexer_t)(const char* line, uint8_t* char_counter, float* float_ptr);
+
+// Reads every word of the lines the way gc_execute_line() does, and returns a sum of
+// the values so that the work cannot be optimized away.
+static float sim_lex(const std::vector<std::string>& lines, sim_lexer_t lexer, uint32_t* words) {
+    float sum = 0;
+    for (auto& line : lines) {
+        const char* text         = line.c_str();
+        uint8_t     char_counter = 0;
+        float       value;
+        while (text[char_counter] != '\0') {
+            char_counter++;  // The word letter
+            if (lexer(text, &char_counter, &value)) {
+                sum += value;
+                (*words)++;
+            }
+        }
+    }
+    return sum;
+}
+
+bool sim_lexer_benchmark(const std::vector<const char*>& files, int repeat) {
+    std::vector<std::string> lines;
+    for (auto path : files) {
+        FILE* file = fopen(path, "r");
+        if (!file) {
+            perror(path);
+            return false;
+        }
+        char line[LINE_BUFFER_SIZE + 2];
+        while (fgets(line, sizeof(line), file)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] == '$' || line[0] == '[') {
+                continue;  // Not g-code
+            }
+            collapseGCode(line);
+            lines.push_back(line);
+        }
+        fclose(file);
+    }
+
+    // The lexers must agree on the syntax of every word, and read_float() must round the
+    // words it reads exactly. The previous implementation did not always, so its values are
+    // only counted where they differ.
+    uint32_t words = 0, changed = 0, errors = 0;
+    for (auto& line : lines) {
+        const char* text = line.c_str();
+        for (uint8_t start = 1; start < line.size(); start++) {
+            uint8_t legacy_counter = start, counter = start;
+            float   legacy_value = 0, value = 0;
+            uint8_t legacy_ok = legacy_read_float(text, &legacy_counter, &legacy_value);
+            uint8_t ok        = read_float(text, &counter, &value);
+            if (ok != legacy_ok || counter != legacy_counter) {
+                if (errors++ < 10) {
+                    fprintf(stderr, "syntax differs: %s at %u\n", text, start);
+                }
+                continue;
+            }
+            if (!ok) {
+                continue;
+            }
+            words++;
+            changed += memcmp(&value, &legacy_value, sizeof(float)) != 0;
+            std::string word(text + start, counter - start);
+            if (sim_significant_digits(word) <= 8 && strtof(word.c_str(), NULL) != value) {
+                if (errors++ < 10) {
+                    fprintf(stderr, "not rounded exactly: %s gives %.9g\n", word.c_str(), value);
+                }
+            }
+        }
+    }
+
+    auto time = [&](sim_lexer_t lexer, uint32_t* lexed) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; i++) {
+            volatile float sum = sim_lex(lines, lexer, lexed);
+            (void)sum;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+    uint32_t legacy_words = 0, new_words = 0;
+    double   legacy_seconds = time(legacy_read_float, &legacy_words);
+    double   new_seconds    = time(read_float, &new_words);
+
+    fprintf(stderr, "lines        %10zu\n", lines.size());
+    fprintf(stderr, "numbers      %10u\n", words);
+    fprintf(stderr, "changed      %10u\n", changed);
+    fprintf(stderr, "errors       %10u\n", errors);
+    fprintf(stderr, "legacy       %10.3f s  %12.0f words/sec\n", legacy_seconds, legacy_words / legacy_seconds);
+    fprintf(stderr, "read_float   %10.3f s  %12.0f words/sec\n", new_seconds, new_words / new_seconds);
+    return errors == 0;
+}
@@ -0,0 +1,372 @@
+/*
+  Simulator.cpp - host simulation of the Grbl_ESP32 motion pipeline
+
+  Replays g-code files through the real parser, motion control, planner and
+  stepper segment generator, and reports how fast the host got through them
+  and how long the machine would have taken.
+
+  The stepper ISR is not driven by a timer. Each time the main loop tops up
+  the segment buffer, the ISR is called until it has moved on to the next
+  segment, and simulated time advances by the timer period the ISR would
+  have waited between steps. The run is therefore deterministic, and the
+  segment buffer never runs dry while the planner still has blocks.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../src/Grbl.h"
+
+#include "Simulator.h"
+
+#include <chrono>
+#include <vector>
+
+bool         sim_quiet = false;
+sim_motors_t sim_motors;
+timg_dev_t   TIMERG0;
+sim_timer_t  sim_step_timer;
+sim_timer_t  sim_pulse_timer;
+uint32_t     sim_segments;
+
+static uint64_t sim_ticks;  // Simulated machine time, in step timer ticks
+static FILE*    sim_trace;  // Optional step event log
+
+// Host time spent in the stepper ISR and in the planner, out of the host time of the run
+static double sim_stepper_seconds;
+static double sim_planner_seconds;
+
+static double sim_seconds_since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// ============================== Time ==============================
+
+// Each read moves the clock on by at least a microsecond, so the busy-waits
+// for step pulse and direction timing in the stepper ISR end without
+// adding to machine time.
+int64_t esp_timer_get_time() {
+    static int64_t now;
+    now = std::max(now + 1, int64_t(sim_ticks / ticksPerMicrosecond));
+    return now;
+}
+unsigned long millis() {
+    return esp_timer_get_time() / 1000;
+}
+unsigned long micros() {
+    return esp_timer_get_time();
+}
+// Dwells and spindle delays cost machine time, not host time
+void delay(uint32_t ms) {
+    sim_ticks += uint64_t(ms) * 1000 * ticksPerMicrosecond;
+}
+void delayMicroseconds(uint32_t us) {
+    sim_ticks += uint64_t(us) * ticksPerMicrosecond;
+}
+TickType_t xTaskGetTickCount() {
+    return millis();
+}
+
+// ============================= Motors =============================
+
+void init_motors() {}
+void motors_read_settings() {}
+void motors_set_disable(bool disable, uint8_t mask) {}
+
+uint8_t motors_set_homing_mode(uint8_t homing_mask, bool isHoming) {
+    return homing_mask;
+}
+
+bool motors_direction(uint8_t dir_mask) {
+    if (dir_mask == sim_motors.dir_mask) {
+        return false;
+    }
+    sim_motors.dir_mask = dir_mask;
+    return true;
+}
+
+void motors_step(uint8_t step_mask) {
+    if (step_mask == 0) {
+        return;
+    }
+    sim_motors.step_events++;
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        if (bitnum_istrue(step_mask, axis)) {
+            sim_motors.steps[axis]++;
+        }
+    }
+    if (sim_trace) {
+        fprintf(sim_trace, "%llu,%u,%u\n", (unsigned long long)sim_ticks, step_mask, sim_motors.dir_mask);
+    }
+}
+
+void motors_unstep() {}
+
+#ifdef ENABLE_STEPPER_ISR_STATS
+void motors_set_gpio_batching(bool batch) {}
+#endif
+
+// The train is logged all at once, with the times its steps will have
+bool motors_step_train(uint8_t step_mask, uint32_t first_delay, uint32_t interval, uint16_t count) {
+    if (count > MAX_STEP_TRAIN_STEPS) {
+        return false;
+    }
+    sim_motors.step_events += count;
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        if (bitnum_istrue(step_mask, axis)) {
+            sim_motors.steps[axis] += count;
+        }
+    }
+    if (sim_trace) {
+        for (int i = 0; i < count; i++) {
+            fprintf(sim_trace,
+                    "%llu,%u,%u\n",
+                    (unsigned long long)(sim_ticks + first_delay + uint64_t(i) * interval),
+                    step_mask,
+                    sim_motors.dir_mask);
+        }
+    }
+    return true;
+}
+
+// ========================= Stepper timer ==========================
+
+void onStepperDriverTimer(void* para);  // Stepper.cpp
+
+// The link step wraps st_prep_buffer() (-Wl,--wrap=_Z14st_prep_bufferv), so
+// every caller in the main loop also runs the ISR for one segment. The step
+// pulse timer runs out straight after each ISR call; pulses take no machine
+// time of their own since they fit inside the step period. With the step
+// queue, stepQueueTask is not running, so the wrapper expands the segments.
+extern "C" void __real__Z14st_prep_bufferv();
+extern "C" void __wrap__Z14st_prep_bufferv() {
+    __real__Z14st_prep_bufferv();
+    uint32_t segment = sim_segments;
+    auto     start   = std::chrono::steady_clock::now();
+    while (sim_step_timer.running && sim_segments == segment) {
+#ifdef USE_STEP_QUEUE
+        st_queue_expand();
+#endif
+        onStepperDriverTimer(NULL);
+        while (sim_pulse_timer.running) {
+            onStepperOffTimer(NULL);
+        }
+        sim_ticks += sim_step_timer.alarm_ticks;
+        sim_motors.isr_ticks++;
+    }
+    sim_stepper_seconds += sim_seconds_since(start);
+}
+
+// The link step also wraps plan_buffer_line() (-Wl,--wrap=_Z16plan_buffer_linePfP16plan_line_data_t)
+// to time the planner, including the replanning of the blocks ahead.
+extern "C" uint8_t __real__Z16plan_buffer_linePfP16plan_line_data_t(float* target, plan_line_data_t* pl_data);
+extern "C" uint8_t __wrap__Z16plan_buffer_linePfP16plan_line_data_t(float* target, plan_line_data_t* pl_data) {
+    auto    start  = std::chrono::steady_clock::now();
+    uint8_t result = __real__Z16plan_buffer_linePfP16plan_line_data_t(target, pl_data);
+    sim_planner_seconds += sim_seconds_since(start);
+    return result;
+}
+
+// ============================= Replay =============================
+
+static uint32_t sim_lines;
+static uint32_t sim_errors;
+
+static void sim_init() {
+    settings_init();
+    plan_init();
+    stepper_init();
+    init_motors();
+    memset(sys_position, 0, sizeof(sys_position));
+    Spindles::Spindle::select();
+
+    // As reset_variables() in Grbl.cpp, less the hardware
+    memset(&sys, 0, sizeof(system_t));
+    sys.state             = State::Idle;
+    sys.f_override        = FeedOverride::Default;
+    sys.r_override        = RapidOverride::Default;
+    sys.spindle_speed_ovr = SpindleSpeedOverride::Default;
+    sys_rt_f_override     = FeedOverride::Default;
+    sys_rt_r_override     = RapidOverride::Default;
+    sys_rt_s_override     = SpindleSpeedOverride::Default;
+    gc_init();
+    coolant_init();
+    probe_init();
+    plan_reset();
+    st_reset();
+    plan_sync_position();
+    gc_sync_position();
+}
+
+// One line, the way protocol_main_loop() runs a line read from the SD card
+static void sim_execute_line(char* line, const char* source, uint32_t line_number) {
+    Error status = execute_line(line, CLIENT_SERIAL, WebUI::AuthenticationLevel::LEVEL_ADMIN);
+    if (status != Error::Ok) {
+        sim_errors++;
+        fprintf(stderr, "%s:%u: error:%d %s\n", source, line_number, static_cast<int>(status), line);
+    }
+    mc_continue_curve();
+    mc_flush_stale_held_line();
+    protocol_auto_cycle_start();
+    protocol_execute_realtime();
+}
+
+static bool sim_replay(const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        perror(path);
+        return false;
+    }
+    char     line[LINE_BUFFER_SIZE + 2];
+    uint32_t line_number = 0;
+    while (fgets(line, sizeof(line), file) && !sys.abort) {
+        line_number++;
+        size_t len = strcspn(line, "\r\n");
+        if (line[len] == '\0' && !feof(file)) {
+            fprintf(stderr, "%s:%u: line too long\n", path, line_number);
+            sim_errors++;
+            int c;
+            while ((c = fgetc(file)) != '\n' && c != EOF) {}
+            continue;
+        }
+        line[len] = '\0';
+        sim_execute_line(line, path, line_number);
+        sim_lines++;
+    }
+    fclose(file);
+    return true;
+}
+
+static void sim_report(double host_seconds) {
+    double machine_seconds = double(sim_ticks) / fStepperTimer;
+    auto   rate            = [host_seconds](double count) { return host_seconds > 0 ? count / host_seconds : 0.0; };
+
+    fprintf(stderr, "lines        %10u  %12.0f/sec\n", sim_lines, rate(sim_lines));
+    fprintf(stderr, "blocks       %10u  %12.0f/sec\n", mc_blocks_out, rate(mc_blocks_out));
+    fprintf(stderr, "segments     %10u  %12.0f/sec\n", sim_segments, rate(sim_segments));
+    fprintf(stderr,
+            "step events  %10llu  %12.0f/sec\n",
+            (unsigned long long)sim_motors.step_events,
+            rate(double(sim_motors.step_events)));
+    fprintf(stderr, "isr ticks    %10llu  %12.0f/sec\n", (unsigned long long)sim_motors.isr_ticks, rate(double(sim_motors.isr_ticks)));
+    fprintf(stderr, "steps       ");
+    for (int axis = 0; axis < motion_config->n_axis; axis++) {
+        fprintf(stderr, " %c:%llu", axis_settings[axis]->name[0], (unsigned long long)sim_motors.steps[axis]);
+    }
+    int32_t position[MAX_N_AXIS];
+    st_get_position(position);
+    fprintf(stderr, "\nposition    ");
+    for (int axis = 0; axis < motion_config->n_axis; axis++) {
+        fprintf(stderr, " %c:%ld", axis_settings[axis]->name[0], long(position[axis]));
+    }
+    fprintf(stderr, "\nerrors       %10u\n", sim_errors);
+    fprintf(stderr, "host time    %10.3f s\n", host_seconds);
+    fprintf(stderr, "  stepper    %10.3f s", sim_stepper_seconds);
+    // Host time of the stepper ISRs per step event, and the step rate that time would sustain
+    if (sim_motors.step_events && sim_stepper_seconds > 0) {
+        fprintf(stderr,
+                "  %8.1f ns/step  %12.0f steps/sec",
+                sim_stepper_seconds * 1e9 / sim_motors.step_events,
+                sim_motors.step_events / sim_stepper_seconds);
+    }
+    fprintf(stderr, "\n");
+    fprintf(stderr, "  planner    %10.3f s\n", sim_planner_seconds);
+    fprintf(stderr, "machine time %10.3f s\n", machine_seconds);
+}
+
+static void sim_usage(const char* name) {
+    fprintf(stderr,
+            "usage: %s [-q] [-s stepper] [-t trace.csv] [-c '$setting=value']... [-l passes] file.nc...\n"
+            "  -q  suppress Grbl's own messages\n"
+            "  -s  stepper type: 0 timed (default), 1 RMT, 3 I2S static\n"
+            "  -t  log every step event as ticks,step_mask,dir_mask (%u ticks/sec)\n"
+            "  -c  run a command or g-code line before the files; may be repeated\n"
+            "  -l  check and time the number lexer on the words of the files instead of running them\n",
+            name,
+            fStepperTimer);
+}
+
+int main(int argc, char** argv) {
+    std::vector<const char*> commands;
+    std::vector<const char*> files;
+    int                      lexer_passes = 0;
+    int                      stepper      = ST_TIMED;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-q")) {
+            sim_quiet = true;
+        } else if (!strcmp(argv[i], "-s") && i + 1 < argc) {
+            stepper = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-t") && i + 1 < argc) {
+            sim_trace = fopen(argv[++i], "w");
+            if (!sim_trace) {
+                perror(argv[i]);
+                return 1;
+            }
+        } else if (!strcmp(argv[i], "-c") && i + 1 < argc) {
+            commands.push_back(argv[++i]);
+        } else if (!strcmp(argv[i], "-l") && i + 1 < argc) {
+            lexer_passes = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            sim_usage(argv[0]);
+            return 1;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+    if (files.empty()) {
+        sim_usage(argv[0]);
+        return 1;
+    }
+
+    sim_quiet = sim_quiet || lexer_passes;
+    sim_init();
+    // The I2S stream calls the step ISR from the I2S task, which the simulator does not have
+    if (stepper < ST_TIMED || stepper > ST_I2S_STATIC || stepper == ST_I2S_STREAM) {
+        sim_usage(argv[0]);
+        return 1;
+    }
+    current_stepper = stepper_id_t(stepper);
+    if (lexer_passes) {
+        return sim_lexer_benchmark(files, lexer_passes) ? 0 : 2;
+    }
+    for (auto command : commands) {
+        char line[LINE_BUFFER_SIZE];
+        snprintf(line, sizeof(line), "%s", command);
+        sim_execute_line(line, "-c", 0);
+    }
+    protocol_buffer_synchronize();
+
+    // Counters restart so that setup commands do not count toward the replay
+    sim_lines = sim_errors = 0;
+    mc_lines_in = mc_blocks_out = 0;
+    sim_segments = 0;
+    sim_motors   = {};
+    sim_ticks    = 0;
+    sim_stepper_seconds = sim_planner_seconds = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto file : files) {
+        if (!sim_replay(file)) {
+            return 1;
+        }
+    }
+    protocol_buffer_synchronize();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (sim_trace) {
+        fclose(sim_trace);
+    }
+    sim_report(elapsed.count());
+    return sim_errors ? 2 : 0;
+}
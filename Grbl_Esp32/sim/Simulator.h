@@ -0,0 +1,40 @@
+#pragma once
+
+/*
+  Simulator.h - host simulation of the Grbl_ESP32 motion pipeline
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <cstdint>
+#include <vector>
+
+// Suppresses Grbl's own report output, leaving only the simulator summary
+extern bool sim_quiet;
+
+// Step events recorded by the simulated motor backend
+struct sim_motors_t {
+    uint64_t steps[6];     // Per axis, regardless of direction
+    uint64_t step_events;  // ISR ticks that stepped at least one axis
+    uint64_t isr_ticks;    // Every stepper ISR invocation
+    uint8_t  dir_mask;
+};
+extern sim_motors_t sim_motors;
+
+// Step segments loaded by the stepper ISR
+extern uint32_t sim_segments;
+
+// Checks read_float() against the implementation it replaced on every word of the files,
+// and times both over the given number of passes. Returns false on any difference.
+bool sim_lexer_benchmark(const std::vector<const char*>& files, int repeat);
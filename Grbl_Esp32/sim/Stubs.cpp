@@ -0,0 +1,198 @@
+/*
+  Stubs.cpp - link-time stand-ins for the parts of Grbl_ESP32 that the simulator does not build
+
+  The simulator compiles the g-code parser, motion control, planner, stepper
+  segment generator and the settings/protocol code around them. Everything
+  that talks to hardware or the network is replaced here by the simplest
+  behavior that keeps that code path working on a host.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../src/Grbl.h"
+#include "../src/Spindles/NullSpindle.h"
+
+#include "Simulator.h"
+
+HardwareSerial Serial(0);
+EspClass       ESP;
+
+// ============================== Pins ==============================
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+void digitalWrite(uint8_t pin, uint8_t val) {}
+int  digitalRead(uint8_t pin) {
+    return LOW;
+}
+
+String pinName(uint8_t pin) {
+    if (pin == UNDEFINED_PIN) {
+        return "None";
+    }
+    return String("GPIO(") + String(pin) + ")";
+}
+
+uint32_t i2s_out_push_sample(uint32_t usec) {
+    return 0;
+}
+
+// ============================= Clients =============================
+
+// Everything Grbl reports goes to stdout. There is no input side; lines
+// are fed to execute_line() by the simulator itself.
+void client_write(uint8_t client, const char* text) {
+    if (!sim_quiet) {
+        fputs(text, stdout);
+    }
+}
+
+int client_read(uint8_t client) {
+    return -1;
+}
+
+char* client_peek_line(uint8_t client, size_t* size, size_t max_size) {
+    *size = 0;
+    return NULL;
+}
+
+void client_release_line(uint8_t client, size_t size) {}
+
+void client_reset_read_buffer(uint8_t client) {}
+
+#ifdef ENABLE_BINARY_STREAM
+uint8_t client_binary() {
+    return CLIENT_ALL;
+}
+
+binary_frame_t* client_peek_frame() {
+    return NULL;
+}
+
+void client_release_frame() {}
+
+void client_end_binary() {}
+#endif
+
+// As Serial.cpp with an empty UART, whose 128 byte FIFO the firmware reports. RX_BUFFER_SIZE
+// does not fit the uint8_t.
+uint8_t client_get_rx_buffer_available(uint8_t client) {
+    return 128;
+}
+
+// ============================= Spindle =============================
+
+namespace Spindles {
+    // The Null spindle, with laser mode honored so that laser jobs plan
+    // the way they would on a machine with a laser configured.
+    class Sim : public Null {
+    public:
+        bool inLaserMode() override { return laser_mode->get(); }
+
+        // The stepper ISR sets the speed as it loads each segment. The call that turns a
+        // laser off after the last segment comes once the step timer has stopped.
+        uint32_t set_rpm(uint32_t rpm) override {
+            if (sim_step_timer.running) {
+                sim_segments++;
+            }
+            return Null::set_rpm(rpm);
+        }
+    };
+    static Sim sim;
+
+    void Spindle::select() {
+        spindle = &sim;
+        spindle->init();
+    }
+
+    bool Spindle::inLaserMode() {
+        return false;
+    }
+
+    void Spindle::sync(SpindleState state, uint32_t rpm) {
+        if (sys.state == State::CheckMode) {
+            return;
+        }
+        protocol_buffer_synchronize();  // Empty planner buffer to ensure spindle is set when programmed.
+        set_state(state, rpm);
+    }
+
+    void Spindle::deinit() { stop(); }
+}
+
+Spindles::Spindle* spindle;
+
+// ========================== Weak hooks ============================
+
+// Defaults from Grbl.cpp, which the simulator does not build
+void user_m30() {}
+void user_tool_change(uint8_t new_tool) {}
+
+// ============================= SD card =============================
+
+bool                       SD_ready_next = false;
+uint8_t                    SD_client     = CLIENT_SERIAL;
+WebUI::AuthenticationLevel SD_auth_level = WebUI::AuthenticationLevel::LEVEL_GUEST;
+bool                       SD_compiled   = false;
+
+SDState get_sd_state(bool refresh) {
+    return SDState::NotPresent;
+}
+boolean closeFile() {
+    return true;
+}
+boolean readFileLine(char* line, int len) {
+    return false;
+}
+void sd_read_ahead() {}
+boolean readCompiledRecord(char* line, int maxlen, gc_compiled_motion_t* compiled) {
+    return false;
+}
+float sd_report_perc_complete() {
+    return 0.0;
+}
+uint32_t sd_get_current_line_number() {
+    return 0;
+}
+void sd_get_current_filename(char* name) {
+    *name = '\0';
+}
+
+// ============================== WebUI ==============================
+
+namespace WebUI {
+    BluetoothSerial      SerialBT;
+    NotificationsService notificationsservice;
+    Telnet_Server        telnet_server;
+
+    void make_web_settings() {}
+
+    ESPResponseStream::ESPResponseStream(uint8_t client, bool byid) : _client(client), _header_sent(false) {}
+
+    bool COMMANDS::isLocalPasswordValid(char* password) { return true; }
+
+    const char* BTConfig::info() { return "Bluetooth not available"; }
+    void        BTConfig::reset_settings() {}
+
+    const char* WiFiConfig::info() { return "WiFi not available"; }
+    bool        WiFiConfig::isPasswordValid(const char* password) { return true; }
+    void        WiFiConfig::reset_settings() {}
+
+    NotificationsService::NotificationsService() {}
+    NotificationsService::~NotificationsService() {}
+    bool NotificationsService::sendMSG(const char* title, const char* message) { return true; }
+
+    Telnet_Server::Telnet_Server() {}
+    Telnet_Server::~Telnet_Server() {}
+    int Telnet_Server::get_rx_buffer_available() { return 0; }
+}
@@ -0,0 +1,244 @@
+#pragma once
+
+/*
+  Arduino.h - host stand-in for the ESP32 Arduino core, used by the simulator build
+
+  Only what the motion pipeline and its headers touch is provided. Hardware
+  calls are no-ops; time comes from the simulated step clock in Simulator.cpp.
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "Print.h"
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define NOP() asm volatile("nop")
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x01
+#define OUTPUT 0x02
+#define INPUT_PULLUP 0x05
+#define INPUT_PULLDOWN 0x09
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+#define PI 3.1415926535897932384626433832795
+
+#define B0 0
+#define B1 1
+#define B11 3
+#define B111 7
+#define B1111 15
+#define B11111 31
+#define B111111 63
+#define B00001111 15
+#define B11111111 255
+
+#define bit(b) (1UL << (b))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_DMA (1 << 3)
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+#define log_e(...)
+#define log_w(...)
+#define log_i(...)
+#define log_d(...)
+#define log_v(...)
+
+typedef int      esp_err_t;
+typedef uint8_t  byte;
+typedef bool     boolean;
+typedef int      gpio_num_t;
+
+using std::max;
+using std::min;
+
+inline long map(long x, long in_min, long in_max, long out_min, long out_max) {
+    return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
+}
+
+// Simulated time, advanced by the step timer in Simulator.cpp
+int64_t       esp_timer_get_time();
+unsigned long millis();
+unsigned long micros();
+void          delay(uint32_t ms);
+void          delayMicroseconds(uint32_t us);
+
+// GPIO is inert; reads return the idle level
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int  digitalRead(uint8_t pin);
+inline int  analogRead(uint8_t pin) { return 0; }
+inline void attachInterrupt(uint8_t pin, void (*handler)(), int mode) {}
+inline void detachInterrupt(uint8_t pin) {}
+inline int  digitalPinToInterrupt(int pin) { return pin; }
+inline void ledcSetup(uint8_t chan, double freq, uint8_t bits) {}
+inline void ledcAttachPin(uint8_t pin, uint8_t chan) {}
+inline void ledcDetachPin(uint8_t pin) {}
+inline void ledcWrite(uint8_t chan, uint32_t duty) {}
+inline void dacWrite(uint8_t pin, uint8_t value) {}
+inline void gpio_set_level(gpio_num_t pin, uint32_t level) {}
+inline void pinMatrixOutAttach(uint8_t pin, uint8_t function, bool invertOut, bool invertEnable) {}
+
+inline void*  heap_caps_malloc(size_t size, uint32_t caps) { return malloc(size); }
+inline void*  heap_caps_calloc(size_t n, size_t size, uint32_t caps) { return calloc(n, size); }
+inline void   heap_caps_free(void* ptr) { free(ptr); }
+inline size_t heap_caps_get_free_size(uint32_t caps) { return 0; }
+inline bool   psramFound() { return false; }
+inline void*  ps_malloc(size_t size) { return malloc(size); }
+
+inline uint32_t getApbFrequency() { return 80000000; }
+inline uint32_t xthal_get_ccount() { return (uint32_t)(esp_timer_get_time() * 240); }
+
+class String {
+    std::string _s;
+
+public:
+    String(const char* s = "") : _s(s ? s : "") {}
+    String(const std::string& s) : _s(s) {}
+    explicit String(char c) : _s(1, c) {}
+    explicit String(int v, unsigned char base = 10) : _s(std::to_string(v)) {}
+    explicit String(unsigned int v, unsigned char base = 10) : _s(std::to_string(v)) {}
+    explicit String(long v, unsigned char base = 10) : _s(std::to_string(v)) {}
+    explicit String(unsigned long v, unsigned char base = 10) : _s(std::to_string(v)) {}
+    explicit String(float v, unsigned char decimals = 2) : String((double)v, decimals) {}
+    explicit String(double v, unsigned char decimals = 2) {
+        char buf[40];
+        snprintf(buf, sizeof(buf), "%.*f", decimals, v);
+        _s = buf;
+    }
+
+    String& operator+=(const String& s) {
+        _s += s._s;
+        return *this;
+    }
+    String& operator+=(const char* s) {
+        _s += s;
+        return *this;
+    }
+    String& operator+=(char c) {
+        _s += c;
+        return *this;
+    }
+    bool concat(const String& s) {
+        _s += s._s;
+        return true;
+    }
+    String& operator+=(int v) { return *this += String(v); }
+    String& operator+=(unsigned int v) { return *this += String(v); }
+    String& operator+=(long v) { return *this += String(v); }
+    String& operator+=(unsigned long v) { return *this += String(v); }
+    String& operator+=(float v) { return *this += String(v); }
+
+    friend String operator+(const String& a, const String& b) { return String(a._s + b._s); }
+    friend String operator+(const String& a, const char* b) { return String(a._s + b); }
+    friend String operator+(const char* a, const String& b) { return String(a + b._s); }
+
+    bool operator==(const String& s) const { return _s == s._s; }
+    bool operator==(const char* s) const { return _s == s; }
+    bool operator!=(const String& s) const { return _s != s._s; }
+    bool operator!=(const char* s) const { return _s != s; }
+    char operator[](unsigned int i) const { return i < _s.length() ? _s[i] : 0; }
+
+    const char*  c_str() const { return _s.c_str(); }
+    unsigned int length() const { return _s.length(); }
+    bool         isEmpty() const { return _s.empty(); }
+    char         charAt(unsigned int i) const { return (*this)[i]; }
+    int          indexOf(char c, unsigned int from = 0) const {
+        auto pos = _s.find(c, from);
+        return pos == std::string::npos ? -1 : int(pos);
+    }
+    String substring(unsigned int from, unsigned int to = ~0u) const {
+        if (from > _s.length()) {
+            return String();
+        }
+        return String(_s.substr(from, to == ~0u ? std::string::npos : to - from));
+    }
+    void toUpperCase() { std::transform(_s.begin(), _s.end(), _s.begin(), ::toupper); }
+    void toLowerCase() { std::transform(_s.begin(), _s.end(), _s.begin(), ::tolower); }
+    long toInt() const { return atol(_s.c_str()); }
+    bool equals(const String& s) const { return _s == s._s; }
+    bool startsWith(const String& s) const { return _s.compare(0, s._s.length(), s._s) == 0; }
+    bool reserve(unsigned int size) {
+        _s.reserve(size);
+        return true;
+    }
+    void replace(char find, char replace) { std::replace(_s.begin(), _s.end(), find, replace); }
+    void toCharArray(char* buf, unsigned int size, unsigned int index = 0) const {
+        if (size) {
+            strncpy(buf, index < _s.length() ? _s.c_str() + index : "", size - 1);
+            buf[size - 1] = '\0';
+        }
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read()      = 0;
+    virtual int peek()      = 0;
+    virtual size_t readBytes(char* buffer, size_t length) {
+        size_t n = 0;
+        for (int c; n < length && (c = read()) >= 0; n++) {
+            buffer[n] = c;
+        }
+        return n;
+    }
+};
+
+// Host console; output goes to stdout
+class HardwareSerial : public Stream {
+public:
+    HardwareSerial(int uart_nr) {}
+    void   begin(unsigned long baud, uint32_t config = 0, int8_t rxPin = -1, int8_t txPin = -1) {}
+    int    available() override { return 0; }
+    int    read() override { return -1; }
+    int    peek() override { return -1; }
+    size_t write(uint8_t c) override { return fputc(c, stdout) == EOF ? 0 : 1; }
+    using Print::write;
+};
+extern HardwareSerial Serial;
+
+class EspClass {
+public:
+    const char* getSdkVersion() { return "host"; }
+    uint32_t    getFreeHeap() { return 0; }
+    uint32_t    getCpuFreqMHz() { return 240; }
+    uint32_t    getFlashChipSize() { return 0; }
+    uint64_t    getEfuseMac() { return 0; }
+    void        restart() { exit(0); }
+};
+extern EspClass ESP;
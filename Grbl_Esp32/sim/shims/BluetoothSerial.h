@@ -0,0 +1,17 @@
+#pragma once
+
+/*
+  BluetoothSerial.h - host stand-in for the ESP32 Bluetooth serial library, used by the simulator build
+*/
+
+#include "Arduino.h"
+
+class BluetoothSerial : public Stream {
+public:
+    int    available() override { return 0; }
+    int    read() override { return -1; }
+    int    peek() override { return -1; }
+    size_t write(uint8_t c) override { return 1; }
+    using Print::write;
+    bool hasClient() { return false; }
+};
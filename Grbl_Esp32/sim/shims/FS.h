@@ -0,0 +1,12 @@
+#pragma once
+
+/*
+  FS.h - host stand-in for the Arduino filesystem API, used by the simulator build
+
+  Grbl's SD card code is not part of the simulator; the types only need to exist.
+*/
+
+namespace fs {
+    class File {};
+    class FS {};
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+/*
+  Print.h - host stand-in for the Arduino Print class, used by the simulator build
+*/
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+class Print {
+public:
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            n += write(*buffer++);
+        }
+        return n;
+    }
+    size_t write(const char* str) { return str ? write((const uint8_t*)str, strlen(str)) : 0; }
+    size_t print(const char* str) { return write(str); }
+    size_t println(const char* str = "") { return write(str) + write("\r\n"); }
+    size_t printf(const char* format, ...) {
+        char    buf[256];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return write(buf);
+    }
+    virtual void flush() {}
+    virtual ~Print() {}
+};
@@ -0,0 +1,4 @@
+#pragma once
+
+// Simulator build: the SD card code is not part of the simulator
+#include "FS.h"
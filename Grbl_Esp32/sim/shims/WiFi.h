@@ -0,0 +1,33 @@
+#pragma once
+
+/*
+  WiFi.h - host stand-in for the ESP32 WiFi library, used by the simulator build
+
+  Only the types that Grbl headers and IPaddrSetting use are provided.
+*/
+
+#include "Arduino.h"
+
+typedef int WiFiEvent_t;
+
+class IPAddress {
+    uint32_t _address = 0;
+
+public:
+    IPAddress() = default;
+    IPAddress(uint32_t address) : _address(address) {}
+    operator uint32_t() const { return _address; }
+    bool fromString(const char* address) {
+        unsigned a, b, c, d;
+        if (sscanf(address, "%u.%u.%u.%u", &a, &b, &c, &d) != 4 || a > 255 || b > 255 || c > 255 || d > 255) {
+            return false;
+        }
+        _address = a | (b << 8) | (c << 16) | (d << 24);
+        return true;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _address & 0xff, (_address >> 8) & 0xff, (_address >> 16) & 0xff, _address >> 24);
+        return String(buf);
+    }
+};
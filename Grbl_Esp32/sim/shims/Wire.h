@@ -0,0 +1,3 @@
+#pragma once
+
+// Simulator build: nothing from this library is used on the host
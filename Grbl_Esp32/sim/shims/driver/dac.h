@@ -0,0 +1,5 @@
+#pragma once
+
+/*
+  dac.h - host stand-in for the ESP-IDF DAC driver, used by the simulator build
+*/
@@ -0,0 +1,46 @@
+#pragma once
+
+/*
+  rmt.h - host stand-in for the ESP-IDF RMT driver, used by the simulator build
+*/
+
+#include <cstdint>
+
+typedef enum { RMT_CHANNEL_0 = 0, RMT_CHANNEL_MAX = 8 } rmt_channel_t;
+typedef enum { RMT_MODE_TX = 0, RMT_MODE_RX } rmt_mode_t;
+typedef enum { RMT_CARRIER_LEVEL_LOW = 0, RMT_CARRIER_LEVEL_HIGH } rmt_carrier_level_t;
+typedef enum { RMT_IDLE_LEVEL_LOW = 0, RMT_IDLE_LEVEL_HIGH } rmt_idle_level_t;
+
+typedef struct {
+    bool                loop_en;
+    uint32_t            carrier_freq_hz;
+    uint8_t             carrier_duty_percent;
+    rmt_carrier_level_t carrier_level;
+    bool                carrier_en;
+    rmt_idle_level_t    idle_level;
+    bool                idle_output_en;
+} rmt_tx_config_t;
+
+typedef struct {
+    rmt_mode_t      rmt_mode;
+    rmt_channel_t   channel;
+    uint8_t         clk_div;
+    int             gpio_num;
+    uint8_t         mem_block_num;
+    rmt_tx_config_t tx_config;
+} rmt_config_t;
+
+typedef struct {
+    union {
+        struct {
+            uint32_t duration0 : 15;
+            uint32_t level0 : 1;
+            uint32_t duration1 : 15;
+            uint32_t level1 : 1;
+        };
+        uint32_t val;
+    };
+} rmt_item32_t;
+
+inline int rmt_config(const rmt_config_t* config) { return 0; }
+inline int rmt_fill_tx_items(rmt_channel_t channel, const rmt_item32_t* items, uint16_t n, uint16_t offset) { return 0; }
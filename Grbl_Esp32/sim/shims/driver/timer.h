@@ -0,0 +1,80 @@
+#pragma once
+
+/*
+  timer.h - host stand-in for the ESP-IDF general purpose timer driver, used by the simulator build
+
+  The step timer is not free running. Simulator.cpp fires the stepper ISR
+  itself and advances simulated time by the alarm period set here.
+*/
+
+#include <cstdint>
+
+typedef int esp_err_t;
+
+typedef enum { TIMER_GROUP_0 = 0, TIMER_GROUP_1 = 1 } timer_group_t;
+typedef enum { TIMER_0 = 0, TIMER_1 = 1 } timer_idx_t;
+
+#define TIMER_COUNT_UP 1
+#define TIMER_PAUSE 0
+#define TIMER_START 1
+#define TIMER_ALARM_DIS 0
+#define TIMER_ALARM_EN 1
+#define TIMER_INTR_LEVEL 0
+
+typedef struct {
+    int      alarm_en;
+    int      counter_en;
+    int      intr_type;
+    int      counter_dir;
+    bool     auto_reload;
+    uint32_t divider;
+} timer_config_t;
+
+struct timg_dev_t {
+    struct {
+        struct {
+            uint32_t alarm_en;
+        } config;
+    } hw_timer[2];
+    struct {
+        uint32_t t0;
+        uint32_t t1;
+    } int_clr_timers;
+};
+extern timg_dev_t TIMERG0;
+
+struct sim_timer_t {
+    bool     running;
+    uint64_t alarm_ticks;
+};
+extern sim_timer_t sim_step_timer;   // TIMER_0, the stepper ISR
+extern sim_timer_t sim_pulse_timer;  // TIMER_1, the step pulse timer
+
+inline sim_timer_t& sim_timer(timer_idx_t idx) {
+    return idx == TIMER_0 ? sim_step_timer : sim_pulse_timer;
+}
+
+inline esp_err_t timer_init(timer_group_t group, timer_idx_t idx, const timer_config_t* config) {
+    return 0;
+}
+inline esp_err_t timer_set_counter_value(timer_group_t group, timer_idx_t idx, uint64_t value) {
+    return 0;
+}
+inline esp_err_t timer_enable_intr(timer_group_t group, timer_idx_t idx) {
+    return 0;
+}
+inline esp_err_t timer_isr_register(timer_group_t group, timer_idx_t idx, void (*fn)(void*), void* arg, int flags, void* handle) {
+    return 0;
+}
+inline esp_err_t timer_set_alarm_value(timer_group_t group, timer_idx_t idx, uint64_t ticks) {
+    sim_timer(idx).alarm_ticks = ticks;
+    return 0;
+}
+inline esp_err_t timer_start(timer_group_t group, timer_idx_t idx) {
+    sim_timer(idx).running = true;
+    return 0;
+}
+inline esp_err_t timer_pause(timer_group_t group, timer_idx_t idx) {
+    sim_timer(idx).running = false;
+    return 0;
+}
@@ -0,0 +1,4 @@
+#pragma once
+
+// Simulator build: nothing from this library is used on the host
+inline void esp_task_wdt_reset() {}
@@ -0,0 +1,71 @@
+#pragma once
+
+/*
+  FreeRTOS.h - host stand-in for the FreeRTOS kernel API, used by the simulator build
+
+  The simulator is single threaded. Tasks are never started, queues and
+  semaphores are always empty or free, and critical sections are no-ops.
+*/
+
+#include <cstdint>
+
+#define portMAX_DELAY 0xffffffff
+#define portTICK_PERIOD_MS 1
+#define portTICK_RATE_MS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define CONFIG_ARDUINO_RUNNING_CORE 1
+#define ARDUINO_RUNNING_CORE 1
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+typedef void*    TaskHandle_t;
+typedef void*    QueueHandle_t;
+typedef void*    SemaphoreHandle_t;
+typedef void*    xQueueHandle;
+typedef void*    xSemaphoreHandle;
+typedef void (*TaskFunction_t)(void*);
+typedef int portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL_ISR(mux)
+#define portEXIT_CRITICAL_ISR(mux)
+#define portYIELD_FROM_ISR()
+#define xPortGetCoreID() 0
+
+// Nothing preempts the simulator, so ISR code that would otherwise wait for
+// another interrupt has to do the work itself.
+#define xPortInIsrContext() true
+
+TickType_t xTaskGetTickCount();
+
+inline void       vTaskDelay(TickType_t ticks) {}
+inline void       vTaskDelayUntil(TickType_t* previous, TickType_t ticks) {}
+inline void       vTaskDelete(TaskHandle_t task) {}
+inline BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio, TaskHandle_t* task) {
+    return pdPASS;
+}
+inline BaseType_t xTaskCreatePinnedToCore(
+    TaskFunction_t fn, const char* name, uint32_t stack, void* param, UBaseType_t prio, TaskHandle_t* task, BaseType_t core) {
+    return pdPASS;
+}
+inline BaseType_t xTaskNotifyGive(TaskHandle_t task) { return pdPASS; }
+inline void       vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {}
+inline uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t wait) { return 0; }
+
+inline QueueHandle_t xQueueCreate(int length, int item_size) { return (QueueHandle_t)1; }
+inline BaseType_t    xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait) { return pdTRUE; }
+inline BaseType_t    xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken) { return pdTRUE; }
+inline BaseType_t    xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait) { return pdFALSE; }
+inline BaseType_t    xQueueReset(QueueHandle_t queue) { return pdPASS; }
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+inline SemaphoreHandle_t xSemaphoreCreateBinary() { return (SemaphoreHandle_t)1; }
+inline BaseType_t        xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait) { return pdTRUE; }
+inline BaseType_t        xSemaphoreGive(SemaphoreHandle_t sem) { return pdTRUE; }
+inline BaseType_t        xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken) { return pdTRUE; }
@@ -0,0 +1,4 @@
+#pragma once
+
+// Simulator build: the FreeRTOS API lives in FreeRTOS.h
+#include "FreeRTOS.h"
@@ -0,0 +1,44 @@
+#pragma once
+
+/*
+  nvs.h - host stand-in for ESP-IDF non-volatile storage, used by the simulator build
+
+  Nothing is ever stored, so every setting starts from its default.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+typedef int      esp_err_t;
+typedef uint32_t nvs_handle;
+
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode;
+
+typedef struct {
+    size_t used_entries;
+    size_t free_entries;
+    size_t total_entries;
+    size_t namespace_count;
+} nvs_stats_t;
+
+#define ESP_ERR_NVS_NOT_FOUND 0x1102
+#define ESP_ERR_NVS_INVALID_HANDLE 0x1107
+#define ESP_ERR_NVS_INVALID_NAME 0x1108
+#define ESP_ERR_NVS_INVALID_LENGTH 0x110c
+
+inline esp_err_t nvs_open(const char* name, nvs_open_mode mode, nvs_handle* handle) {
+    *handle = 1;
+    return 0;
+}
+inline esp_err_t nvs_get_i8(nvs_handle handle, const char* key, int8_t* value) { return ESP_ERR_NVS_NOT_FOUND; }
+inline esp_err_t nvs_get_i32(nvs_handle handle, const char* key, int32_t* value) { return ESP_ERR_NVS_NOT_FOUND; }
+inline esp_err_t nvs_get_str(nvs_handle handle, const char* key, char* value, size_t* len) { return ESP_ERR_NVS_NOT_FOUND; }
+inline esp_err_t nvs_get_blob(nvs_handle handle, const char* key, void* value, size_t* len) { return ESP_ERR_NVS_NOT_FOUND; }
+inline esp_err_t nvs_set_i8(nvs_handle handle, const char* key, int8_t value) { return 0; }
+inline esp_err_t nvs_set_i32(nvs_handle handle, const char* key, int32_t value) { return 0; }
+inline esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char* value) { return 0; }
+inline esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void* value, size_t len) { return 0; }
+inline esp_err_t nvs_erase_key(nvs_handle handle, const char* key) { return 0; }
+inline esp_err_t nvs_erase_all(nvs_handle handle) { return 0; }
+inline esp_err_t nvs_commit(nvs_handle handle) { return 0; }
+inline esp_err_t nvs_get_stats(const char* part, nvs_stats_t* stats) { return 0; }
@@ -0,0 +1,8 @@
+#pragma once
+
+/*
+  sdkconfig.h - host stand-in for the ESP-IDF build configuration, used by the simulator build
+*/
+
+#define CONFIG_BT_ENABLED 1
+#define CONFIG_BLUEDROID_ENABLED 1
@@ -83,6 +83,16 @@ const int MAX_N_AXIS = 6;
 #    define N_AXIS 3
 #endif
 
+// Hot loops over the axes are bounded by AXIS_LOOP_COUNT, so that the compiler can unroll them.
+// The axis count cannot be changed at run time (number_axis is fixed at N_AXIS), so it is known
+// here. Define AXIS_LOOPS_RUN_TIME to make it 0, which reads the count from the settings at run
+// time, to compare them.
+#ifdef AXIS_LOOPS_RUN_TIME
+const int AXIS_LOOP_COUNT = 0;
+#else
+const int AXIS_LOOP_COUNT = N_AXIS;
+#endif
+
 #ifndef LIMIT_MASK
 #    define LIMIT_MASK B0
 #endif
@@ -180,6 +190,7 @@ enum class Cmd : uint8_t {
     SafetyDoor            = 0x84,
     JogCancel             = 0x85,
     DebugReport           = 0x86,  // Only when DEBUG enabled, sends debug report in '{}' braces.
+    BinaryStream          = 0x88,  // Only when ENABLE_BINARY_STREAM enabled, starts binary motion streaming.
     FeedOvrReset          = 0x90,  // Restores feed override value to 100%.
     FeedOvrCoarsePlus     = 0x91,
     FeedOvrCoarseMinus    = 0x92,
@@ -364,6 +375,31 @@ const int ACCELERATION_TICKS_PER_SECOND = 100;
 // NOTE: For now disabled, will enable if flash space permits.
 // #define MAX_STEP_RATE_HZ 30000 // Hz
 
+// Times every stepper driver interrupt with the CPU cycle counter (CCOUNT). $Stepper/Stats reports
+// the minimum, mean and maximum ISR duration, how late or early each ISR started compared to the
+// programmed step period, a log2 histogram of each, and how many interrupts were skipped because the
+// previous one had not finished. $Stepper/Stats=RESET clears the counts. Use it to tune AMASS and
+// step pulse settings against the real ISR load. Adds a few cycles to every step.
+// The Pins line times the direction and step pin writes alone. $Stepper/Stats=UNBATCHED makes every
+// motor write its own pins and $Stepper/Stats=BATCHED goes back to one write per GPIO register; run
+// the same job after each to compare them. Both also clear the counts.
+// #define ENABLE_STEPPER_ISR_STATS // Default disabled. Uncomment to enable.
+
+// The stepper ISR counts each step in a small per-segment counter and adds the counts to sys_position
+// when the segment completes, instead of updating sys_position in the direction of every step.
+// Anything that needs the real-time position, such as status reports and the probe, reads it through
+// st_get_position(), which adds the steps of the segment in progress.
+#define STEPPER_BATCHED_POSITION  // Default enabled. Comment to disable.
+
+// Moves the Bresenham line tracing out of the stepper ISR. A task on the core that does not run
+// motion control expands each step segment into a run of steps per axis, kept as a first step
+// time, an interval and a change of interval per step. Runs that continue each other are merged,
+// so a cruise at constant speed is one run no matter how many segments it spans. The ISR only
+// replays the runs, waking when the next axis is due. Each axis therefore steps at its own time
+// instead of on the shared AMASS tick, and speed changes within a segment are followed instead of
+// stepped. Requires STEPPER_BATCHED_POSITION.
+// #define USE_STEP_QUEUE // Default disabled. Uncomment to enable.
+
 // By default, Grbl sets all input pins to normal-high operation with their internal pull-up resistors
 // enabled. This simplifies the wiring for users by requiring only a switch connected to ground,
 // although its recommended that users take the extra step of wiring in low-pass filter to reduce
@@ -401,6 +437,18 @@ const int TOOL_LENGTH_OFFSET_AXIS = Z_AXIS;  // Default z-axis. Valid values are
 // received, including not only GCode lines, but also $ and [ESP commands.
 //#define REPORT_ECHO_RAW_LINE_RECEIVED // Default disabled. Uncomment to enable.
 
+// Lines that only hold axis words and F and S words, sent while G0 or G1 is active in units per
+// minute mode, skip the modal group and word checks of the full g-code parser and go straight to
+// motion. Most lines of a CAM program look like that. The result is the same as the full parser's.
+// Any other line, and any line the full parser would reject, is parsed in full.
+#define ENABLE_GCODE_FAST_PATH  // Default enabled. Comment to disable.
+
+// A sender can stream motion as binary records instead of g-code text. It sends the BinaryStream
+// realtime command, and then frames of G0 and G1 moves that it has already parsed, checked by a
+// CRC and acknowledged by sequence number. Other lines travel in the frames as text. The protocol
+// is described in Serial.cpp, and doc/script/binary_stream.py is a sender for it.
+#define ENABLE_BINARY_STREAM  // Default enabled. Comment to disable.
+
 // Minimum planner junction speed. Sets the default minimum junction speed the planner plans to at
 // every buffer block junction, except for starting from rest and end of the buffer, which are always
 // zero. This value controls how fast the machine moves through junctions with no regard for acceleration
@@ -421,6 +469,14 @@ const double MINIMUM_FEED_RATE = 1.0;  // (mm/min)
 // bogged down by too many trig calculations.
 const int N_ARC_CORRECTION = 12;  // Integer (1-255)
 
+// Shortest time an arc segment should take at the speed the arc can run, which is the feed rate
+// capped by the centripetal acceleration the plane axes allow on the arc radius. Fast or tight
+// arcs that would otherwise be cut into segments shorter than this get fewer, longer segments,
+// so the planner buffer holds more look-ahead time. The chord error this adds is bounded by
+// acceleration * time^2 / 8, i.e. 0.6 micron at 200 mm/sec^2 with the default. Set to 0 to size
+// arc segments from $12 arc tolerance only.
+const double ARC_MIN_SEGMENT_TIME = 0.005;  // Float (seconds)
+
 // The arc G2/3 GCode standard is problematic by definition. Radius-based arcs have horrible numerical
 // errors when arc at semi-circles(pi) or full-circles(2*pi). Offset-based arcs are much more accurate
 // but still have a problem when arcs are full-circles (2*pi). This define accounts for the floating
@@ -453,8 +509,20 @@ const int DWELL_TIME_STEP = 50;  // Integer (1-255) (milliseconds)
 // available RAM, like when re-compiling for a Mega2560. Or decrease if the Arduino begins to
 // crash due to the lack of available RAM or if the CPU is having trouble keeping up with planning
 // new incoming motions as they are executed.
+// ESP32 NOTE: The buffer is now allocated at startup from the $Planner/Blocks setting. This value
+// is only the default for that setting.
 // #define BLOCK_BUFFER_SIZE 16 // Uncomment to override default in planner.h.
 
+// When $Planner/Coalesce/Tolerance is non-zero, mc_line() holds back the latest line motion and
+// merges following lines into it, as long as every point passed through stays within the tolerance
+// of the merged chord and the feed, spindle and coolant states are unchanged. Short CAM segments
+// then take fewer planner blocks, which multiplies the look-ahead distance of the planner.
+// COALESCE_MAX_LINES bounds how many g-code lines can go into one planner block.
+// A held line is sent to the planner once the stepper is down to its last planned block, so the
+// machine never waits on the merge stage, or after no line was merged into it for COALESCE_FLUSH_MS.
+const int COALESCE_MAX_LINES = 16;
+const int COALESCE_FLUSH_MS  = 20;
+
 // Governs the size of the intermediary step segment buffer between the step execution algorithm
 // and the planner blocks. Each segment is set of steps executed at a constant velocity over a
 // fixed time defined by ACCELERATION_TICKS_PER_SECOND. They are computed such that the planner
@@ -90,6 +90,18 @@
 #    define DEFAULT_ARC_TOLERANCE 0.002  // $12 mm
 #endif
 
+#ifndef DEFAULT_PLANNER_BLOCKS
+#    define DEFAULT_PLANNER_BLOCKS BLOCK_BUFFER_SIZE  // $Planner/Blocks (takes effect after restart)
+#endif
+
+#ifndef DEFAULT_COALESCE_TOLERANCE
+#    define DEFAULT_COALESCE_TOLERANCE 0.0  // $Planner/Coalesce/Tolerance mm (0 disables)
+#endif
+
+#ifndef DEFAULT_I2S_DMABUF_COUNT
+#    define DEFAULT_I2S_DMABUF_COUNT I2S_OUT_DMABUF_COUNT  // $Stepper/I2S/Buffers (takes effect after restart)
+#endif
+
 #ifndef DEFAULT_REPORT_INCHES
 #    define DEFAULT_REPORT_INCHES 0  // $13 false
 #endif
@@ -320,6 +332,29 @@
 #    define DEFAULT_C_ACCELERATION 200.0
 #endif
 
+// ============== Axis Jerk =========
+#define SEC_PER_MIN_CU (60.0 * 60.0 * 60.0)  // Seconds Per Minute Cubed, for jerk conversion
+// Default jerk limits are expressed in mm/sec^3. Zero disables jerk limiting
+// for that axis, so moves use the classic trapezoidal velocity profile.
+#ifndef DEFAULT_X_JERK
+#    define DEFAULT_X_JERK 0.0
+#endif
+#ifndef DEFAULT_Y_JERK
+#    define DEFAULT_Y_JERK 0.0
+#endif
+#ifndef DEFAULT_Z_JERK
+#    define DEFAULT_Z_JERK 0.0
+#endif
+#ifndef DEFAULT_A_JERK
+#    define DEFAULT_A_JERK 0.0
+#endif
+#ifndef DEFAULT_B_JERK
+#    define DEFAULT_B_JERK 0.0
+#endif
+#ifndef DEFAULT_C_JERK
+#    define DEFAULT_C_JERK 0.0
+#endif
+
 // ========= AXIS MAX TRAVEL ============
 
 #ifndef DEFAULT_X_MAX_TRAVEL
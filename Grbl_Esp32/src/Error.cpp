@@ -81,4 +81,9 @@ std::map<Error, const char*> ErrorNames = {
     { Error::AuthenticationFailed, "Authentication failed!" },
     { Error::AnotherInterfaceBusy, "Another interface is busy" },
     { Error::JogCancelled, "Jog Cancelled" },
+    { Error::CompileUnsupported, "Line cannot be compiled" },
+    { Error::CompiledJobInvalid, "Invalid compiled job" },
+    { Error::CompiledJobStale, "Compiled job is out of date" },
+    { Error::ResumeLineNotFound, "Line to resume from is past the end of the file" },
+    { Error::ResumeOffsetsChanged, "Lines before the line to resume from set offsets" },
 };
@@ -21,6 +21,7 @@
   along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
 */
 
+#include <cstdint>
 #include <map>
 
 // Grbl error codes. Valid values (0-255)
@@ -85,6 +86,11 @@ enum class Error : uint8_t {
     Eol                         = 111,
     AnotherInterfaceBusy        = 120,
     JogCancelled                = 130,
+    CompileUnsupported          = 140,  // The line cannot be compiled into a job
+    CompiledJobInvalid          = 141,  // Not a compiled job, or one from another firmware
+    CompiledJobStale            = 142,  // The settings or the parser state changed since the job was compiled
+    ResumeLineNotFound          = 143,  // The file ends before the line to resume from
+    ResumeOffsetsChanged        = 144,  // A line before the line to resume from sets an offset
 };
 
 extern std::map<Error, const char*> ErrorNames;
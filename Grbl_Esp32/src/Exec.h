@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <map>
 
 // System executor bit map. Used internally by realtime protocol as realtime command flags,
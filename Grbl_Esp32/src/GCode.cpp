@@ -40,6 +40,14 @@ static const uint8_t MaxToolNumber = 255;  // Limited by max unsigned 8-bit valu
 parser_state_t gc_state;
 parser_block_t gc_block;
 
+// Where gc_compile_line() captures the motion of the line it compiles, instead of planning it
+static gc_compiled_motion_t* gc_capture = NULL;
+// The G91 axis words of the line being parsed in mm, before the position is added to them
+static float gc_capture_increment[MAX_N_AXIS];
+// Axes where a compiled job runs from another position than it was compiled from. The motions
+// that depend on the position of one of them are planned from where the job is instead.
+static uint8_t gc_compiled_shifted_axes = 0;
+
 #define FAIL(status) return (status);
 
 void gc_init() {
@@ -53,11 +61,18 @@ void gc_init() {
 // Sets g-code parser position in mm. Input in steps. Called by the system abort and hard
 // limit pull-off routines.
 void gc_sync_position() {
-    system_convert_array_steps_to_mpos(gc_state.position, sys_position);
+    int32_t steps[MAX_N_AXIS];
+    st_get_position(steps);
+    system_convert_array_steps_to_mpos(gc_state.position, steps);
 }
 
 // Edit GCode line in-place, removing whitespace and comments and
 // converting to uppercase
+// This is a pass of its own rather than part of the word scan in gc_execute_line(), because
+// whitespace and comments may sit anywhere, even inside a number ("X1 0.5" is X10.5, "G0(x)1"
+// is G01). read_float(), which the settings code shares, would need a variant that skips them,
+// and the fast path and the full parser would both filter a line that falls through to the
+// latter. The pass is a single read and write of the line, which is in cache by then.
 void collapseGCode(char* line) {
     // parenPtr, if non-NULL, is the address of the character after (
     char* parenPtr = NULL;
@@ -115,6 +130,224 @@ void collapseGCode(char* line) {
     *outPtr = '\0';
 }
 
+// Converts the axis words of a G0 or G1 target from program units to mm and applies the work
+// offsets, in the same order of operations as STEP 3. Axes without a word keep their position.
+static void gc_offset_motion_target(float* target, uint8_t axis_words, Units units, Distance distance) {
+    auto n_axis = number_axis->get();
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        if (bit_isfalse(axis_words, bit(idx))) {
+            target[idx] = gc_state.position[idx];
+            continue;
+        }
+        if (units == Units::Inches) {
+            target[idx] *= MM_PER_INCH;
+        }
+        if (distance == Distance::Absolute) {
+            target[idx] += gc_state.coord_system[idx] + gc_state.coord_offset[idx];
+            if (idx == TOOL_LENGTH_OFFSET_AXIS) {
+                target[idx] += gc_state.tool_length_offset;
+            }
+        } else {
+            gc_capture_increment[idx] = target[idx];
+            target[idx] += gc_state.position[idx];
+        }
+    }
+}
+
+// Sets up the planner data of a motion in the active motion mode from the parser state, as STEP 4
+// does for a line with only axis words and F and S words. G0 turns a laser off.
+static void gc_init_plan_data(plan_line_data_t* pl_data) {
+    memset(pl_data, 0, sizeof(plan_line_data_t));
+#ifdef USE_LINE_NUMBERS
+    pl_data->line_number = gc_state.line_number;
+#endif
+    if (gc_state.modal.feed_rate == FeedRate::InverseTime) {
+        pl_data->motion.inverseTime = 1;
+    }
+    pl_data->feed_rate = gc_state.feed_rate;
+    if (!(spindle->inLaserMode() && gc_state.modal.motion == Motion::Seek)) {
+        pl_data->spindle_speed = gc_state.spindle_speed;
+    }
+    pl_data->spindle = gc_state.modal.spindle;
+    pl_data->coolant = gc_state.modal.coolant;
+    if (gc_state.modal.control == ControlMode::ContinuousPath) {
+        pl_data->path_tolerance = gc_state.path_tolerance;
+    }
+    if (gc_state.modal.motion == Motion::Seek) {
+        pl_data->motion.rapidMotion = 1;  // Set rapid motion flag.
+    }
+}
+
+// Stores the motion of the line being compiled. Like STEP 4, it leaves the state a G5 continues from.
+// Axes without a word, and G91 axis words, keep the move instead of the target, so that the job
+// moves them from where it is when it runs, as the line would.
+static void gc_capture_motion(float*   target,
+                              uint8_t  axis_words,
+                              Distance distance,
+                              uint8_t  axis_0,
+                              uint8_t  axis_1,
+                              uint8_t  axis_linear,
+                              bool     is_clockwise_arc,
+                              float*   spline_control) {
+    gc_compiled_motion_t* compiled = gc_capture;
+    compiled->motion               = gc_state.modal.motion;
+    compiled->axis_0               = axis_0;
+    compiled->axis_1               = axis_1;
+    compiled->axis_linear          = axis_linear;
+    compiled->is_clockwise_arc     = is_clockwise_arc;
+    compiled->line_number          = gc_state.line_number;
+    compiled->feed_rate            = gc_state.feed_rate;
+    compiled->spindle_speed        = gc_state.spindle_speed;
+    compiled->radius               = gc_block.values.r;
+    compiled->relative_axes        = 0;
+    memcpy(compiled->target, target, sizeof(compiled->target));
+    auto n_axis = number_axis->get();
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        if (bit_isfalse(axis_words, bit(idx))) {
+            compiled->target[idx] = 0.0;
+        } else if (distance == Distance::Incremental) {
+            compiled->target[idx] = gc_capture_increment[idx];
+        } else {
+            continue;
+        }
+        compiled->relative_axes |= bit(idx);
+    }
+    memcpy(compiled->offset, gc_block.values.ijk, sizeof(compiled->offset));
+    if (compiled->motion == Motion::CubicSpline || compiled->motion == Motion::QuadraticSpline) {
+        memcpy(compiled->spline_control, spline_control, sizeof(compiled->spline_control));
+        memcpy(gc_state.spline_control, spline_control, sizeof(gc_state.spline_control));
+    }
+}
+
+// Plans the active G0 or G1 motion to an offset target, as STEP 4 does for an axis command in
+// the motion mode.
+static void gc_plan_modal_motion(float* target, uint8_t axis_words, Distance distance, float feed_rate, float spindle_speed, int32_t line_number) {
+    bool capture         = gc_capture != NULL;
+    gc_state.line_number = line_number;
+    gc_state.feed_rate   = feed_rate;
+    if (gc_state.spindle_speed != spindle_speed) {
+        // A laser follows the speed of each motion. Other spindles are synced to it.
+        if (gc_state.modal.spindle != SpindleState::Disable && !spindle->inLaserMode()) {
+            spindle->sync(gc_state.modal.spindle, (uint32_t)spindle_speed);
+            capture = false;
+        }
+        gc_state.spindle_speed = spindle_speed;
+    }
+    if (capture) {
+        gc_capture_motion(target, axis_words, distance, 0, 0, 0, false, NULL);
+    } else {
+        plan_line_data_t plan_data;
+        gc_init_plan_data(&plan_data);
+        cartesian_to_motors(target, &plan_data, gc_state.position);
+    }
+    memcpy(gc_state.position, target, sizeof(gc_state.position));
+}
+
+#ifdef ENABLE_GCODE_FAST_PATH
+// Executes a line of only axis words and F and S words in the active G0 or G1 motion mode, in
+// units per minute feed mode. The target, feed rate, spindle speed and planner data come out the
+// same as from the full parser. Returns false without changing any state for any other line, and
+// for any line the full parser would reject, which then parses it and reports the error.
+static bool gc_execute_modal_motion(const char* line) {
+    if (!(gc_state.modal.motion == Motion::Seek || gc_state.modal.motion == Motion::Linear)) {
+        return false;
+    }
+    if (gc_state.modal.feed_rate != FeedRate::UnitsPerMin) {
+        return false;
+    }
+    auto     n_axis             = number_axis->get();
+    float    target[MAX_N_AXIS] = {};
+    float    feed_rate          = gc_state.feed_rate;
+    float    spindle_speed      = gc_state.spindle_speed;
+    uint8_t  axis_words         = 0;
+    uint32_t value_words        = 0;
+    uint8_t  char_counter       = 0;
+    float    value;
+    uint8_t  idx;
+    while (line[char_counter] != 0) {
+        char letter = line[char_counter++];
+        if (!read_float(line, &char_counter, &value)) {
+            return false;
+        }
+        switch (letter) {
+            case 'X':
+                idx = X_AXIS;
+                break;
+            case 'Y':
+                idx = Y_AXIS;
+                break;
+            case 'Z':
+                idx = Z_AXIS;
+                break;
+            case 'A':
+                idx = A_AXIS;
+                break;
+            case 'B':
+                idx = B_AXIS;
+                break;
+            case 'C':
+                idx = C_AXIS;
+                break;
+            case 'F':
+                if (bit_istrue(value_words, bit(GCodeWord::F)) || value < 0.0) {
+                    return false;
+                }
+                value_words |= bit(GCodeWord::F);
+                feed_rate = value;
+                continue;
+            case 'S':
+                if (bit_istrue(value_words, bit(GCodeWord::S)) || value < 0.0) {
+                    return false;
+                }
+                value_words |= bit(GCodeWord::S);
+                spindle_speed = value;
+                continue;
+            default:
+                return false;
+        }
+        if (idx >= n_axis || bit_istrue(axis_words, bit(idx))) {
+            return false;
+        }
+        axis_words |= bit(idx);
+        target[idx] = value;
+    }
+    if (!axis_words) {
+        return false;
+    }
+    if (gc_state.modal.units == Units::Inches && bit_istrue(value_words, bit(GCodeWord::F))) {
+        feed_rate *= MM_PER_INCH;
+    }
+    if (gc_state.modal.motion == Motion::Linear && feed_rate == 0.0) {
+        return false;  // [Feed rate undefined]
+    }
+    gc_offset_motion_target(target, axis_words, gc_state.modal.units, gc_state.modal.distance);
+    gc_plan_modal_motion(target, axis_words, gc_state.modal.distance, feed_rate, spindle_speed, 0);
+    return true;
+}
+#endif
+
+// Executes a G0 or G1 motion that was parsed by the sender, as from the binary stream. The
+// target is in mm and absolute work coordinates, and the feed rate in mm per minute. Only the
+// axes in axis_words move. The motion mode becomes the active one, like a G0 or G1 word does.
+Error gc_execute_motion(Motion motion, float* target, uint8_t axis_words, float feed_rate, float spindle_speed, int32_t line_number) {
+    if (gc_state.modal.feed_rate != FeedRate::UnitsPerMin) {
+        return Error::GcodeUnsupportedCommand;  // A feed rate in mm per minute means nothing in G93
+    }
+    if (!axis_words) {
+        return Error::GcodeNoAxisWords;
+    }
+    if (axis_words >> number_axis->get()) {
+        return Error::GcodeUnsupportedCommand;  // [Unsupported axis]
+    }
+    if (motion == Motion::Linear && feed_rate == 0.0) {
+        return Error::GcodeUndefinedFeedRate;
+    }
+    gc_state.modal.motion = motion;
+    gc_offset_motion_target(target, axis_words, Units::Mm, Distance::Absolute);
+    gc_plan_modal_motion(target, axis_words, Distance::Absolute, feed_rate, spindle_speed, line_number);
+    return Error::Ok;
+}
+
 // Executes one line of NUL-terminated G-Code.
 // The line may contain whitespace and comments, which are first removed,
 // and lower case characters, which are converted to upper case.
@@ -127,6 +360,11 @@ Error gc_execute_line(char* line, uint8_t client) {
 #ifdef REPORT_ECHO_LINE_RECEIVED
     report_echo_line_received(line, client);
 #endif
+#ifdef ENABLE_GCODE_FAST_PATH
+    if (gc_execute_modal_motion(line)) {
+        return Error::Ok;
+    }
+#endif
 
     /* -------------------------------------------------------------------------------------
        STEP 1: Initialize parser block struct and copy current g-code state modes. The parser
@@ -149,6 +387,7 @@ Error gc_execute_line(char* line, uint8_t client) {
     auto     n_axis          = number_axis->get();
     float    coord_data[MAX_N_AXIS];  // Used by WCO-related commands
     uint8_t  pValue;                  // Integer value of P word
+    float    spline_control[2];       // G5/G5.1 offset from the target to the second control point
 
     // Determine if the line is a jogging motion or a normal g-code block.
     if (line[0] == '$') {  // NOTE: `$J=` already parsed when passed to this function.
@@ -276,6 +515,21 @@ Error gc_execute_line(char* line, uint8_t client) {
                         gc_block.modal.motion = Motion::CcwArc;
                         mg_word_bit           = ModalGroup::MG1;
                         break;
+                    case 5:  // G5 - cubic spline, G5.1 - quadratic spline
+                        axis_command = AxisCommand::MotionMode;
+                        switch (mantissa) {
+                            case 0:
+                                gc_block.modal.motion = Motion::CubicSpline;
+                                break;
+                            case 10:
+                                gc_block.modal.motion = Motion::QuadraticSpline;
+                                mantissa              = 0;  // Set to zero to indicate valid non-integer G command.
+                                break;
+                            default:
+                                FAIL(Error::GcodeUnsupportedCommand);  // [Unsupported G5.x command]
+                        }
+                        mg_word_bit = ModalGroup::MG1;
+                        break;
                     case 38:  // G38 - probe
                         //only allow G38 "Probe" commands if a probe pin is defined.
                         if (PROBE_PIN == UNDEFINED_PIN) {
@@ -429,8 +683,12 @@ Error gc_execute_line(char* line, uint8_t client) {
                         if (mantissa != 0) {
                             FAIL(Error::GcodeUnsupportedCommand);  // [G61.1 not supported]
                         }
-                        // gc_block.modal.control = ControlMode::ExactPath; // G61
-                        mg_word_bit = ModalGroup::MG13;
+                        gc_block.modal.control = ControlMode::ExactPath;  // G61
+                        mg_word_bit            = ModalGroup::MG13;
+                        break;
+                    case 64:
+                        gc_block.modal.control = ControlMode::ContinuousPath;  // G64
+                        mg_word_bit            = ModalGroup::MG13;
                         break;
                     default:
                         FAIL(Error::GcodeUnsupportedCommand);  // [Unsupported G command]
@@ -687,9 +945,10 @@ Error gc_execute_line(char* line, uint8_t client) {
                 if (bit_istrue(value_words, bitmask)) {
                     FAIL(Error::GcodeWordRepeated);  // [Word repeated]
                 }
-                // Check for invalid negative values for words F, N, P, T, and S.
-                // NOTE: Negative value check is done here simply for code-efficiency.
-                if (bitmask & (bit(GCodeWord::F) | bit(GCodeWord::N) | bit(GCodeWord::P) | bit(GCodeWord::T) | bit(GCodeWord::S))) {
+                // Check for invalid negative values for words F, N, T, and S.
+                // NOTE: Negative value check is done here simply for code-efficiency. P is checked once the
+                // motion mode is known, since it is a signed offset for G5.
+                if (bitmask & (bit(GCodeWord::F) | bit(GCodeWord::N) | bit(GCodeWord::T) | bit(GCodeWord::S))) {
                     if (value < 0.0) {
                         FAIL(Error::NegativeValue);  // [Word value cannot be negative]
                     }
@@ -730,6 +989,12 @@ Error gc_execute_line(char* line, uint8_t client) {
             axis_command = AxisCommand::MotionMode;  // Assign implicit motion-mode
         }
     }
+    // Check for a negative P value, which only a G5 control point offset may have.
+    if (bit_istrue(value_words, bit(GCodeWord::P)) && gc_block.values.p < 0.0) {
+        if (!(gc_block.modal.motion == Motion::CubicSpline && axis_command == AxisCommand::MotionMode)) {
+            FAIL(Error::NegativeValue);  // [Word value cannot be negative]
+        }
+    }
     // Check for valid line number N value.
     if (bit_istrue(value_words, bit(GCodeWord::N))) {
         // Line number value cannot be less than zero (done) or greater than max line number.
@@ -894,7 +1159,19 @@ Error gc_execute_line(char* line, uint8_t client) {
             coords[gc_block.modal.coord_select]->get(block_coord_system);
         }
     }
-    // [16. Set path control mode ]: N/A. Only G61. G61.1 and G64 NOT SUPPORTED.
+    // [16. Set path control mode ]: G64 takes an optional P path tolerance in the current units. Without
+    //   P, corners are limited by junction deviation just as in G61. G61.1 NOT SUPPORTED.
+    float block_path_tolerance = gc_state.path_tolerance;
+    if (bit_istrue(command_words, bit(ModalGroup::MG13))) {
+        block_path_tolerance = 0.0;
+        if (gc_block.modal.control == ControlMode::ContinuousPath && bit_istrue(value_words, bit(GCodeWord::P))) {
+            block_path_tolerance = gc_block.values.p;
+            if (gc_block.modal.units == Units::Inches) {
+                block_path_tolerance *= MM_PER_INCH;
+            }
+            bit_false(value_words, bit(GCodeWord::P));
+        }
+    }
     // [17. Set distance mode ]: N/A. Only G91.1. G90.1 NOT SUPPORTED.
     // [18. Set retract mode ]: NOT SUPPORTED.
     // [19. Remaining non-modal actions ]: Check go to predefined position, set G10, or set axis offsets.
@@ -960,6 +1237,10 @@ Error gc_execute_line(char* line, uint8_t client) {
             if (!axis_words) {
                 FAIL(Error::GcodeNoAxisWords);  // [No axis words]
             }
+            // The targets of a compiled job after this hold the offset it set from where the job was compiled
+            if (axis_words & gc_compiled_shifted_axes) {
+                FAIL(Error::CompiledJobStale);
+            }
             // Update axes defined only in block. Offsets current system to defined value. Does not update when
             // active coordinate system is selected, but is still active unless G92.1 disables it.
             for (idx = 0; idx < n_axis; idx++) {  // Axes indices are consistent, so loop may be used.
@@ -995,6 +1276,7 @@ Error gc_execute_line(char* line, uint8_t client) {
                                         gc_block.values.xyz[idx] += gc_state.tool_length_offset;
                                     }
                                 } else {  // Incremental mode
+                                    gc_capture_increment[idx] = gc_block.values.xyz[idx];
                                     gc_block.values.xyz[idx] += gc_state.position[idx];
                                 }
                             }
@@ -1241,6 +1523,53 @@ Error gc_execute_line(char* line, uint8_t client) {
                         FAIL(Error::GcodeInvalidTarget);  // [Invalid target]
                     }
                     break;
+                case Motion::CubicSpline:
+                case Motion::QuadraticSpline:
+                    // [G5/G5.1 Errors]: Feed rate undefined. Plane is not G17. No axis words.
+                    // [G5 Errors]: P or Q missing. I and J missing and the previous motion was not G5.
+                    // [G5.1 Errors]: I and J missing. P or Q present (unused words).
+                    // NOTE: I/J is the offset from the current point to the first control point. P/Q is the offset
+                    // from the target to the second control point. A missing one of I and J is zero. G5.1 uses I/J
+                    // as its only control point and is converted here to the equivalent cubic.
+                    if (gc_block.modal.plane_select != Plane::XY) {
+                        FAIL(Error::GcodeUnsupportedCommand);  // [Spline not in XY plane]
+                    }
+                    if (!axis_words) {
+                        FAIL(Error::GcodeNoAxisWords);  // [No axis words]
+                    }
+                    if (gc_block.modal.units == Units::Inches) {
+                        gc_block.values.ijk[X_AXIS] *= MM_PER_INCH;
+                        gc_block.values.ijk[Y_AXIS] *= MM_PER_INCH;
+                        gc_block.values.p *= MM_PER_INCH;
+                        gc_block.values.q *= MM_PER_INCH;
+                    }
+                    if (gc_block.modal.motion == Motion::CubicSpline) {
+                        if (bit_isfalse(value_words, bit(GCodeWord::P)) || bit_isfalse(value_words, bit(GCodeWord::Q))) {
+                            FAIL(Error::GcodeValueWordMissing);  // [P/Q word missing]
+                        }
+                        if (!(ijk_words & (bit(X_AXIS) | bit(Y_AXIS)))) {
+                            if (gc_state.modal.motion != Motion::CubicSpline) {
+                                FAIL(Error::GcodeNoOffsetsInPlane);  // [No I/J and no previous G5]
+                            }
+                            gc_block.values.ijk[X_AXIS] = -gc_state.spline_control[0];
+                            gc_block.values.ijk[Y_AXIS] = -gc_state.spline_control[1];
+                        }
+                        spline_control[0] = gc_block.values.p;
+                        spline_control[1] = gc_block.values.q;
+                        bit_false(value_words, (bit(GCodeWord::P) | bit(GCodeWord::Q)));
+                    } else {
+                        if (!(ijk_words & (bit(X_AXIS) | bit(Y_AXIS)))) {
+                            FAIL(Error::GcodeNoOffsetsInPlane);  // [No offsets in plane]
+                        }
+                        // The cubic control points are 2/3 of the way from each end to the quadratic control point.
+                        for (idx = 0; idx < 2; idx++) {
+                            float control            = gc_block.values.ijk[idx] * (2.0 / 3.0);
+                            gc_block.values.ijk[idx] = control;
+                            spline_control[idx]      = control - (gc_block.values.xyz[idx] - gc_state.position[idx]) * (2.0 / 3.0);
+                        }
+                    }
+                    bit_false(value_words, (bit(GCodeWord::I) | bit(GCodeWord::J)));
+                    break;
             }
         }
     }
@@ -1296,10 +1625,25 @@ Error gc_execute_line(char* line, uint8_t client) {
         // JogCancelled is not reported as a GCode error
         return status == Error::JogCancelled ? Error::Ok : status;
     }
+    // A compiled job replays its lines from the parser state alone. Lines that store settings,
+    // change tools, switch outputs or probe cannot be compiled, and must fail before they do.
+    bool capture_motion = false;
+    if (gc_capture) {
+        if ((gc_block.non_modal_command == NonModal::SetCoordinateData) || (gc_block.non_modal_command == NonModal::SetHome0) ||
+            (gc_block.non_modal_command == NonModal::SetHome1) || (gc_block.modal.tool_change == ToolChange::Enable) ||
+            bit_istrue(command_words, bit(ModalGroup::MM10)) ||
+            (gc_block.modal.motion >= Motion::ProbeToward && gc_block.modal.motion <= Motion::ProbeAwayNoError)) {
+            FAIL(Error::CompileUnsupported);
+        }
+        // Only lines of axis words and F, S and N words, with or without a motion command, are captured.
+        capture_motion = !(command_words & ~bit(ModalGroup::MG1)) && gc_block.non_modal_command == NonModal::NoAction &&
+                         axis_command == AxisCommand::MotionMode;
+    }
     // If in laser mode, setup laser power based on current and past parser conditions.
     if (spindle->inLaserMode()) {
         if (!((gc_block.modal.motion == Motion::Linear) || (gc_block.modal.motion == Motion::CwArc) ||
-              (gc_block.modal.motion == Motion::CcwArc))) {
+              (gc_block.modal.motion == Motion::CcwArc) || (gc_block.modal.motion == Motion::CubicSpline) ||
+              (gc_block.modal.motion == Motion::QuadraticSpline))) {
             gc_parser_flags |= GCParserLaserDisable;
         }
         // Any motion mode with axis words is allowed to be passed from a spindle speed update.
@@ -1312,7 +1656,8 @@ Error gc_execute_line(char* line, uint8_t client) {
             // a G1/2/3 motion mode state and vice versa when there is no motion in the line.
             if (gc_state.modal.spindle == SpindleState::Cw) {
                 if ((gc_state.modal.motion == Motion::Linear) || (gc_state.modal.motion == Motion::CwArc) ||
-                    (gc_state.modal.motion == Motion::CcwArc)) {
+                    (gc_state.modal.motion == Motion::CcwArc) || (gc_state.modal.motion == Motion::CubicSpline) ||
+                    (gc_state.modal.motion == Motion::QuadraticSpline)) {
                     if (bit_istrue(gc_parser_flags, GCParserLaserDisable)) {
                         gc_parser_flags |= GCParserLaserForceSync;  // Change from G1/2/3 motion mode.
                     }
@@ -1344,6 +1689,7 @@ Error gc_execute_line(char* line, uint8_t client) {
     if ((gc_state.spindle_speed != gc_block.values.s) || bit_istrue(gc_parser_flags, GCParserLaserForceSync)) {
         if (gc_state.modal.spindle != SpindleState::Disable) {
             if (bit_isfalse(gc_parser_flags, GCParserLaserIsMotion)) {
+                capture_motion = false;  // The sync must happen in place
                 if (bit_istrue(gc_parser_flags, GCParserLaserDisable)) {
                     spindle->sync(gc_state.modal.spindle, 0);
                 } else {
@@ -1462,8 +1808,12 @@ Error gc_execute_line(char* line, uint8_t client) {
         memcpy(gc_state.coord_system, block_coord_system, sizeof(gc_state.coord_system));
         system_flag_wco_change();
     }
-    // [16. Set path control mode ]: G61.1/G64 NOT SUPPORTED
-    // gc_state.modal.control = gc_block.modal.control; // NOTE: Always default.
+    // [16. Set path control mode ]: G61.1 NOT SUPPORTED
+    gc_state.modal.control  = gc_block.modal.control;
+    gc_state.path_tolerance = block_path_tolerance;
+    if (gc_state.modal.control == ControlMode::ContinuousPath) {
+        pl_data->path_tolerance = gc_state.path_tolerance;  // Record data for planner use.
+    }
     // [17. Set distance mode ]:
     gc_state.modal.distance = gc_block.modal.distance;
     // [18. Set retract mode ]: NOT SUPPORTED
@@ -1512,7 +1862,16 @@ Error gc_execute_line(char* line, uint8_t client) {
     if (gc_state.modal.motion != Motion::None) {
         if (axis_command == AxisCommand::MotionMode) {
             GCUpdatePos gc_update_pos = GCUpdatePos::Target;
-            if (gc_state.modal.motion == Motion::Linear) {
+            if (capture_motion) {
+                gc_capture_motion(gc_block.values.xyz,
+                                  axis_words,
+                                  gc_state.modal.distance,
+                                  axis_0,
+                                  axis_1,
+                                  axis_linear,
+                                  bit_istrue(gc_parser_flags, GCParserArcIsClockwise),
+                                  spline_control);
+            } else if (gc_state.modal.motion == Motion::Linear) {
                 cartesian_to_motors(gc_block.values.xyz, pl_data, gc_state.position);
             } else if (gc_state.modal.motion == Motion::Seek) {
                 pl_data->motion.rapidMotion = 1;  // Set rapid motion flag.
@@ -1527,6 +1886,9 @@ Error gc_execute_line(char* line, uint8_t client) {
                        axis_1,
                        axis_linear,
                        bit_istrue(gc_parser_flags, GCParserArcIsClockwise));
+            } else if ((gc_state.modal.motion == Motion::CubicSpline) || (gc_state.modal.motion == Motion::QuadraticSpline)) {
+                mc_spline(gc_block.values.xyz, pl_data, gc_state.position, gc_block.values.ijk, spline_control, X_AXIS, Y_AXIS);
+                memcpy(gc_state.spline_control, spline_control, sizeof(spline_control));
             } else {
                 // NOTE: gc_block.values.xyz is returned from mc_probe_cycle with the updated position value. So
                 // upon a successful probing cycle, the machine position and the returned value should be the same.
@@ -1592,9 +1954,11 @@ Error gc_execute_line(char* line, uint8_t client) {
             sys.r_override        = RapidOverride::Default;
             sys.spindle_speed_ovr = SpindleSpeedOverride::Default;
 #endif
-            // Execute coordinate change and spindle/coolant stop.
+            // Execute coordinate change and spindle/coolant stop. Check mode reloads the coordinate
+            // system too, as a G54 word would load it in check mode, so that the lines after are
+            // checked (and compiled) in the one they run in. Leaving $C resets, which reloads it anyway.
+            coords[gc_state.modal.coord_select]->get(gc_state.coord_system);
             if (sys.state != State::CheckMode) {
-                coords[gc_state.modal.coord_select]->get(gc_state.coord_system);
                 system_flag_wco_change();  // Set to refresh immediately just in case something altered.
                 spindle->set_state(SpindleState::Disable, 0);
                 coolant_off();
@@ -1609,6 +1973,102 @@ Error gc_execute_line(char* line, uint8_t client) {
     return Error::Ok;
 }
 
+// Executes a line in check mode, as $C does, for a compiled job. A line that is only a motion in the
+// motion mode is captured instead of planned, and replays from gc_execute_compiled(). Any other
+// line keeps compiled->motion None and runs as text, from the state the lines before leave.
+Error gc_compile_line(char* line, uint8_t client, gc_compiled_motion_t* compiled) {
+    State state      = sys.state;
+    sys.state        = State::CheckMode;
+    compiled->motion = Motion::None;
+    gc_capture       = compiled;
+    Error status     = gc_execute_line(line, client);
+    gc_capture       = NULL;
+    sys.state        = state;
+    if (status != Error::Ok) {
+        compiled->motion = Motion::None;
+    }
+    return status;
+}
+
+// Plans a compiled motion like STEP 4 planned the line it came from, with the same parser state.
+Error gc_execute_compiled(gc_compiled_motion_t* compiled) {
+    // The target of an axis that moves from where the motion starts is worked out as STEP 3 does.
+    float target[MAX_N_AXIS];
+    memcpy(target, compiled->target, sizeof(target));
+    for (uint8_t idx = 0; idx < MAX_N_AXIS; idx++) {
+        if (bit_istrue(compiled->relative_axes, bit(idx))) {
+            target[idx] += gc_state.position[idx];
+        }
+    }
+    // An arc or spline with a fixed end on a plane axis it starts elsewhere on has another shape,
+    // which its compiled offsets do not describe.
+    uint8_t plane = 0;
+    switch (compiled->motion) {
+        case Motion::CwArc:
+        case Motion::CcwArc:
+            plane = bit(compiled->axis_0) | bit(compiled->axis_1);
+            break;
+        case Motion::CubicSpline:
+        case Motion::QuadraticSpline:
+            plane = bit(X_AXIS) | bit(Y_AXIS);
+            break;
+        default:
+            break;
+    }
+    if (plane & gc_compiled_shifted_axes & ~compiled->relative_axes) {
+        return Error::CompiledJobStale;
+    }
+    gc_compiled_shifted_axes &= compiled->relative_axes;  // Fixed targets put the axes back in step
+
+    gc_state.modal.motion  = compiled->motion;
+    gc_state.line_number   = compiled->line_number;
+    gc_state.feed_rate     = compiled->feed_rate;
+    gc_state.spindle_speed = compiled->spindle_speed;
+    plan_line_data_t plan_data;
+    gc_init_plan_data(&plan_data);
+    switch (compiled->motion) {
+        case Motion::Seek:
+        case Motion::Linear:
+            cartesian_to_motors(target, &plan_data, gc_state.position);
+            break;
+        case Motion::CwArc:
+        case Motion::CcwArc:
+            mc_arc(target,
+                   &plan_data,
+                   gc_state.position,
+                   compiled->offset,
+                   compiled->radius,
+                   compiled->axis_0,
+                   compiled->axis_1,
+                   compiled->axis_linear,
+                   compiled->is_clockwise_arc);
+            break;
+        case Motion::CubicSpline:
+        case Motion::QuadraticSpline:
+            mc_spline(target, &plan_data, gc_state.position, compiled->offset, compiled->spline_control, X_AXIS, Y_AXIS);
+            memcpy(gc_state.spline_control, compiled->spline_control, sizeof(gc_state.spline_control));
+            break;
+        default:
+            return Error::CompiledJobInvalid;
+    }
+    memcpy(gc_state.position, target, sizeof(gc_state.position));
+    return Error::Ok;
+}
+
+void gc_compiled_begin(const float* position) {
+    gc_compiled_shifted_axes = 0;
+    auto n_axis              = number_axis->get();
+    for (uint8_t idx = 0; idx < n_axis; idx++) {
+        if (gc_state.position[idx] != position[idx]) {
+            gc_compiled_shifted_axes |= bit(idx);
+        }
+    }
+}
+
+void gc_compiled_end() {
+    gc_compiled_shifted_axes = 0;
+}
+
 /*
   Not supported:
 
@@ -1631,5 +2091,5 @@ Error gc_execute_line(char* line, uint8_t client) {
    group 8 = {M7*} enable mist coolant (* Compile-option)
    group 9 = {M48, M49} enable/disable feed and speed override switches
    group 10 = {G98, G99} return mode canned cycles
-   group 13 = {G61.1, G64} path control mode (G61 is supported)
+   group 13 = {G61.1} path control mode (G61 and G64 are supported)
 */
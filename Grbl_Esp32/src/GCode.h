@@ -42,7 +42,7 @@ enum class ModalGroup : uint8_t {
     MG7  = 7,   // [G40] Cutter radius compensation mode. G41/42 NOT SUPPORTED.
     MG8  = 8,   // [G43.1,G49] Tool length offset
     MG12 = 9,   // [G54,G55,G56,G57,G58,G59] Coordinate system selection
-    MG13 = 10,  // [G61] Control mode
+    MG13 = 10,  // [G61,G64] Control mode
     MM4  = 11,  // [M0,M1,M2,M30] Stopping
     MM6  = 14,  // [M6] Tool change
     MM7  = 12,  // [M3,M4,M5] Spindle turning
@@ -79,6 +79,8 @@ enum class Motion : uint8_t {
     Linear             = 1,    // G1 (Do not alter value)
     CwArc              = 2,    // G2 (Do not alter value)
     CcwArc             = 3,    // G3 (Do not alter value)
+    CubicSpline        = 5,    // G5 (Do not alter value)
+    QuadraticSpline    = 51,   // G5.1 (Do not alter value)
     ProbeToward        = 140,  // G38.2 (Do not alter value)
     ProbeTowardNoError = 141,  // G38.3 (Do not alter value)
     ProbeAway          = 142,  // G38.4 (Do not alter value)
@@ -134,7 +136,8 @@ enum class CutterCompensation : uint8_t {
 
 // Modal Group G13: Control mode
 enum class ControlMode : uint8_t {
-    ExactPath = 0,  // G61 (Default: Must be zero)
+    ExactPath      = 0,  // G61 (Default: Must be zero)
+    ContinuousPath = 1,  // G64
 };
 
 // Modal Group M7: Spindle control
@@ -260,7 +263,7 @@ CoordIndex& operator ++ (CoordIndex& i);
 
 // NOTE: When this struct is zeroed, the 0 values in the above types set the system defaults.
 typedef struct {
-    Motion   motion;     // {G0,G1,G2,G3,G38.2,G80}
+    Motion   motion;     // {G0,G1,G2,G3,G5,G5.1,G38.2,G80}
     FeedRate feed_rate;  // {G93,G94}
     Units    units;      // {G20,G21}
     Distance distance;   // {G90,G91}
@@ -269,7 +272,7 @@ typedef struct {
     // CutterCompensation cutter_comp;  // {G40} NOTE: Don't track. Only default supported.
     ToolLengthOffset tool_length;   // {G43.1,G49}
     CoordIndex       coord_select;  // {G54,G55,G56,G57,G58,G59}
-    // uint8_t control;      // {G61} NOTE: Don't track. Only default supported.
+    ControlMode  control;       // {G61,G64}
     ProgramFlow  program_flow;  // {M0,M1,M2,M30}
     CoolantState coolant;       // {M7,M8,M9}
     SpindleState spindle;       // {M3,M4,M5}
@@ -307,6 +310,9 @@ typedef struct {
     float coord_offset[MAX_N_AXIS];  // Retains the G92 coordinate offset (work coordinates) relative to
     // machine zero in mm. Non-persistent. Cleared upon reset and boot.
     float tool_length_offset;  // Tracks tool length offset value when enabled.
+    float path_tolerance;      // G64 P blending tolerance in mm. Zero when no tolerance was given.
+    float spline_control[2];   // Offset in mm from the end of the last G5 cubic to its second control point.
+    // A G5 without I and J starts along the direction the previous G5 ended in.
 } parser_state_t;
 extern parser_state_t gc_state;
 
@@ -327,8 +333,44 @@ enum class AxisCommand : uint8_t {
 // Initialize the parser
 void gc_init();
 
+// Remove whitespace and comments from a line, in place, and convert it to upper case
+void collapseGCode(char* line);
+
 // Execute one block of rs275/ngc/g-code
 Error gc_execute_line(char* line, uint8_t client);
 
+// Execute a G0 or G1 motion parsed by the sender. Target in mm and absolute work coordinates.
+Error gc_execute_motion(Motion motion, float* target, uint8_t axis_words, float feed_rate, float spindle_speed, int32_t line_number);
+
 // Set g-code parser position. Input in steps.
 void gc_sync_position();
+
+// A motion of a compiled job, with its target and offsets already resolved, except on the axes
+// that move from where it starts. Everything else the planner needs comes from the parser state
+// when it runs, as it does for the line it came from.
+typedef struct {
+    Motion  motion;               // G0, G1, G2, G3, G5 or G5.1. None when the line was not a motion.
+    uint8_t axis_0;               // Arc plane axes
+    uint8_t axis_1;               //
+    uint8_t axis_linear;          //
+    bool    is_clockwise_arc;     //
+    uint8_t relative_axes;        // Axes whose target holds the move from where the motion starts
+    int32_t line_number;          // N word
+    float   feed_rate;            // Parser feed rate and spindle speed after the line
+    float   spindle_speed;        //
+    float   target[MAX_N_AXIS];   // Absolute machine coordinates in mm, or the move in mm
+    float   offset[3];            // Arc center or spline control point offsets
+    float   radius;               // Arc radius
+    float   spline_control[2];    // G5/G5.1 second control point offset
+} gc_compiled_motion_t;
+
+// Execute a line in check mode and capture it into compiled when it is only a motion in the
+// motion mode, instead of planning it. compiled->motion is None for any other line.
+Error gc_compile_line(char* line, uint8_t client, gc_compiled_motion_t* compiled);
+
+// Plan a motion captured by gc_compile_line() from the current parser state.
+Error gc_execute_compiled(gc_compiled_motion_t* compiled);
+
+// Start and end a compiled job. position is where the parser was when the job was compiled.
+void gc_compiled_begin(const float* position);
+void gc_compiled_end();
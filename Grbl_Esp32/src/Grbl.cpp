@@ -39,6 +39,7 @@ void grbl_init() {
     report_machine_type(CLIENT_SERIAL);
 #endif
     settings_init();  // Load Grbl settings from non-volatile storage
+    plan_init();      // Allocate the planner buffer at the size given by the settings
     stepper_init();   // Configure stepper pins and interrupt timers
     system_ini();     // Configure pinout pins and pin-change interrupt (Renamed due to conflict with esp32 files)
     init_motors();
@@ -99,6 +100,7 @@ static void reset_variables() {
     coolant_init();
     limits_init();
     probe_init();
+    mc_discard_held_line();
     plan_reset();  // Clear block buffer and planner variables
     st_reset();    // Clear stepper subsystem variables
     // Sync cleared gcode and planner positions to current system position.
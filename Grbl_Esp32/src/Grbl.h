@@ -62,6 +62,7 @@ const char* const GRBL_VERSION_BUILD = "20210424";
 #include "WebUI/InputBuffer.h"
 #include "Settings.h"
 #include "SettingsDefinitions.h"
+#include "MotionConfig.h"
 #include "WebUI/WebSettings.h"
 
 #include "UserOutput.h"
@@ -72,11 +72,13 @@
 //   I2S_OUT_DMABUF_LEN / I2S_SAMPLE_SIZE x I2S_OUT_USEC_PER_PULSE
 //   = 2000 / 4 x 4
 //   = 2000us = 2ms
-// If I2S_OUT_DMABUF_COUNT is 5, it will take about 10 ms for all the DMA buffer transfers to finish.
+// If the number of DMA buffers is 5, it will take about 10 ms for all the DMA buffer transfers to finish.
 //
-// Increasing I2S_OUT_DMABUF_COUNT has the effect of preventing buffer underflow,
+// Increasing the number of DMA buffers ($Stepper/I2S/Buffers) has the effect of preventing buffer underflow,
 // but on the other hand, it leads to a delay with pulse and/or non-pulse-generated I/Os.
-// The number of I2S_OUT_DMABUF_COUNT should be chosen carefully.
+// The number of DMA buffers should be chosen carefully.
+// On a feed hold the buffers already filled play out as they are. The step data rendered after them
+// ramps down in speed (see i2s_out_hold_ramp()).
 //
 // Reference information:
 //   FreeRTOS task time slice = portTICK_PERIOD_MS = 1 ms (ESP32 FreeRTOS port)
@@ -91,6 +93,7 @@ typedef struct {
     uint32_t*    current;
     uint32_t     rw_pos;
     lldesc_t**   desc;
+    uint32_t     count;  // number of DMA buffers
     xQueueHandle queue;
 } i2s_out_dma_t;
 
@@ -126,8 +129,15 @@ static int i2s_out_initialized = 0;
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
 static volatile uint32_t             i2s_out_pulse_period;
+static volatile uint32_t             i2s_out_period_scale = I2S_OUT_PERIOD_SCALE_ONE;  // Slows the stream down in a feed hold
 static uint32_t                      i2s_out_remain_time_until_next_pulse;  // Time remaining until the next pulse (μsec)
 static volatile i2s_out_pulse_func_t i2s_out_pulse_func;
+
+// Feed hold ramp, applied as the buffers are refilled (see i2s_out_hold_ramp())
+static uint32_t i2s_out_ramp_length;     // Unscaled step time the ramp spans (μsec). Zero when no ramp is running.
+static uint32_t i2s_out_ramp_elapsed;    // Unscaled step time rendered since the ramp started (μsec)
+static float    i2s_out_ramp_c;          // (1 - r^2) / i2s_out_ramp_length, r being the speed ratio at the end
+static uint32_t i2s_out_ramp_end_scale;  // Period scale at the end of the ramp
 #endif
 
 static uint8_t i2s_out_ws_pin   = 255;
@@ -205,7 +215,7 @@ static int IRAM_ATTR i2s_clear_dma_buffer(lldesc_t* dma_desc, uint32_t port_data
 }
 
 static int IRAM_ATTR i2s_clear_o_dma_buffers(uint32_t port_data) {
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
+    for (int buf_idx = 0; buf_idx < o_dma.count; buf_idx++) {
         // Initialize DMA descriptor
         o_dma.desc[buf_idx]->owner        = 1;
         o_dma.desc[buf_idx]->eof          = 1;  // set to 1 will trigger the interrupt
@@ -214,11 +224,59 @@ static int IRAM_ATTR i2s_clear_o_dma_buffers(uint32_t port_data) {
         o_dma.desc[buf_idx]->size         = I2S_OUT_DMABUF_LEN;
         o_dma.desc[buf_idx]->buf          = (uint8_t*)o_dma.buffers[buf_idx];
         o_dma.desc[buf_idx]->offset       = 0;
-        o_dma.desc[buf_idx]->qe.stqe_next = (lldesc_t*)((buf_idx < (I2S_OUT_DMABUF_COUNT - 1)) ? (o_dma.desc[buf_idx + 1]) : o_dma.desc[0]);
+        o_dma.desc[buf_idx]->qe.stqe_next = (lldesc_t*)((buf_idx < (o_dma.count - 1)) ? (o_dma.desc[buf_idx + 1]) : o_dma.desc[0]);
         i2s_clear_dma_buffer(o_dma.desc[buf_idx], port_data);
     }
     return 0;
 }
+
+static int IRAM_ATTR i2s_out_desc_index(lldesc_t* dma_desc) {
+    for (int buf_idx = 0; buf_idx < o_dma.count; buf_idx++) {
+        if (o_dma.desc[buf_idx] == dma_desc) {
+            return buf_idx;
+        }
+    }
+    return -1;
+}
+
+static void i2s_out_free_dma(i2s_out_dma_t& dma) {
+    for (int buf_idx = 0; buf_idx < dma.count; buf_idx++) {
+        if (dma.buffers != nullptr) {
+            heap_caps_free(dma.buffers[buf_idx]);
+        }
+        if (dma.desc != nullptr) {
+            heap_caps_free(dma.desc[buf_idx]);
+        }
+    }
+    free(dma.buffers);
+    free(dma.desc);
+    dma.buffers = nullptr;
+    dma.desc    = nullptr;
+    dma.count   = 0;
+}
+
+// Allocate the DMA buffers and their descriptors. Nothing is kept if one of them does not fit.
+static int i2s_out_alloc_dma(i2s_out_dma_t& dma, uint32_t count) {
+    // Allocate the array of pointers to the buffers and the array of DMA descriptors
+    dma.count   = count;
+    dma.buffers = (uint32_t**)calloc(count, sizeof(uint32_t*));
+    dma.desc    = (lldesc_t**)calloc(count, sizeof(lldesc_t*));
+    if (dma.buffers == nullptr || dma.desc == nullptr) {
+        i2s_out_free_dma(dma);
+        return -1;
+    }
+
+    // Allocate each buffer and each DMA descriptor that will be used by the DMA controller
+    for (int buf_idx = 0; buf_idx < count; buf_idx++) {
+        dma.buffers[buf_idx] = (uint32_t*)heap_caps_calloc(1, I2S_OUT_DMABUF_LEN, MALLOC_CAP_DMA);
+        dma.desc[buf_idx]    = (lldesc_t*)heap_caps_malloc(sizeof(lldesc_t), MALLOC_CAP_DMA);
+        if (dma.buffers[buf_idx] == nullptr || dma.desc[buf_idx] == nullptr) {
+            i2s_out_free_dma(dma);
+            return -1;
+        }
+    }
+    return 0;
+}
 #endif
 
 static int IRAM_ATTR i2s_out_gpio_attach(uint8_t ws, uint8_t bck, uint8_t data) {
@@ -349,6 +407,42 @@ static int IRAM_ATTR i2s_out_start() {
 }
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
+// Hold the current pin state for the next samples of the buffer, up to the next pulse or the limit.
+// The port data is read once for the whole span, so a pin written in the meantime changes at the
+// start of the next span, at most one step period later.
+static inline void IRAM_ATTR i2s_out_fill_idle_span(uint32_t* buf, uint32_t limit) {
+    uint32_t n = i2s_out_remain_time_until_next_pulse / I2S_OUT_USEC_PER_PULSE;
+    if (n > limit - o_dma.rw_pos) {
+        n = limit - o_dma.rw_pos;
+    }
+    i2s_out_remain_time_until_next_pulse -= I2S_OUT_USEC_PER_PULSE * n;
+    if (n == 0) {
+        n = 1;  // A pulse is due but there is no callback to make it. Push one sample.
+    }
+    uint32_t  port_data = atomic_load(&i2s_out_port_data);
+    uint32_t* p         = buf + o_dma.rw_pos;
+    uint32_t* end       = p + n;
+    while (p < end) {
+        *p++ = port_data;
+    }
+    o_dma.rw_pos += n;
+}
+
+// Moves the feed hold ramp on to the speed for the step time rendered so far. Called before each
+// buffer is filled, so the speed steps down once a buffer, as the stepper does once a segment.
+static inline void IRAM_ATTR i2s_out_update_ramp() {
+    if (i2s_out_ramp_length == 0) {
+        return;
+    }
+    if (i2s_out_ramp_elapsed >= i2s_out_ramp_length) {
+        i2s_out_period_scale = i2s_out_ramp_end_scale;
+        i2s_out_ramp_length  = 0;
+        return;
+    }
+    float speed          = sqrtf(1.0f - i2s_out_ramp_c * i2s_out_ramp_elapsed);
+    i2s_out_period_scale = (uint32_t)(I2S_OUT_PERIOD_SCALE_ONE / speed);
+}
+
 // Fill out one DMA buffer
 // Call with the I2S_OUT_PULSER lock acquired.
 // Note that the lock is temporarily released while calling the callback function.
@@ -368,8 +462,12 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
         // the generation of the buffer is interrupted (the buffer length is shortened slightly)
         // and the pulse generation is postponed until the next buffer is filled.
         //
-        o_dma.rw_pos = 0;
-        while (o_dma.rw_pos < (DMA_SAMPLE_COUNT - SAMPLE_SAFE_COUNT)) {
+        // The callback pushes the pulse itself. The span from the end of the pulse to the
+        // next one is filled here in one go rather than a sample at a time.
+        //
+        const uint32_t limit = DMA_SAMPLE_COUNT - SAMPLE_SAFE_COUNT;
+        o_dma.rw_pos         = 0;
+        while (o_dma.rw_pos < limit) {
             // no data to read (buffer empty)
             if (i2s_out_remain_time_until_next_pulse < I2S_OUT_USEC_PER_PULSE) {
                 // pulser status may change in pulse phase func, so I need to check it every time.
@@ -381,7 +479,14 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
                         (*i2s_out_pulse_func)();          // should be pushed into buffer max DMA_SAMPLE_SAFE_COUNT
                         I2S_OUT_PULSER_ENTER_CRITICAL();  // Lock again.
                         // Calculate pulse period.
-                        i2s_out_remain_time_until_next_pulse += i2s_out_pulse_period - I2S_OUT_USEC_PER_PULSE * (o_dma.rw_pos - old_rw_pos);
+                        uint32_t period = i2s_out_pulse_period;
+                        if (i2s_out_ramp_length) {
+                            i2s_out_ramp_elapsed += period;
+                        }
+                        if (i2s_out_period_scale != I2S_OUT_PERIOD_SCALE_ONE) {
+                            period = ((uint64_t)period * i2s_out_period_scale) >> 16;
+                        }
+                        i2s_out_remain_time_until_next_pulse += period - I2S_OUT_USEC_PER_PULSE * (o_dma.rw_pos - old_rw_pos);
                         if (i2s_out_pulser_status == WAITING) {
                             // i2s_out_set_passthrough() has called from the pulse function.
                             // It needs to go into pass-through mode.
@@ -401,10 +506,7 @@ static int IRAM_ATTR i2s_fillout_dma_buffer(lldesc_t* dma_desc) {
                 }
             }
             // no pulse data in push buffer (pulse off or idle or callback is not defined)
-            buf[o_dma.rw_pos++] = atomic_load(&i2s_out_port_data);
-            if (i2s_out_remain_time_until_next_pulse >= I2S_OUT_USEC_PER_PULSE) {
-                i2s_out_remain_time_until_next_pulse -= I2S_OUT_USEC_PER_PULSE;
-            }
+            i2s_out_fill_idle_span(buf, limit);
         }
         // set filled length to the DMA descriptor
         dma_desc->length = o_dma.rw_pos * I2S_SAMPLE_SIZE;
@@ -447,7 +549,7 @@ static void IRAM_ATTR i2s_out_intr_handler(void* arg) {
 
         // If the queue is full it's because we have an underflow,
         // more than buf_count isr without new data, remove the front buffer
-        if (xQueueIsQueueFullFromISR(o_dma.queue)) {
+        if (uxQueueMessagesWaitingFromISR(o_dma.queue) >= o_dma.count) {
             lldesc_t* front_desc;
             // Remove a descriptor from the DMA complete event queue
             xQueueReceiveFromISR(o_dma.queue, &front_desc, &high_priority_task_awoken);
@@ -484,10 +586,16 @@ static void IRAM_ATTR i2sOutTask(void* parameter) {
         // Wait a DMA complete event from I2S isr
         // (Block until a DMA transfer has complete)
         xQueueReceive(o_dma.queue, &dma_desc, portMAX_DELAY);
-        o_dma.current = (uint32_t*)(dma_desc->buf);
         // It reuses the oldest (just transferred) buffer with the name "current"
         // and fills the buffer for later DMA.
         I2S_OUT_PULSER_ENTER_CRITICAL();  // Lock pulser status
+        int buf_idx = i2s_out_desc_index(dma_desc);
+        if (buf_idx < 0) {
+            // A buffer from before i2s_out_set_dmabuf_count(). It has been freed.
+            I2S_OUT_PULSER_EXIT_CRITICAL();
+            continue;
+        }
+        o_dma.current = (uint32_t*)(dma_desc->buf);
         if (i2s_out_pulser_status == STEPPING) {
             //
             // Fillout the buffer for pulse
@@ -499,6 +607,7 @@ static void IRAM_ATTR i2sOutTask(void* parameter) {
             // the generation of the buffer is interrupted (the buffer length is shortened slightly)
             // and the pulse generation is postponed until the next buffer is filled.
             //
+            i2s_out_update_ramp();
             i2s_fillout_dma_buffer(dma_desc);
             dma_desc->length = o_dma.rw_pos * I2S_SAMPLE_SIZE;
         } else if (i2s_out_pulser_status == WAITING) {
@@ -547,7 +656,7 @@ void IRAM_ATTR i2s_out_delay() {
     } else {
         // Just wait until the data now registered in the DMA descripter
         // is reflected in the I2S TX module via FIFO.
-        delay(I2S_OUT_DELAY_MS);
+        delay(i2s_out_delay_ms());
     }
     I2S_OUT_PULSER_EXIT_CRITICAL();
 #else
@@ -659,6 +768,8 @@ int IRAM_ATTR i2s_out_set_stepping() {
     i2s_out_stop();
     uint32_t port_data = atomic_load(&i2s_out_port_data);
     i2s_clear_o_dma_buffers(port_data);
+    i2s_out_period_scale = I2S_OUT_PERIOD_SCALE_ONE;
+    i2s_out_ramp_length  = 0;
 
     // You need to set the status before calling i2s_out_start()
     // because the process in i2s_out_start() is different depending on the status.
@@ -685,10 +796,96 @@ int IRAM_ATTR i2s_out_set_pulse_callback(i2s_out_pulse_func_t func) {
     return 0;
 }
 
+int i2s_out_set_dmabuf_count(uint32_t count) {
+#ifdef USE_I2S_OUT_STREAM_IMPL
+    if (count < I2S_OUT_DMABUF_COUNT_MIN || count > I2S_OUT_DMABUF_COUNT_MAX) {
+        return -1;
+    }
+    if (count == o_dma.count) {
+        return 0;
+    }
+    // Allocate outside the lock. The old buffers are freed once the DMA has let go of them.
+    i2s_out_dma_t new_dma = {};
+    if (i2s_out_alloc_dma(new_dma, count) < 0) {
+        return -1;
+    }
+    I2S_OUT_PULSER_ENTER_CRITICAL();
+    if (i2s_out_pulser_status != PASSTHROUGH) {
+        I2S_OUT_PULSER_EXIT_CRITICAL();
+        i2s_out_free_dma(new_dma);
+        return -1;
+    }
+    i2s_out_stop();
+    i2s_out_dma_t old_dma = o_dma;
+    o_dma.buffers         = new_dma.buffers;
+    o_dma.desc            = new_dma.desc;
+    o_dma.count           = new_dma.count;
+    o_dma.current         = NULL;
+    o_dma.rw_pos          = 0;
+    xQueueReset(o_dma.queue);
+    i2s_clear_o_dma_buffers(0);  // 0 for static I2S control mode (right ch. data is always 0)
+    i2s_out_start();
+    I2S_OUT_PULSER_EXIT_CRITICAL();
+    i2s_out_free_dma(old_dma);
+#endif
+    return 0;
+}
+
+uint32_t IRAM_ATTR i2s_out_delay_ms() {
+#ifdef USE_I2S_OUT_STREAM_IMPL
+    return I2S_OUT_DELAY_DMABUF_MS * (o_dma.count + 1);
+#else
+    return 0;
+#endif
+}
+
+uint32_t i2s_out_hold_ramp(uint32_t stop_usec, uint32_t ramp_usec) {
+#ifdef USE_I2S_OUT_STREAM_IMPL
+    if (stop_usec == 0 || ramp_usec == 0) {
+        return I2S_OUT_PERIOD_SCALE_ONE;
+    }
+    // The speed ratio r at the end of the ramp. Slowing down linearly in time from 1 to r over the
+    // step time T takes 2 * T / (1 + r) and must not be quicker than a full stop from stop_usec would
+    // allow. At most about half speed, so that the stream does not crawl through the segments left.
+    float r2 = 1.0f - 2.0f * ramp_usec / stop_usec;
+    if (r2 < 0.3f) {
+        r2 = 0.3f;
+    }
+    float r = sqrtf(r2);
+    if (r > 0.99f) {
+        return I2S_OUT_PERIOD_SCALE_ONE;
+    }
+    uint32_t scale = (uint32_t)(I2S_OUT_PERIOD_SCALE_ONE / r);
+    I2S_OUT_PULSER_ENTER_CRITICAL();
+    if (i2s_out_pulser_status != STEPPING) {
+        I2S_OUT_PULSER_EXIT_CRITICAL();
+        return I2S_OUT_PERIOD_SCALE_ONE;
+    }
+    i2s_out_ramp_c         = (1.0f - r2) / ramp_usec;
+    i2s_out_ramp_elapsed   = 0;
+    i2s_out_ramp_end_scale = scale;
+    i2s_out_ramp_length    = ramp_usec;
+    I2S_OUT_PULSER_EXIT_CRITICAL();
+    return scale;
+#else
+    return I2S_OUT_PERIOD_SCALE_ONE;
+#endif
+}
+
+int IRAM_ATTR i2s_out_set_period_scale(uint32_t scale) {
+#ifdef USE_I2S_OUT_STREAM_IMPL
+    i2s_out_ramp_length  = 0;
+    i2s_out_period_scale = scale;
+#endif
+    return 0;
+}
+
 int IRAM_ATTR i2s_out_reset() {
     I2S_OUT_PULSER_ENTER_CRITICAL();
     i2s_out_stop();
 #ifdef USE_I2S_OUT_STREAM_IMPL
+    i2s_out_period_scale = I2S_OUT_PERIOD_SCALE_ONE;
+    i2s_out_ramp_length  = 0;
     if (i2s_out_pulser_status == STEPPING) {
         uint32_t port_data = atomic_load(&i2s_out_port_data);
         i2s_clear_o_dma_buffers(port_data);
@@ -748,39 +945,17 @@ int IRAM_ATTR i2s_out_init(i2s_out_init_t& init_param) {
    */
 
 #ifdef USE_I2S_OUT_STREAM_IMPL
-    // Allocate the array of pointers to the buffers
-    o_dma.buffers = (uint32_t**)malloc(sizeof(uint32_t*) * I2S_OUT_DMABUF_COUNT);
-    if (o_dma.buffers == nullptr) {
+    // Allocate the DMA buffers. $Stepper/I2S/Buffers is not loaded yet, so start with the default number.
+    // stepper_init() changes it later.
+    if (i2s_out_alloc_dma(o_dma, I2S_OUT_DMABUF_COUNT) < 0) {
         return -1;
     }
 
-    // Allocate each buffer that can be used by the DMA controller
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
-        o_dma.buffers[buf_idx] = (uint32_t*)heap_caps_calloc(1, I2S_OUT_DMABUF_LEN, MALLOC_CAP_DMA);
-        if (o_dma.buffers[buf_idx] == nullptr) {
-            return -1;
-        }
-    }
-
-    // Allocate the array of DMA descriptors
-    o_dma.desc = (lldesc_t**)malloc(sizeof(lldesc_t*) * I2S_OUT_DMABUF_COUNT);
-    if (o_dma.desc == nullptr) {
-        return -1;
-    }
-
-    // Allocate each DMA descriptor that will be used by the DMA controller
-    for (int buf_idx = 0; buf_idx < I2S_OUT_DMABUF_COUNT; buf_idx++) {
-        o_dma.desc[buf_idx] = (lldesc_t*)heap_caps_malloc(sizeof(lldesc_t), MALLOC_CAP_DMA);
-        if (o_dma.desc[buf_idx] == nullptr) {
-            return -1;
-        }
-    }
-
     // Initialize
     i2s_clear_o_dma_buffers(init_param.init_val);
     o_dma.rw_pos  = 0;
     o_dma.current = NULL;
-    o_dma.queue   = xQueueCreate(I2S_OUT_DMABUF_COUNT, sizeof(uint32_t*));
+    o_dma.queue   = xQueueCreate(I2S_OUT_DMABUF_COUNT_MAX, sizeof(uint32_t*));  // Room for any number of buffers
 
     // Set the first DMA descriptor
     I2S0.out_link.addr = (uint32_t)o_dma.desc[0];
@@ -58,11 +58,15 @@
 /* 32-bit mode: 1000000 usec / ((160000000 Hz) /  5 / 2) x 32 bit/pulse x 2(stereo) = 4 usec/pulse */
 const int I2S_OUT_USEC_PER_PULSE = 4;
 
-const int I2S_OUT_DMABUF_COUNT = 5;    /* number of DMA buffers to store data */
-const int I2S_OUT_DMABUF_LEN   = 2000; /* maximum size in bytes (4092 is DMA's limit) */
+const int I2S_OUT_DMABUF_COUNT     = 5;  /* default number of DMA buffers to store data ($Stepper/I2S/Buffers) */
+const int I2S_OUT_DMABUF_COUNT_MIN = 3;
+const int I2S_OUT_DMABUF_COUNT_MAX = 16;
+const int I2S_OUT_DMABUF_LEN       = 2000; /* maximum size in bytes (4092 is DMA's limit) */
 
 const int I2S_OUT_DELAY_DMABUF_MS = (I2S_OUT_DMABUF_LEN / sizeof(uint32_t) * I2S_OUT_USEC_PER_PULSE / 1000);
-const int I2S_OUT_DELAY_MS        = (I2S_OUT_DELAY_DMABUF_MS * (I2S_OUT_DMABUF_COUNT + 1));
+
+/* Fixed point (16.16) scale of the step periods while a feed hold slows the stream down */
+const uint32_t I2S_OUT_PERIOD_SCALE_ONE = 0x10000;
 
 typedef void (*i2s_out_pulse_func_t)(void);
 
@@ -160,6 +164,37 @@ void i2s_out_delay();
  */
 int i2s_out_set_pulse_period(uint32_t usec);
 
+/*
+   Change the number of DMA buffers (I2S_OUT_DMABUF_COUNT_MIN .. I2S_OUT_DMABUF_COUNT_MAX).
+   Only possible in the passthrough mode.
+   return -1 ... stepping, or out of memory (the old buffers are kept)
+ */
+int i2s_out_set_dmabuf_count(uint32_t count);
+
+/*
+   Time in milliseconds for a change of the shift register pins to get through the DMA buffers
+   when streaming.
+ */
+uint32_t i2s_out_delay_ms();
+
+/*
+   Start a feed hold deceleration in the step data still to be rendered into the DMA buffers.
+   The buffers already filled are left alone. As the following ones are filled, the step periods
+   are scaled so that the step rate ramps down from full speed towards at most about half speed
+   over ramp_usec of step time, in no less than stop_usec for a full stop. The step periods after
+   the ramp keep its end scale until i2s_out_set_period_scale() is called.
+   stop_usec: the time the machine would take to stop from its current speed
+   ramp_usec: the step time, at full speed, of the steps the ramp is spread over
+   return: the period scale at the end of the ramp (16.16 fixed point),
+           I2S_OUT_PERIOD_SCALE_ONE when nothing was changed
+ */
+uint32_t i2s_out_hold_ramp(uint32_t stop_usec, uint32_t ramp_usec);
+
+/*
+   Set the scale of the step periods (16.16 fixed point). Ends the feed hold ramp, if any.
+ */
+int i2s_out_set_period_scale(uint32_t scale);
+
 /*
    Register a callback function to generate pulse data
  */
@@ -210,7 +210,7 @@ void limits_go_home(uint8_t cycle_mask) {
 #ifdef USE_I2S_STEPS
         if (current_stepper == ST_I2S_STREAM) {
             if (!approach) {
-                delay_ms(I2S_OUT_DELAY_MS);
+                delay_ms(i2s_out_delay_ms());
             }
         }
 #endif
@@ -382,27 +382,21 @@ void limitCheckTask(void* pvParameters) {
 }
 
 float limitsMaxPosition(uint8_t axis) {
-    float mpos = axis_settings[axis]->home_mpos->get();
-
-    return bitnum_istrue(homing_dir_mask->get(), axis) ? mpos + axis_settings[axis]->max_travel->get() : mpos;
+    return motion_config->travel_max[axis];
 }
 
 float limitsMinPosition(uint8_t axis) {
-    float mpos = axis_settings[axis]->home_mpos->get();
-
-    return bitnum_istrue(homing_dir_mask->get(), axis) ? mpos : mpos - axis_settings[axis]->max_travel->get();
+    return motion_config->travel_min[axis];
 }
 
 // Checks and reports if target array exceeds machine travel limits.
 // Return true if exceeding limits
 // Set $<axis>/MaxTravel=0 to selectively remove an axis from soft limit checks
 bool __attribute__((weak)) limitsCheckTravel(float* target) {
-    uint8_t idx;
-    auto    n_axis = number_axis->get();
-    for (idx = 0; idx < n_axis; idx++) {
-        float max_mpos, min_mpos;
-
-        if ((target[idx] < limitsMinPosition(idx) || target[idx] > limitsMaxPosition(idx)) && axis_settings[idx]->max_travel->get() > 0) {
+    uint8_t             idx;
+    const MotionConfig* config = motion_config;
+    for (idx = 0; idx < config->n_axis; idx++) {
+        if ((target[idx] < config->travel_min[idx] || target[idx] > config->travel_max[idx]) && config->max_travel[idx] > 0) {
             return true;
         }
     }
@@ -0,0 +1,65 @@
+/*
+  MotionConfig.cpp - snapshot of the settings used by the motion hot paths
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// Two buffers, so the one being rebuilt is never the one readers are using. Settings change
+// one at a time from the main task, long after any reader of the older buffer has finished.
+static DRAM_ATTR MotionConfig motion_config_buffers[2];
+static uint8_t                motion_config_spare = 0;
+
+const MotionConfig* volatile motion_config = &motion_config_buffers[1];
+
+void motion_config_update() {
+    MotionConfig* config = &motion_config_buffers[motion_config_spare];
+
+    config->n_axis                       = number_axis->get();
+    config->pulse_microseconds           = pulse_microseconds->get();
+    config->direction_delay_microseconds = direction_delay_microseconds->get();
+    config->junction_deviation           = junction_deviation->get();
+
+    auto dir_mask = homing_dir_mask->get();
+    for (uint8_t axis = 0; axis < MAX_N_AXIS; axis++) {
+        AxisSettings* a              = axis_settings[axis];
+        config->steps_per_mm[axis]   = a->steps_per_mm->get();
+        config->mm_per_step[axis]    = 1.0 / config->steps_per_mm[axis];
+        config->max_rate[axis]       = a->max_rate->get();
+        config->acceleration[axis]   = a->acceleration->get() * SEC_PER_MIN_SQ;
+        config->jerk[axis]           = a->jerk->get() * SEC_PER_MIN_CU;
+        config->max_travel[axis]     = a->max_travel->get();
+        float mpos                   = a->home_mpos->get();
+        if (bitnum_istrue(dir_mask, axis)) {
+            config->travel_min[axis] = mpos;
+            config->travel_max[axis] = mpos + config->max_travel[axis];
+        } else {
+            config->travel_min[axis] = mpos - config->max_travel[axis];
+            config->travel_max[axis] = mpos;
+        }
+    }
+
+    __sync_synchronize();          // Complete the new values before publishing them.
+    motion_config       = config;  // A pointer store is atomic on the ESP32.
+    motion_config_spare = !motion_config_spare;
+}
+
+bool postMotionSetting(char* value) {
+    if (!value) {
+        motion_config_update();
+    }
+    return true;
+}
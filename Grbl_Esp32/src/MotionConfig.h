@@ -0,0 +1,51 @@
+#pragma once
+
+/*
+  MotionConfig.h - snapshot of the settings used by the motion hot paths
+  Part of Grbl_ESP32
+
+  Grbl is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  Grbl is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "Grbl.h"
+
+// Settings read by the step ISR, the segment generator, the planner and the soft limit checks,
+// copied into one flat struct with the unit conversions and reciprocals already applied. Each
+// reader loads the motion_config pointer once and then works from plain fields, instead of
+// chasing a pointer per setting and redoing the conversions on every block or step.
+struct MotionConfig {
+    uint8_t  n_axis;
+    uint32_t pulse_microseconds;            // $0
+    uint32_t direction_delay_microseconds;  // $Stepper/Direction/Delay
+    float    junction_deviation;            // $11 (mm)
+
+    float steps_per_mm[MAX_N_AXIS];  // $100-$105
+    float mm_per_step[MAX_N_AXIS];   // Reciprocal of steps_per_mm
+    float max_rate[MAX_N_AXIS];      // $110-$115 (mm/min)
+    float acceleration[MAX_N_AXIS];  // $120-$125 converted to (mm/min^2)
+    float jerk[MAX_N_AXIS];          // <axis>/Jerk converted to (mm/min^3). Zero if not limited.
+    float max_travel[MAX_N_AXIS];    // $130-$135 (mm)
+    float travel_min[MAX_N_AXIS];    // Soft limit minimum machine position (mm)
+    float travel_max[MAX_N_AXIS];    // Soft limit maximum machine position (mm)
+};
+
+// The current snapshot. It is rebuilt in a spare buffer and published by a single pointer store,
+// so a reader, including the step ISR, always sees one complete and consistent set of values.
+extern const MotionConfig* volatile motion_config;
+
+// Rebuilds and publishes the snapshot from the current settings.
+void motion_config_update();
+
+// Setting checker that republishes the snapshot after a motion setting changes.
+bool postMotionSetting(char* value);
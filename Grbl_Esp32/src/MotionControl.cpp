@@ -33,6 +33,175 @@
 
 SquaringMode ganged_mode = SquaringMode::Dual;
 
+// Line motion held back by mc_line() so that following collinear lines can be merged into it.
+// See COALESCE_MAX_LINES in Config.h.
+typedef struct {
+    uint8_t          count;                                       // Lines merged into the held line. Zero if none held.
+    int64_t          time;                                        // esp_timer_get_time() of the last merge (usec)
+    float            start[MAX_N_AXIS];                           // Start of the held line (mm)
+    float            target[MAX_N_AXIS];                          // End of the held line (mm)
+    float            points[COALESCE_MAX_LINES - 1][MAX_N_AXIS];  // Ends of the merged lines before target (mm)
+    plan_line_data_t pl_data;                                     // Planner data of the held line
+} mc_held_line_t;
+static mc_held_line_t held_line;
+
+// Arc or spline that mc_arc() or mc_spline() cuts into line segments. The segments are planned as
+// the planner buffer has room for them, so that the main loop keeps serving the clients while a
+// long curve runs.
+typedef struct {
+    void (*plan_segment)();                          // Plans the next segment. NULL if no curve in progress.
+    bool             planning;                       // Segments are being planned. Guards against reentry.
+    uint8_t          axis_0;                         // First axis of the curve plane
+    uint8_t          axis_1;                         // Second axis of the curve plane
+    float            original_feedrate;              // Feed rate of the segments, which kinematics may alter
+    float            position[MAX_N_AXIS];           // End of the last segment planned (mm)
+    float            previous_position[MAX_N_AXIS];  // Start of the next segment (mm)
+    float            target[MAX_N_AXIS];             // End of the curve (mm)
+    plan_line_data_t pl_data;                        // Planner data of the segments
+    // Arc
+    uint16_t segments;            // Segments of the arc, the last one included
+    uint16_t i;                   // Segment to plan next, from 1 to segments
+    uint8_t  count;               // Segments since the last exact radius vector correction
+    uint8_t  axis_linear;         // Axis of helical travel
+    float    center_axis0;        // Center of the arc in the plane (mm)
+    float    center_axis1;
+    float    offset_axis0;        // Offset from the start of the arc to the center (mm)
+    float    offset_axis1;
+    float    r_axis0;             // Radius vector from the center to the last segment end (mm)
+    float    r_axis1;
+    float    theta_per_segment;   // Angle of one segment (radians)
+    float    sin_T;               // Approximate sine and cosine of theta_per_segment
+    float    cos_T;
+    float    linear_per_segment;  // Helical travel of one segment (mm)
+    // Spline
+    float t;                  // Curve parameter at the end of the last segment, from 0 to 1
+    float bezier[4][2];       // Bezier control points in the plane (mm)
+    float start[MAX_N_AXIS];  // Start of the spline (mm)
+} mc_curve_t;
+static mc_curve_t curve;
+
+static void mc_plan_curve(bool wait);
+
+uint32_t mc_lines_in;    // Line motions received by mc_line()
+uint32_t mc_blocks_out;  // Line motions sent to the planner by mc_line()
+
+// Waits for room in the planner buffer, then plans the line.
+static bool mc_plan_line(float* target, plan_line_data_t* pl_data) {
+    bool submitted_result = false;
+    // store the plan data so it can be cancelled by the protocol system if needed
+    sys_pl_data_inflight = pl_data;
+    // If the buffer is full: good! That means we are well ahead of the robot.
+    // Remain in this loop until there is room in the buffer.
+    do {
+        protocol_execute_realtime();  // Check for any run-time commands
+        if (sys.abort) {
+            sys_pl_data_inflight = NULL;
+            return submitted_result;  // Bail, if system abort.
+        }
+        if (plan_check_full_buffer()) {
+            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
+        } else {
+            break;
+        }
+    } while (1);
+    // Plan and queue motion into planner buffer
+    // uint8_t plan_status; // Not used in normal operation.
+    if (sys_pl_data_inflight == pl_data) {
+        plan_buffer_line(target, pl_data);
+        submitted_result = true;
+        mc_blocks_out++;
+    }
+    sys_pl_data_inflight = NULL;
+    return submitted_result;
+}
+
+// Only ordinary feed and rapid motions are merged. Inverse time feed rates depend on the line length.
+static bool mc_can_hold_line(plan_line_data_t* pl_data) {
+    return coalesce_tolerance->get() > 0.0 && !pl_data->is_jog && !pl_data->motion.systemMotion && !pl_data->motion.inverseTime;
+}
+
+// Feed, spindle and coolant state changes always start a new planner block.
+static bool mc_same_line_data(plan_line_data_t* a, plan_line_data_t* b) {
+    return a->feed_rate == b->feed_rate && a->spindle_speed == b->spindle_speed && a->spindle == b->spindle &&
+           a->coolant.Mist == b->coolant.Mist && a->coolant.Flood == b->coolant.Flood && a->path_tolerance == b->path_tolerance &&
+           a->motion.rapidMotion == b->motion.rapidMotion && a->motion.noFeedOverride == b->motion.noFeedOverride;
+}
+
+// Extends the held line to target if every point it passes through lies within the coalescing
+// tolerance of the new chord and the points progress along the chord, so that reversals are
+// never merged away. Returns false, leaving the held line unchanged, otherwise.
+static bool mc_extend_held_line(float* target, plan_line_data_t* pl_data) {
+    if (held_line.count >= COALESCE_MAX_LINES || !mc_same_line_data(&held_line.pl_data, pl_data)) {
+        return false;
+    }
+    uint8_t idx;
+    auto    n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : number_axis->get();
+    float   chord[MAX_N_AXIS];
+    float   length_sq = 0.0;
+    for (idx = 0; idx < n_axis; idx++) {
+        chord[idx] = target[idx] - held_line.start[idx];
+        length_sq += chord[idx] * chord[idx];
+    }
+    if (length_sq == 0.0) {
+        return false;
+    }
+    float inv_length   = 1.0 / sqrt(length_sq);
+    float tolerance    = coalesce_tolerance->get();
+    float tolerance_sq = tolerance * tolerance;
+    float previous     = 0.0;
+    for (uint8_t i = 0; i < held_line.count; i++) {
+        float* point   = (i + 1 < held_line.count) ? held_line.points[i] : held_line.target;
+        float  along   = 0.0;  // Distance of the point along the chord
+        float  dist_sq = 0.0;  // Squared distance of the point from the start
+        for (idx = 0; idx < n_axis; idx++) {
+            float delta = point[idx] - held_line.start[idx];
+            along += delta * chord[idx];
+            dist_sq += delta * delta;
+        }
+        along *= inv_length;
+        if (along <= previous || along * along >= length_sq) {
+            return false;
+        }
+        if (dist_sq - along * along > tolerance_sq) {
+            return false;
+        }
+        previous = along;
+    }
+    memcpy(held_line.points[held_line.count - 1], held_line.target, sizeof(held_line.target));
+    memcpy(held_line.target, target, sizeof(held_line.target));
+#ifdef USE_LINE_NUMBERS
+    held_line.pl_data.line_number = pl_data->line_number;
+#endif
+    held_line.count++;
+    held_line.time = esp_timer_get_time();
+    return true;
+}
+
+// Finishes the arc or spline in progress, if any, and sends the held line, if any, to the planner.
+void mc_flush_held_line() {
+    mc_plan_curve(true);
+    if (held_line.count) {
+        held_line.count = 0;  // Clear first, since planning may run realtime commands that flush again.
+        mc_plan_line(held_line.target, &held_line.pl_data);
+    }
+}
+
+// Sends the held line, if any, to the planner when the stepper is running its last planned block or
+// no line was merged into it for COALESCE_FLUSH_MS. Called whenever there is no more input to parse.
+void mc_flush_stale_held_line() {
+    if (held_line.count &&
+        (plan_get_block_buffer_count() <= 1 || esp_timer_get_time() - held_line.time >= int64_t(COALESCE_FLUSH_MS) * 1000)) {
+        mc_flush_held_line();
+    }
+}
+
+// Drops the held line and the rest of the arc or spline in progress. Called on reset, when the
+// planner position is resynchronized.
+void mc_discard_held_line() {
+    held_line.count    = 0;
+    curve.plan_segment = NULL;
+}
+
 // Execute linear motion in absolute millimeter coordinates. Feed rate given in millimeters/second
 // unless invert_feed_rate is true. Then the feed_rate means that the motion should be completed in
 // (1 minute)/feed_rate time.
@@ -42,6 +211,7 @@ SquaringMode ganged_mode = SquaringMode::Dual;
 // in the planner and to let backlash compensation or canned cycle integration simple and direct.
 // returns true if line was submitted to planner, or false if intentionally dropped.
 bool mc_line(float* target, plan_line_data_t* pl_data) {
+    mc_plan_curve(true);  // A new motion starts where the arc or spline in progress, if any, ends.
     bool submitted_result = false;
     // store the plan data so it can be cancelled by the protocol system if needed
     sys_pl_data_inflight = pl_data;
@@ -58,6 +228,7 @@ bool mc_line(float* target, plan_line_data_t* pl_data) {
         sys_pl_data_inflight = NULL;
         return submitted_result;
     }
+    mc_lines_in++;
     // NOTE: Backlash compensation may be installed here. It will need direction info to track when
     // to insert a backlash line motion(s) before the intended line motion and will require its own
     // plan_check_full_buffer() and check for system abort loop. Also for position reporting
@@ -71,28 +242,25 @@ bool mc_line(float* target, plan_line_data_t* pl_data) {
     // indicates to Grbl what is a backlash compensation motion, so that Grbl executes the move but
     // doesn't update the machine position values. Since the position values used by the g-code
     // parser and planner are separate from the system machine positions, this is doable.
-    // If the buffer is full: good! That means we are well ahead of the robot.
-    // Remain in this loop until there is room in the buffer.
-    do {
-        protocol_execute_realtime();  // Check for any run-time commands
-        if (sys.abort) {
-            sys_pl_data_inflight = NULL;
-            return submitted_result;  // Bail, if system abort.
+    if (mc_can_hold_line(pl_data)) {
+        sys_pl_data_inflight = NULL;
+        if (held_line.count && mc_extend_held_line(target, pl_data)) {
+            return true;
         }
-        if (plan_check_full_buffer()) {
-            protocol_auto_cycle_start();  // Auto-cycle start when buffer is full.
-        } else {
-            break;
+        // Start a new held line where the planner, after the previous held line, leaves off.
+        mc_flush_held_line();
+        if (sys.abort) {
+            return submitted_result;
         }
-    } while (1);
-    // Plan and queue motion into planner buffer
-    // uint8_t plan_status; // Not used in normal operation.
-    if (sys_pl_data_inflight == pl_data) {
-        plan_buffer_line(target, pl_data);
-        submitted_result = true;
+        plan_get_planner_mpos(held_line.start);
+        memcpy(held_line.target, target, sizeof(held_line.target));
+        memcpy(&held_line.pl_data, pl_data, sizeof(plan_line_data_t));
+        held_line.count = 1;
+        held_line.time  = esp_timer_get_time();
+        return true;
     }
-    sys_pl_data_inflight = NULL;
-    return submitted_result;
+    mc_flush_held_line();
+    return mc_plan_line(target, pl_data);
 }
 
 bool __attribute__((weak)) cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position) {
@@ -110,6 +278,64 @@ void __attribute__((weak)) motors_to_cartesian(float* cartesian, float* motors,
 }
 
 void __attribute__((weak)) forward_kinematics(float* position) {}
+
+// Plans the next segment of the arc in progress. The last segment ends exactly at the arc target.
+static void mc_plan_arc_segment() {
+    if (curve.i < curve.segments) {
+        if (curve.count < N_ARC_CORRECTION) {
+            // Apply vector rotation matrix. ~40 usec
+            float r_axisi = curve.r_axis0 * curve.sin_T + curve.r_axis1 * curve.cos_T;
+            curve.r_axis0 = curve.r_axis0 * curve.cos_T - curve.r_axis1 * curve.sin_T;
+            curve.r_axis1 = r_axisi;
+            curve.count++;
+        } else {
+            // Arc correction to radius vector. Computed only every N_ARC_CORRECTION increments. ~375 usec
+            // Compute exact location by applying transformation matrix from initial radius vector(=-offset).
+            float cos_Ti  = cos(curve.i * curve.theta_per_segment);
+            float sin_Ti  = sin(curve.i * curve.theta_per_segment);
+            curve.r_axis0 = -curve.offset_axis0 * cos_Ti + curve.offset_axis1 * sin_Ti;
+            curve.r_axis1 = -curve.offset_axis0 * sin_Ti - curve.offset_axis1 * cos_Ti;
+            curve.count   = 0;
+        }
+        // Update arc_target location
+        curve.position[curve.axis_0] = curve.center_axis0 + curve.r_axis0;
+        curve.position[curve.axis_1] = curve.center_axis1 + curve.r_axis1;
+        curve.position[curve.axis_linear] += curve.linear_per_segment;
+        curve.pl_data.feed_rate = curve.original_feedrate;  // This restores the feedrate kinematics may have altered
+        cartesian_to_motors(curve.position, &curve.pl_data, curve.previous_position);
+        curve.previous_position[curve.axis_0]      = curve.position[curve.axis_0];
+        curve.previous_position[curve.axis_1]      = curve.position[curve.axis_1];
+        curve.previous_position[curve.axis_linear] = curve.position[curve.axis_linear];
+        curve.i++;
+    } else {
+        // Ensure last segment arrives at target location.
+        curve.plan_segment      = NULL;
+        curve.pl_data.feed_rate = curve.original_feedrate;
+        cartesian_to_motors(curve.target, &curve.pl_data, curve.previous_position);
+    }
+    // Bail mid-circle on system abort. Runtime command check already performed by mc_line.
+    if (sys.abort) {
+        curve.plan_segment = NULL;
+    }
+}
+
+// Plans segments of the arc or spline in progress until the planner buffer is full or, if wait
+// is true, until the curve is done.
+static void mc_plan_curve(bool wait) {
+    if (curve.planning) {
+        return;  // Segments being planned already. Reached from mc_line() through the segment itself.
+    }
+    curve.planning = true;
+    while (curve.plan_segment && (wait || !plan_check_full_buffer())) {
+        curve.plan_segment();
+    }
+    curve.planning = false;
+}
+
+void mc_continue_curve() {
+    mc_plan_curve(false);
+}
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_X defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, isclockwise boolean. Used
@@ -117,6 +343,8 @@ void __attribute__((weak)) forward_kinematics(float* position) {}
 // The arc is approximated by generating a huge number of tiny, linear segments. The chordal tolerance
 // of each segment is configured in the arc_tolerance setting, which is defined to be the maximum normal
 // distance from segment to the circle when the end points both lie on the circle.
+// Only the segments that fit in the planner buffer are planned here. mc_continue_curve() plans the
+// rest as the buffer drains, and any following motion or buffer sync finishes the arc first.
 void mc_arc(float*            target,
             plan_line_data_t* pl_data,
             float*            position,
@@ -126,6 +354,10 @@ void mc_arc(float*            target,
             uint8_t           axis_1,
             uint8_t           axis_linear,
             uint8_t           is_clockwise_arc) {
+    mc_plan_curve(true);  // Finish the previous arc or spline, if any.
+    if (sys.abort) {
+        return;
+    }
     float center_axis0 = position[axis_0] + offset[axis_0];
     float center_axis1 = position[axis_1] + offset[axis_1];
     float r_axis0      = -offset[axis_0];  // Radius vector from center to current location
@@ -133,13 +365,11 @@ void mc_arc(float*            target,
     float rt_axis0     = target[axis_0] - center_axis0;
     float rt_axis1     = target[axis_1] - center_axis1;
 
-    float previous_position[MAX_N_AXIS] = { 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
-
-    uint16_t n;
-    auto     n_axis = number_axis->get();
-    for (n = 0; n < n_axis; n++) {
-        previous_position[n] = position[n];
-    }
+    auto n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : number_axis->get();
+    memset(curve.previous_position, 0, sizeof(curve.previous_position));
+    memcpy(curve.previous_position, position, n_axis * sizeof(position[0]));
+    memcpy(curve.position, curve.previous_position, sizeof(curve.position));
+    memcpy(curve.target, target, sizeof(curve.target));
     // CCW angle between position and target from circle center. Only one atan2() trig computation required.
     float angular_travel = atan2(r_axis0 * rt_axis1 - r_axis1 * rt_axis0, r_axis0 * rt_axis0 + r_axis1 * rt_axis1);
     if (is_clockwise_arc) {  // Correct atan2 output per direction
@@ -155,17 +385,32 @@ void mc_arc(float*            target,
     // (2x) arc_tolerance. For 99% of users, this is just fine. If a different arc segment fit
     // is desired, i.e. least-squares, midpoint on arc, just change the mm_per_arc_segment calculation.
     // For the intended uses of Grbl, this value shouldn't exceed 2000 for the strictest of cases.
-    uint16_t segments = floor(fabs(0.5 * angular_travel * radius) / sqrt(arc_tolerance->get() * (2 * radius - arc_tolerance->get())));
+    float    arc_length = fabs(angular_travel * radius);
+    uint16_t segments   = floor(0.5 * arc_length / sqrt(arc_tolerance->get() * (2 * radius - arc_tolerance->get())));
+    // Segments need not be shorter than the arc runs in ARC_MIN_SEGMENT_TIME. The arc runs at the
+    // feed rate at most, and at the speed where the centripetal acceleration reaches the smaller
+    // acceleration of the plane axes. See ARC_MIN_SEGMENT_TIME in Config.h for the error this adds.
+    if (segments && ARC_MIN_SEGMENT_TIME > 0) {
+        const MotionConfig* config       = motion_config;
+        float               acceleration = MIN(config->acceleration[axis_0], config->acceleration[axis_1]);  // (mm/min^2)
+        float               speed        = sqrt(acceleration * radius);                                       // (mm/min)
+        float               feed_rate    = pl_data->motion.inverseTime ? pl_data->feed_rate * arc_length : pl_data->feed_rate;
+        float               min_length   = MIN(speed, feed_rate) * (ARC_MIN_SEGMENT_TIME / 60.0);
+        if (min_length > 0 && arc_length / min_length < segments) {
+            segments = ceil(arc_length / min_length);
+        }
+    }
+    memcpy(&curve.pl_data, pl_data, sizeof(plan_line_data_t));
     if (segments) {
         // Multiply inverse feed_rate to compensate for the fact that this movement is approximated
         // by a number of discrete segments. The inverse feed_rate should be correct for the sum of
         // all segments.
-        if (pl_data->motion.inverseTime) {
-            pl_data->feed_rate *= segments;
-            pl_data->motion.inverseTime = 0;  // Force as feed absolute mode over arc segments.
+        if (curve.pl_data.motion.inverseTime) {
+            curve.pl_data.feed_rate *= segments;
+            curve.pl_data.motion.inverseTime = 0;  // Force as feed absolute mode over arc segments.
         }
-        float theta_per_segment  = angular_travel / segments;
-        float linear_per_segment = (target[axis_linear] - position[axis_linear]) / segments;
+        curve.theta_per_segment  = angular_travel / segments;
+        curve.linear_per_segment = (target[axis_linear] - position[axis_linear]) / segments;
         /* Vector rotation by transformation matrix: r is the original vector, r_T is the rotated vector,
            and phi is the angle of rotation. Solution approach by Jens Geisler.
                r_T = [cos(phi) -sin(phi);
@@ -192,48 +437,162 @@ void mc_arc(float*            target,
            This is important when there are successive arc motions.
         */
         // Computes: cos_T = 1 - theta_per_segment^2/2, sin_T = theta_per_segment - theta_per_segment^3/6) in ~52usec
-        float cos_T = 2.0 - theta_per_segment * theta_per_segment;
-        float sin_T = theta_per_segment * 0.16666667 * (cos_T + 4.0);
-        cos_T *= 0.5;
-        float    sin_Ti;
-        float    cos_Ti;
-        float    r_axisi;
-        uint16_t i;
-        uint8_t  count             = 0;
-        float    original_feedrate = pl_data->feed_rate;  // Kinematics may alter the feedrate, so save an original copy
-        for (i = 1; i < segments; i++) {                  // Increment (segments-1).
-            if (count < N_ARC_CORRECTION) {
-                // Apply vector rotation matrix. ~40 usec
-                r_axisi = r_axis0 * sin_T + r_axis1 * cos_T;
-                r_axis0 = r_axis0 * cos_T - r_axis1 * sin_T;
-                r_axis1 = r_axisi;
-                count++;
-            } else {
-                // Arc correction to radius vector. Computed only every N_ARC_CORRECTION increments. ~375 usec
-                // Compute exact location by applying transformation matrix from initial radius vector(=-offset).
-                cos_Ti  = cos(i * theta_per_segment);
-                sin_Ti  = sin(i * theta_per_segment);
-                r_axis0 = -offset[axis_0] * cos_Ti + offset[axis_1] * sin_Ti;
-                r_axis1 = -offset[axis_0] * sin_Ti - offset[axis_1] * cos_Ti;
-                count   = 0;
-            }
-            // Update arc_target location
-            position[axis_0] = center_axis0 + r_axis0;
-            position[axis_1] = center_axis1 + r_axis1;
-            position[axis_linear] += linear_per_segment;
-            pl_data->feed_rate = original_feedrate;  // This restores the feedrate kinematics may have altered
-            cartesian_to_motors(position, pl_data, previous_position);
-            previous_position[axis_0]      = position[axis_0];
-            previous_position[axis_1]      = position[axis_1];
-            previous_position[axis_linear] = position[axis_linear];
-            // Bail mid-circle on system abort. Runtime command check already performed by mc_line.
-            if (sys.abort) {
-                return;
+        curve.cos_T = 2.0 - curve.theta_per_segment * curve.theta_per_segment;
+        curve.sin_T = curve.theta_per_segment * 0.16666667 * (curve.cos_T + 4.0);
+        curve.cos_T *= 0.5;
+    }
+    curve.axis_0            = axis_0;
+    curve.axis_1            = axis_1;
+    curve.axis_linear       = axis_linear;
+    curve.center_axis0      = center_axis0;
+    curve.center_axis1      = center_axis1;
+    curve.offset_axis0      = offset[axis_0];
+    curve.offset_axis1      = offset[axis_1];
+    curve.r_axis0           = r_axis0;
+    curve.r_axis1           = r_axis1;
+    curve.original_feedrate = curve.pl_data.feed_rate;  // Kinematics may alter the feedrate, so save an original copy
+    curve.count             = 0;
+    curve.i                 = 1;
+    curve.segments          = segments ? segments : 1;  // The last segment, to target, is always planned.
+    curve.plan_segment      = mc_plan_arc_segment;
+    mc_plan_curve(false);
+}
+
+// Point of the spline in progress, in its plane, at curve parameter t.
+static void mc_spline_point(float t, float* point) {
+    float s  = 1.0 - t;
+    float b0 = s * s * s;
+    float b1 = 3.0 * s * s * t;
+    float b2 = 3.0 * s * t * t;
+    float b3 = t * t * t;
+    for (uint8_t k = 0; k < 2; k++) {
+        point[k] = b0 * curve.bezier[0][k] + b1 * curve.bezier[1][k] + b2 * curve.bezier[2][k] + b3 * curve.bezier[3][k];
+    }
+}
+
+// Parameter step from t to the end of the next spline segment, so that the segment stays within
+// arc_tolerance of the curve. Sharp bends get short segments and straight stretches long ones.
+static float mc_spline_step(float t) {
+    const float min_step  = 1.0 / 4096;  // Bounds the segments of one spline
+    float       tolerance = arc_tolerance->get();
+    // First and second derivatives of the curve at t.
+    float s = 1.0 - t;
+    float d1[2], d2[2];
+    for (uint8_t k = 0; k < 2; k++) {
+        float a = curve.bezier[1][k] - curve.bezier[0][k];
+        float b = curve.bezier[2][k] - curve.bezier[1][k];
+        float c = curve.bezier[3][k] - curve.bezier[2][k];
+        d1[k]   = 3.0 * (s * s * a + 2.0 * s * t * b + t * t * c);
+        d2[k]   = 6.0 * (s * (b - a) + t * (c - b));
+    }
+    // A chord of length L on a curve of curvature k = |d1 x d2| / |d1|^3 strays k * L^2 / 8 from it.
+    // With L = |d1| * step, the step that strays by the tolerance follows.
+    float step  = 1.0 - t;
+    float cross = fabs(d1[0] * d2[1] - d1[1] * d2[0]);
+    if (cross > 0.0) {
+        step = MIN(step, sqrt(8.0 * tolerance * hypot_f(d1[0], d1[1]) / cross));
+    }
+    // The estimate only holds where the curvature changes slowly. Halve the step until the curve at
+    // the middle of the segment is within the tolerance of the middle of the chord.
+    float end[2], middle[2];
+    while (step > min_step) {
+        mc_spline_point(t + step, end);
+        mc_spline_point(t + 0.5 * step, middle);
+        float dx = middle[0] - 0.5 * (curve.position[curve.axis_0] + end[0]);
+        float dy = middle[1] - 0.5 * (curve.position[curve.axis_1] + end[1]);
+        if (dx * dx + dy * dy <= tolerance * tolerance) {
+            break;
+        }
+        step *= 0.5;
+    }
+    return MAX(step, min_step);
+}
+
+// Plans the next segment of the spline in progress. The last segment ends exactly at the target.
+// The axes outside the spline plane move in proportion to the curve parameter.
+static void mc_plan_spline_segment() {
+    curve.t += mc_spline_step(curve.t);
+    curve.pl_data.feed_rate = curve.original_feedrate;  // This restores the feedrate kinematics may have altered
+    if (curve.t < 1.0 - 1e-6) {
+        float point[2];
+        mc_spline_point(curve.t, point);
+        auto n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : number_axis->get();
+        for (uint8_t idx = 0; idx < n_axis; idx++) {
+            curve.position[idx] = curve.start[idx] + curve.t * (curve.target[idx] - curve.start[idx]);
+        }
+        curve.position[curve.axis_0] = point[0];
+        curve.position[curve.axis_1] = point[1];
+        cartesian_to_motors(curve.position, &curve.pl_data, curve.previous_position);
+        memcpy(curve.previous_position, curve.position, sizeof(curve.position));
+    } else {
+        // Ensure last segment arrives at target location.
+        curve.plan_segment = NULL;
+        cartesian_to_motors(curve.target, &curve.pl_data, curve.previous_position);
+    }
+    if (sys.abort) {
+        curve.plan_segment = NULL;
+    }
+}
+
+// Execute a cubic Bezier spline in the plane of axis_0 and axis_1. position == current position,
+// target == end point, first_control == offset from position to the first control point and
+// second_control == offset from target to the second control point, both in the plane. The other
+// axes move linearly along the curve. The spline is cut into line segments that stay within the
+// arc_tolerance setting, and they are planned incrementally, as mc_arc() does.
+void mc_spline(float*            target,
+               plan_line_data_t* pl_data,
+               float*            position,
+               float*            first_control,
+               float*            second_control,
+               uint8_t           axis_0,
+               uint8_t           axis_1) {
+    mc_plan_curve(true);  // Finish the previous arc or spline, if any.
+    if (sys.abort) {
+        return;
+    }
+    auto n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : number_axis->get();
+    memset(curve.start, 0, sizeof(curve.start));
+    memcpy(curve.start, position, n_axis * sizeof(position[0]));
+    memcpy(curve.position, curve.start, sizeof(curve.position));
+    memcpy(curve.previous_position, curve.start, sizeof(curve.previous_position));
+    memcpy(curve.target, target, sizeof(curve.target));
+    curve.axis_0       = axis_0;
+    curve.axis_1       = axis_1;
+    curve.bezier[0][0] = position[axis_0];
+    curve.bezier[0][1] = position[axis_1];
+    curve.bezier[1][0] = position[axis_0] + first_control[0];
+    curve.bezier[1][1] = position[axis_1] + first_control[1];
+    curve.bezier[2][0] = target[axis_0] + second_control[0];
+    curve.bezier[2][1] = target[axis_1] + second_control[1];
+    curve.bezier[3][0] = target[axis_0];
+    curve.bezier[3][1] = target[axis_1];
+    memcpy(&curve.pl_data, pl_data, sizeof(plan_line_data_t));
+    if (curve.pl_data.motion.inverseTime) {
+        // The segment count is not known in advance, so convert the inverse time feed rate to the
+        // feed rate that runs the whole spline in the programmed time. The plane length is measured
+        // along a polyline through the curve.
+        const int samples = 16;
+        float     length  = 0.0;
+        float     previous[2], point[2];
+        mc_spline_point(0.0, previous);
+        for (int k = 1; k <= samples; k++) {
+            mc_spline_point(float(k) / samples, point);
+            length += hypot_f(point[0] - previous[0], point[1] - previous[1]);
+            memcpy(previous, point, sizeof(point));
+        }
+        float travel_sq = 0.0;  // Travel of the axes outside the plane
+        for (uint8_t idx = 0; idx < n_axis; idx++) {
+            if (idx != axis_0 && idx != axis_1) {
+                travel_sq += (target[idx] - position[idx]) * (target[idx] - position[idx]);
             }
         }
+        curve.pl_data.feed_rate *= sqrt(length * length + travel_sq);
+        curve.pl_data.motion.inverseTime = 0;  // Force as feed absolute mode over spline segments.
     }
-    // Ensure last segment arrives at target location.
-    cartesian_to_motors(target, pl_data, previous_position);
+    curve.original_feedrate = curve.pl_data.feed_rate;  // Kinematics may alter the feedrate, so save an original copy
+    curve.t                 = 0.0;
+    curve.plan_segment      = mc_plan_spline_segment;
+    mc_plan_curve(false);
 }
 
 // Execute dwell in seconds.
@@ -439,7 +798,7 @@ GCUpdatePos mc_probe_cycle(float* target, plan_line_data_t* pl_data, uint8_t par
     // Set state variables and error out, if the probe failed and cycle with error is enabled.
     if (sys_probe_state == Probe::Active) {
         if (is_no_error) {
-            memcpy(sys_probe_position, sys_position, sizeof(sys_position));
+            st_get_position(sys_probe_position);
         } else {
             sys_rt_exec_alarm = ExecAlarm::ProbeFailContact;
         }
@@ -38,10 +38,28 @@ const int PARKING_MOTION_LINE_NUMBER = 0;
 bool cartesian_to_motors(float* target, plan_line_data_t* pl_data, float* position);
 bool mc_line(float* target, plan_line_data_t* pl_data);  // returns true if line was submitted to planner
 
+// Plans the rest of the arc or spline in progress and sends the line motion that mc_line() holds back for
+// coalescing, if any, to the planner. Must be called wherever all motions parsed so far have to be
+// in the planner, such as buffer syncs.
+void mc_flush_held_line();
+
+// Sends the held line motion to the planner if the stepper is about to run out of blocks or the line
+// has waited COALESCE_FLUSH_MS for more input. Unlike mc_flush_held_line(), leaves a curve in progress.
+void mc_flush_stale_held_line();
+
+// Drops the held line motion and the arc or spline in progress on system reset.
+void mc_discard_held_line();
+
+// Coalescing statistics. Line motions received by mc_line() and planner blocks it produced, since
+// they were last reported by $Planner/Coalesce/Stats.
+extern uint32_t mc_lines_in;
+extern uint32_t mc_blocks_out;
+
 // Execute an arc in offset mode format. position == current xyz, target == target xyz,
 // offset == offset from current xyz, axis_XXX defines circle plane in tool space, axis_linear is
 // the direction of helical travel, radius == circle radius, is_clockwise_arc boolean. Used
-// for vector transformation direction.
+// for vector transformation direction. Plans only as many arc segments as the planner buffer
+// has room for. The rest are planned by mc_continue_curve() or before the next motion.
 void mc_arc(float*            target,
             plan_line_data_t* pl_data,
             float*            position,
@@ -52,6 +70,22 @@ void mc_arc(float*            target,
             uint8_t           axis_linear,
             uint8_t           is_clockwise_arc);
 
+// Execute a cubic Bezier spline. position == current position, target == end point, first_control ==
+// offset from position to the first control point, second_control == offset from target to the
+// second control point. Control offsets are in the plane of axis_0 and axis_1, in that order.
+// Segments are planned incrementally, as for mc_arc().
+void mc_spline(float*            target,
+               plan_line_data_t* pl_data,
+               float*            position,
+               float*            first_control,
+               float*            second_control,
+               uint8_t           axis_0,
+               uint8_t           axis_1);
+
+// Plans more segments of the arc or spline in progress, if any, until the planner buffer is full.
+// Called from the main loop, so that long curves do not stall it.
+void mc_continue_curve();
+
 // Dwell for a specific number of seconds
 bool mc_dwell(int32_t milliseconds);
 
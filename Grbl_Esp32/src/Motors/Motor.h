@@ -83,6 +83,23 @@ namespace Motors {
         // states of the step pins are unknown.
         virtual void unstep() {}
 
+        // can_step_train() says whether the motor can send a step
+        // train with this timing by itself.  step_train() starts
+        // it.  See motors_step_train().  Times are in step timer
+        // ticks.
+        virtual bool can_step_train(uint32_t first_delay, uint32_t interval) { return false; }
+        virtual void step_train(uint32_t first_delay, uint32_t interval, uint16_t count) {}
+
+        // step_gpio() and dir_gpio() give the pin that step() and
+        // unstep(), or set_direction(), write and whether it is
+        // inverted, for motors that do nothing else there.  The pin
+        // is UNDEFINED_PIN if there is none.  If every motor gives
+        // them, motors_step(), motors_unstep() and motors_direction()
+        // write all the pins at once.  Returns false if the motor
+        // needs its own calls, or the pin is not a GPIO.
+        virtual bool step_gpio(uint8_t& pin, bool& invert) { return false; }
+        virtual bool dir_gpio(uint8_t& pin, bool& invert) { return false; }
+
         // test(), called from init(), checks to see if a motor is
         // responsive, returning true on failure.  Typical
         // implementations also display messages to show the result.
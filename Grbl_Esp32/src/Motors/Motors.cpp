@@ -43,8 +43,104 @@
 #include "TrinamicDriver.h"
 #include "TrinamicUartDriver.h"
 
+#include <soc/gpio_struct.h>
+
 Motors::Motor* myMotor[MAX_AXES][MAX_GANGED];  // number of axes (normal and ganged)
-void           init_motors() {
+
+// Pins to set and clear with one write each, bit n for GPIO n. GPIO.out_w1ts and
+// GPIO.out_w1tc take GPIOs 0-31, GPIO.out1_w1ts and GPIO.out1_w1tc the rest.
+struct gpio_masks_t {
+    uint64_t set;
+    uint64_t clear;
+};
+
+// Set by motors_init_gpio_masks() when every motor of the machine drives its step
+// or direction pins with plain GPIO writes
+static bool         gpio_steps;
+static bool         gpio_directions;
+static gpio_masks_t gpio_step_on[MAX_AXES][MAX_GANGED];
+static gpio_masks_t gpio_step_off;
+static gpio_masks_t gpio_direction[MAX_AXES][2];  // Indexed by the direction bit
+
+#ifdef ENABLE_STEPPER_ISR_STATS
+// Cleared by $Stepper/Stats=UNBATCHED so the per-motor writes can be timed against the batched ones
+static bool gpio_batching = true;
+#else
+static const bool gpio_batching = true;
+#endif
+
+static void IRAM_ATTR gpio_write(uint64_t set, uint64_t clear) {
+    if (uint32_t(set)) {
+        GPIO.out_w1ts = uint32_t(set);
+    }
+    if (uint32_t(set >> 32)) {
+        GPIO.out1_w1ts.val = uint32_t(set >> 32);
+    }
+    if (uint32_t(clear)) {
+        GPIO.out_w1tc = uint32_t(clear);
+    }
+    if (uint32_t(clear >> 32)) {
+        GPIO.out1_w1tc.val = uint32_t(clear >> 32);
+    }
+}
+
+// Adds a pin at the given level to masks
+static void gpio_add_pin(gpio_masks_t& masks, uint8_t pin, bool level) {
+    if (pin == UNDEFINED_PIN) {
+        return;
+    }
+    if (level) {
+        masks.set |= 1ULL << pin;
+    } else {
+        masks.clear |= 1ULL << pin;
+    }
+}
+
+// Works out the pin masks from the pins and inversions of the motors. Called after
+// the motors have read their settings.
+static void motors_init_gpio_masks() {
+    auto n_axis = number_axis->get();
+
+    // Not used by the stepper ISR until they are complete
+    gpio_steps      = false;
+    gpio_directions = false;
+
+    bool steps      = true;
+    bool directions = true;
+    memset(gpio_step_on, 0, sizeof(gpio_step_on));
+    memset(&gpio_step_off, 0, sizeof(gpio_step_off));
+    memset(gpio_direction, 0, sizeof(gpio_direction));
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        for (uint8_t gang_index = 0; gang_index < MAX_GANGED; gang_index++) {
+            uint8_t pin;
+            bool    invert;
+            if (myMotor[axis][gang_index]->step_gpio(pin, invert)) {
+                gpio_add_pin(gpio_step_on[axis][gang_index], pin, !invert);
+                gpio_add_pin(gpio_step_off, pin, invert);
+            } else {
+                steps = false;
+            }
+            if (myMotor[axis][gang_index]->dir_gpio(pin, invert)) {
+                gpio_add_pin(gpio_direction[axis][0], pin, invert);
+                gpio_add_pin(gpio_direction[axis][1], pin, !invert);
+            } else {
+                directions = false;
+            }
+        }
+    }
+    gpio_steps      = steps && gpio_batching;
+    gpio_directions = directions && gpio_batching;
+}
+
+#ifdef ENABLE_STEPPER_ISR_STATS
+// Switches the stepper ISR between the batched and the per-motor pin writes
+void motors_set_gpio_batching(bool batch) {
+    gpio_batching = batch;
+    motors_init_gpio_masks();
+}
+#endif
+
+void init_motors() {
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Init Motors");
 
     auto n_axis = number_axis->get();
@@ -409,6 +505,13 @@ void           init_motors() {
             myMotor[axis][gang_index]->init();
         }
     }
+
+    motors_init_gpio_masks();
+    grbl_msg_sendf(CLIENT_SERIAL,
+                   MsgLevel::Info,
+                   "Step pins:%s Direction pins:%s",
+                   gpio_steps ? "Batched" : "Per motor",
+                   gpio_directions ? "Batched" : "Per motor");
 }
 
 void motors_set_disable(bool disable, uint8_t mask) {
@@ -459,6 +562,7 @@ void motors_read_settings() {
             myMotor[axis][gang_index]->read_settings();
         }
     }
+    motors_init_gpio_masks();
 }
 
 // use this to tell all the motors what the current homing mode is
@@ -487,6 +591,18 @@ bool motors_direction(uint8_t dir_mask) {
     if (dir_mask != previous_dir) {
         previous_dir = dir_mask;
 
+        if (gpio_directions) {
+            uint64_t set   = 0;
+            uint64_t clear = 0;
+            for (int axis = X_AXIS; axis < n_axis; axis++) {
+                const gpio_masks_t& masks = gpio_direction[axis][bitnum_istrue(dir_mask, axis)];
+                set |= masks.set;
+                clear |= masks.clear;
+            }
+            gpio_write(set, clear);
+            return true;
+        }
+
         for (int axis = X_AXIS; axis < n_axis; axis++) {
             bool thisDir = bitnum_istrue(dir_mask, axis);
             myMotor[axis][0]->set_direction(thisDir);
@@ -503,6 +619,27 @@ void motors_step(uint8_t step_mask) {
     auto n_axis = number_axis->get();
     //grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "motors_set_direction_pins:0x%02X", onMask);
 
+    if (gpio_steps) {
+        bool     gang_a = (ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A);
+        bool     gang_b = (ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B);
+        uint64_t set    = 0;
+        uint64_t clear  = 0;
+        for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+            if (bitnum_istrue(step_mask, axis)) {
+                if (gang_a) {
+                    set |= gpio_step_on[axis][0].set;
+                    clear |= gpio_step_on[axis][0].clear;
+                }
+                if (gang_b) {
+                    set |= gpio_step_on[axis][1].set;
+                    clear |= gpio_step_on[axis][1].clear;
+                }
+            }
+        }
+        gpio_write(set, clear);
+        return;
+    }
+
     // Turn on step pulses for motors that are supposed to step now
     for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
         if (bitnum_istrue(step_mask, axis)) {
@@ -515,8 +652,39 @@ void motors_step(uint8_t step_mask) {
         }
     }
 }
+
+bool motors_step_train(uint8_t step_mask, uint32_t first_delay, uint32_t interval, uint16_t count) {
+    auto n_axis = number_axis->get();
+
+    if (count > MAX_STEP_TRAIN_STEPS) {
+        return false;
+    }
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        if (bitnum_istrue(step_mask, axis)) {
+            if (!myMotor[axis][0]->can_step_train(first_delay, interval) || !myMotor[axis][1]->can_step_train(first_delay, interval)) {
+                return false;
+            }
+        }
+    }
+    for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
+        if (bitnum_istrue(step_mask, axis)) {
+            if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::A)) {
+                myMotor[axis][0]->step_train(first_delay, interval, count);
+            }
+            if ((ganged_mode == SquaringMode::Dual) || (ganged_mode == SquaringMode::B)) {
+                myMotor[axis][1]->step_train(first_delay, interval, count);
+            }
+        }
+    }
+    return true;
+}
+
 // Turn all stepper pins off
 void motors_unstep() {
+    if (gpio_steps) {
+        gpio_write(gpio_step_off.set, gpio_step_off.clear);
+        return;
+    }
     auto n_axis = number_axis->get();
     for (uint8_t axis = X_AXIS; axis < n_axis; axis++) {
         myMotor[axis][0]->unstep();
@@ -43,5 +43,17 @@ void    motors_set_disable(bool disable, uint8_t mask = B11111111);  // default
 bool    motors_direction(uint8_t dir_mask);
 void    motors_step(uint8_t step_mask);
 void    motors_unstep();
+#ifdef ENABLE_STEPPER_ISR_STATS
+void motors_set_gpio_batching(bool batch);
+#endif
+
+// A step train is a run of evenly spaced step pulses that the motors send by themselves,
+// without a step ISR tick for each one. It is at most one RMT memory block, less the end marker.
+const int MAX_STEP_TRAIN_STEPS = 63;
+
+// Starts count step pulses on the motors of the axes in step_mask. The first pulse is
+// first_delay step timer ticks from now, then one every interval ticks. Returns false,
+// with nothing started, unless every one of those motors can do it.
+bool motors_step_train(uint8_t step_mask, uint32_t first_delay, uint32_t interval, uint16_t count);
 
 void servoUpdateTask(void* pvParameters);
@@ -7,5 +7,14 @@ namespace Motors {
     public:
         Nullmotor(uint8_t axis_index);
         bool set_homing_mode(bool isHoming) { return false; }
+        bool can_step_train(uint32_t first_delay, uint32_t interval) override { return true; }
+        bool step_gpio(uint8_t& pin, bool& invert) override {
+            pin = UNDEFINED_PIN;
+            return true;
+        }
+        bool dir_gpio(uint8_t& pin, bool& invert) override {
+            pin = UNDEFINED_PIN;
+            return true;
+        }
     };
 }
@@ -105,7 +105,9 @@ namespace Motors {
 
         read_settings();
 
-        mpos = system_convert_axis_steps_to_mpos(sys_position, _axis_index);  // get the axis machine position in mm
+        int32_t steps[MAX_N_AXIS];
+        st_get_position(steps);
+        mpos = system_convert_axis_steps_to_mpos(steps, _axis_index);  // get the axis machine position in mm
         // TBD working in MPos
         offset    = 0;  // gc_state.coord_system[axis_index] + gc_state.coord_offset[axis_index];  // get the current axis work offset
         servo_pos = mpos - offset;  // determine the current work position
@@ -27,6 +27,11 @@ namespace Motors {
     rmt_item32_t StandardStepper::rmtItem[2];
     rmt_config_t StandardStepper::rmtConfig;
 
+    // The RMT counts at APB_CLK_FREQ / rmtClockDivider, 4MHz
+    const uint8_t  rmtClockDivider     = 20;
+    const uint32_t stepTicksPerRmtTick = fStepperTimer / (APB_CLK_FREQ / rmtClockDivider);
+    const uint32_t rmtMaxDuration      = 0x7fff;  // 15 bit durations in an RMT item
+
     // Get an RMT channel number
     // returns RMT_CHANNEL_MAX for error
     rmt_channel_t StandardStepper::get_next_RMT_chan_num() {
@@ -43,6 +48,7 @@ namespace Motors {
         Motor(axis_index), _step_pin(step_pin), _dir_pin(dir_pin), _disable_pin(disable_pin) {
 #ifdef USE_RMT_STEPS
         _rmt_chan_num = get_next_RMT_chan_num();
+        _step_train   = false;
 #endif
     }
 
@@ -60,7 +66,7 @@ namespace Motors {
 
 #ifdef USE_RMT_STEPS
         rmtConfig.rmt_mode                       = RMT_MODE_TX;
-        rmtConfig.clk_div                        = 20;
+        rmtConfig.clk_div                        = rmtClockDivider;
         rmtConfig.mem_block_num                  = 2;
         rmtConfig.tx_config.loop_en              = false;
         rmtConfig.tx_config.carrier_en           = false;
@@ -87,6 +93,7 @@ namespace Motors {
         rmtItem[0].level1              = !rmtConfig.tx_config.idle_level;
         rmt_config(&rmtConfig);
         rmt_fill_tx_items(rmtConfig.channel, &rmtItem[0], rmtConfig.mem_block_num, 0);
+        _step_train = false;
 
 #else
         pinMode(_step_pin, OUTPUT);
@@ -108,6 +115,16 @@ namespace Motors {
 
     void StandardStepper::step() {
 #ifdef USE_RMT_STEPS
+        if (_step_train) {
+            // Put the single pulse back. The train is over, bar at most its last pulse, which
+            // is read from further on in the memory.
+            rmt_item32_t item = rmtItem[0];
+            item.level0       = _invert_step_pin;
+            item.level1       = !_invert_step_pin;
+            RMTMEM.chan[_rmt_chan_num].data32[0].val = item.val;
+            RMTMEM.chan[_rmt_chan_num].data32[1].val = 0;
+            _step_train                              = false;
+        }
         RMT.conf_ch[_rmt_chan_num].conf1.mem_rd_rst = 1;
         RMT.conf_ch[_rmt_chan_num].conf1.tx_start   = 1;
 #else
@@ -121,6 +138,54 @@ namespace Motors {
 #endif  // USE_RMT_STEPS
     }
 
+    bool StandardStepper::can_step_train(uint32_t first_delay, uint32_t interval) {
+#ifdef USE_RMT_STEPS
+        // Each pulse is an RMT item: the low time before it, then the pulse itself
+        uint32_t pulse = rmtItem[0].duration1;
+        return _rmt_chan_num != RMT_CHANNEL_MAX && first_delay / stepTicksPerRmtTick + rmtItem[0].duration0 <= rmtMaxDuration &&
+               interval / stepTicksPerRmtTick < rmtMaxDuration + pulse && interval / stepTicksPerRmtTick >= pulse + 2;
+#else
+        return false;
+#endif
+    }
+
+    void StandardStepper::step_train(uint32_t first_delay, uint32_t interval, uint16_t count) {
+#ifdef USE_RMT_STEPS
+        // The pulses start at the same delay after their step time as step() pulses do.
+        // Their times are rounded to RMT ticks separately, so the rounding does not add up.
+        rmt_item32_t item = rmtItem[0];
+        item.level0       = _invert_step_pin;
+        item.level1       = !_invert_step_pin;
+        uint32_t end      = 0;  // RMT ticks from now to the end of the previous pulse
+        for (int i = 0; i < count; i++) {
+            uint32_t start = (first_delay + i * interval) / stepTicksPerRmtTick + rmtItem[0].duration0;
+            item.duration0 = start - end;
+            RMTMEM.chan[_rmt_chan_num].data32[i].val = item.val;
+            end = start + item.duration1;
+        }
+        RMTMEM.chan[_rmt_chan_num].data32[count].val = 0;  // End marker
+        _step_train                                  = true;
+        RMT.conf_ch[_rmt_chan_num].conf1.mem_rd_rst  = 1;
+        RMT.conf_ch[_rmt_chan_num].conf1.tx_start    = 1;
+#endif
+    }
+
+    bool StandardStepper::step_gpio(uint8_t& pin, bool& invert) {
+#ifdef USE_RMT_STEPS
+        return false;
+#else
+        pin    = _step_pin;
+        invert = _invert_step_pin;
+        return pin == UNDEFINED_PIN || pin < I2S_OUT_PIN_BASE;
+#endif
+    }
+
+    bool StandardStepper::dir_gpio(uint8_t& pin, bool& invert) {
+        pin    = _dir_pin;
+        invert = _invert_dir_pin;
+        return pin == UNDEFINED_PIN || pin < I2S_OUT_PIN_BASE;
+    }
+
     void StandardStepper::set_direction(bool dir) { digitalWrite(_dir_pin, dir ^ _invert_dir_pin); }
 
     void StandardStepper::set_disable(bool disable) {
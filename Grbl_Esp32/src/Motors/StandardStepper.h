@@ -15,6 +15,10 @@ namespace Motors {
         void set_direction(bool) override;
         void step() override;
         void unstep() override;
+        bool can_step_train(uint32_t first_delay, uint32_t interval) override;
+        void step_train(uint32_t first_delay, uint32_t interval, uint16_t count) override;
+        bool step_gpio(uint8_t& pin, bool& invert) override;
+        bool dir_gpio(uint8_t& pin, bool& invert) override;
         void read_settings() override;
 
         void init_step_dir_pins();
@@ -24,6 +28,7 @@ namespace Motors {
 
 #ifdef USE_RMT_STEPS
         rmt_channel_t _rmt_chan_num;
+        bool          _step_train;  // A step train has replaced the single pulse in the RMT memory
 #endif
         bool    _invert_step_pin;
         bool    _invert_dir_pin;
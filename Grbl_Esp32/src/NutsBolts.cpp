@@ -27,6 +27,12 @@
 
 const int MAX_INT_DIGITS = 8;  // Maximum number of digits in int32 (and float)
 
+// Powers of ten that read_float() scales by. All of them are exact in a float.
+static const int   MAX_POW10           = 10;
+static const float powers_of_ten[]     = { 1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f };
+static const int   MAX_EXACT_FLOAT_INT = 1 << 24;   // Integers below this convert to float exactly
+static const int   MAX_INT_PREFIX      = 10000000;  // Integers below this take another digit within MAX_INT_DIGITS
+
 // Extracts a floating point value from a string. The following code is based loosely on
 // the avr-libc strtod() function by Michael Stumpf and Dmitry Xmelkov and many freely
 // available conversion method examples, but has been highly optimized for Grbl. For known
@@ -34,67 +40,72 @@ const int MAX_INT_DIGITS = 8;  // Maximum number of digits in int32 (and float)
 // Scientific notation is officially not supported by g-code, and the 'E' character may
 // be a g-code word on some CNC systems. So, 'E' notation will not be recognized.
 // NOTE: Thanks to Radu-Eosif Mihailescu for identifying the issues with using strtod().
+//
+// The digits are packed into an integer in one pass and scaled with a single multiply or
+// divide by a power of ten from the table, so values of up to MAX_INT_DIGITS significant
+// digits are correctly rounded. Further digits are dropped.
 uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
-    const char*   ptr = line + *char_counter;
-    unsigned char c;
-    // Grab first character and increment pointer. No spaces assumed in line.
-    c = *ptr++;
+    const char* ptr = line + *char_counter;
     // Capture initial positive/minus character
     bool isnegative = false;
-    if (c == '-') {
+    if (*ptr == '-') {
         isnegative = true;
-        c          = *ptr++;
-    } else if (c == '+') {
-        c = *ptr++;
-    }
-
-    // Extract number into fast integer. Track decimal in terms of exponent value.
-    uint32_t intval    = 0;
-    int8_t   exp       = 0;
-    uint8_t  ndigit    = 0;
-    bool     isdecimal = false;
-    while (1) {
-        c -= '0';
-        if (c <= 9) {
-            ndigit++;
-            if (ndigit <= MAX_INT_DIGITS) {
-                if (isdecimal) {
-                    exp--;
-                }
-                intval = intval * 10 + c;
-            } else {
-                if (!(isdecimal)) {
-                    exp++;  // Drop overflow digits
-                }
-            }
-        } else if (c == (('.' - '0') & 0xff) && !(isdecimal)) {
-            isdecimal = true;
+        ptr++;
+    } else if (*ptr == '+') {
+        ptr++;
+    }
+
+    // Extract number into fast integer. Track decimal in terms of exponent value. Leading
+    // zeros do not count toward the significant digits.
+    const char* start  = ptr;
+    uint32_t    intval = 0;
+    int         exp    = 0;
+    uint8_t     digit;
+    while ((digit = *ptr - '0') <= 9) {
+        if (intval < MAX_INT_PREFIX) {
+            intval = intval * 10 + digit;
         } else {
-            break;
+            exp++;  // Drop overflow digits
+        }
+        ptr++;
+    }
+    size_t nchar = ptr - start;
+    if (*ptr == '.') {
+        ptr++;
+        while ((digit = *ptr - '0') <= 9) {
+            if (intval < MAX_INT_PREFIX) {
+                intval = intval * 10 + digit;
+                exp--;
+            }
+            ptr++;
         }
-        c = *ptr++;
+        nchar = ptr - start - 1;
     }
     // Return if no digits have been read.
-    if (!ndigit) {
+    if (!nchar) {
         return false;
     }
 
-    // Convert integer into floating point.
+    // Convert integer into floating point and apply decimal. Within the range of the table this
+    // is one correctly rounded operation. Integers too large for a float are divided in double,
+    // which rounds to the same float.
     float fval;
-    fval = (float)intval;
-    // Apply decimal. Should perform no more than two floating point multiplications for the
-    // expected range of E0 to E-4.
-    if (fval != 0) {
-        while (exp <= -2) {
-            fval *= 0.01;
-            exp += 2;
+    if (intval == 0 || exp == 0) {
+        fval = (float)intval;
+    } else if (exp < 0 && exp >= -MAX_POW10) {
+        if (intval < MAX_EXACT_FLOAT_INT) {
+            fval = (float)intval / powers_of_ten[-exp];
+        } else {
+            fval = (float)((double)intval / powers_of_ten[-exp]);
+        }
+    } else {
+        // Far outside the range of g-code values. Scale in steps.
+        fval = (float)intval;
+        for (; exp > 0; exp -= MAX_POW10) {
+            fval *= powers_of_ten[MIN(exp, MAX_POW10)];
         }
-        if (exp < 0) {
-            fval *= 0.1;
-        } else if (exp > 0) {
-            do {
-                fval *= 10.0;
-            } while (--exp > 0);
+        for (; exp < 0; exp += MAX_POW10) {
+            fval /= powers_of_ten[MIN(-exp, MAX_POW10)];
         }
     }
     // Assign floating point value with correct sign.
@@ -103,7 +114,7 @@ uint8_t read_float(const char* line, uint8_t* char_counter, float* float_ptr) {
     } else {
         *float_ptr = fval;
     }
-    *char_counter = ptr - line - 1;  // Set char_counter to next statement
+    *char_counter = ptr - line;  // Set char_counter to next statement
     return true;
 }
 
@@ -141,10 +152,11 @@ float hypot_f(float x, float y) {
     return sqrt(x * x + y * y);
 }
 
+template <int N_AXES>
 float convert_delta_vector_to_unit_vector(float* vector) {
     uint8_t idx;
     float   magnitude = 0.0;
-    auto    n_axis    = number_axis->get();
+    auto    n_axis    = N_AXES ? N_AXES : motion_config->n_axis;
     for (idx = 0; idx < n_axis; idx++) {
         if (vector[idx] != 0.0) {
             magnitude += vector[idx] * vector[idx];
@@ -158,34 +170,66 @@ float convert_delta_vector_to_unit_vector(float* vector) {
     return magnitude;
 }
 
+template <int N_AXES>
 float limit_acceleration_by_axis_maximum(float* unit_vec) {
-    uint8_t idx;
-    float   limit_value = SOME_LARGE_VALUE;
-    auto    n_axis      = number_axis->get();
+    uint8_t             idx;
+    float               limit_value = SOME_LARGE_VALUE;
+    const MotionConfig* config      = motion_config;
+    auto                n_axis      = N_AXES ? N_AXES : config->n_axis;
     for (idx = 0; idx < n_axis; idx++) {
         if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-            limit_value = MIN(limit_value, fabs(axis_settings[idx]->acceleration->get() / unit_vec[idx]));
+            limit_value = MIN(limit_value, fabs(config->acceleration[idx] / unit_vec[idx]));
         }
     }
     // The acceleration setting is stored and displayed in units of mm/sec^2,
-    // but used in units of mm/min^2.  It suffices to perform the conversion once on
-    // exit, since the limit computation above is independent of units - it simply
-    // finds the smallest value.
-    return limit_value * SEC_PER_MIN_SQ;
+    // but the snapshot holds it already converted to mm/min^2.
+    return limit_value;
 }
 
+// Returns zero when no moving axis has a jerk limit, which tells the
+// segment generator to use plain trapezoidal ramps for the block.
+template <int N_AXES>
+float limit_jerk_by_axis_maximum(float* unit_vec) {
+    uint8_t             idx;
+    float               limit_value = SOME_LARGE_VALUE;
+    const MotionConfig* config      = motion_config;
+    auto                n_axis      = N_AXES ? N_AXES : config->n_axis;
+    bool                limited     = false;
+    for (idx = 0; idx < n_axis; idx++) {
+        if (unit_vec[idx] != 0 && config->jerk[idx] > 0.0) {  // Zero jerk means the axis is not jerk limited.
+            limit_value = MIN(limit_value, fabs(config->jerk[idx] / unit_vec[idx]));
+            limited     = true;
+        }
+    }
+    // Already in mm/min^3 in the snapshot. Tested with a flag since the float never equals the double SOME_LARGE_VALUE.
+    return limited ? limit_value : 0.0;
+}
+
+template <int N_AXES>
 float limit_rate_by_axis_maximum(float* unit_vec) {
-    uint8_t idx;
-    float   limit_value = SOME_LARGE_VALUE;
-    auto    n_axis      = number_axis->get();
+    uint8_t             idx;
+    float               limit_value = SOME_LARGE_VALUE;
+    const MotionConfig* config      = motion_config;
+    auto                n_axis      = N_AXES ? N_AXES : config->n_axis;
     for (idx = 0; idx < n_axis; idx++) {
         if (unit_vec[idx] != 0) {  // Avoid divide by zero.
-            limit_value = MIN(limit_value, fabs(axis_settings[idx]->max_rate->get() / unit_vec[idx]));
+            limit_value = MIN(limit_value, fabs(config->max_rate[idx] / unit_vec[idx]));
         }
     }
     return limit_value;
 }
 
+#define INSTANTIATE_AXIS_LOOPS(n)                                                                                                          \
+    template float convert_delta_vector_to_unit_vector<n>(float* vector);                                                                  \
+    template float limit_acceleration_by_axis_maximum<n>(float* unit_vec);                                                                 \
+    template float limit_jerk_by_axis_maximum<n>(float* unit_vec);                                                                         \
+    template float limit_rate_by_axis_maximum<n>(float* unit_vec);
+INSTANTIATE_AXIS_LOOPS(0)
+#ifndef AXIS_LOOPS_RUN_TIME
+INSTANTIATE_AXIS_LOOPS(AXIS_LOOP_COUNT)
+#endif
+#undef INSTANTIATE_AXIS_LOOPS
+
 float map_float(float x, float in_min, float in_max, float out_min, float out_max) {  // DrawBot_Badge
     return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
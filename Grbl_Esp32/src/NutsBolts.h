@@ -97,8 +97,15 @@ void delay_ms(uint16_t ms);
 // Computes hypotenuse, avoiding avr-gcc's bloated version and the extra error checking.
 float hypot_f(float x, float y);
 
+// Templates on the axis count N_AXES, see AXIS_LOOP_COUNT in Config.h. N_AXES 0 reads the count
+// from motion_config. Instantiated for 0 and AXIS_LOOP_COUNT.
+template <int N_AXES = 0>
 float convert_delta_vector_to_unit_vector(float* vector);
+template <int N_AXES = 0>
 float limit_acceleration_by_axis_maximum(float* unit_vec);
+template <int N_AXES = 0>
+float limit_jerk_by_axis_maximum(float* unit_vec);
+template <int N_AXES = 0>
 float limit_rate_by_axis_maximum(float* unit_vec);
 
 float    mapConstrain(float x, float in_min, float in_max, float out_min, float out_max);
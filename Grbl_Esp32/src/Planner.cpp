@@ -26,11 +26,12 @@
 #include "Grbl.h"
 #include <stdlib.h>  // PSoc Required for labs
 
-static plan_block_t block_buffer[BLOCK_BUFFER_SIZE];  // A ring buffer for motion instructions
-static uint8_t      block_buffer_tail;                // Index of the block to process now
-static uint8_t      block_buffer_head;                // Index of the next block to be pushed
-static uint8_t      next_buffer_head;                 // Index of the next buffer head
-static uint8_t      block_buffer_planned;             // Index of the optimally planned block
+static plan_block_t* block_buffer;          // A ring buffer for motion instructions, allocated by plan_init()
+static uint16_t      block_buffer_size;     // Number of entries in block_buffer
+static uint16_t      block_buffer_tail;     // Index of the block to process now
+static uint16_t      block_buffer_head;     // Index of the next block to be pushed
+static uint16_t      next_buffer_head;      // Index of the next buffer head
+static uint16_t      block_buffer_planned;  // Index of the optimally planned block
 
 // Define planner variables
 typedef struct {
@@ -39,27 +40,108 @@ typedef struct {
     // i.e. arcs, canned cycles, and backlash compensation.
     float previous_unit_vec[MAX_N_AXIS];  // Unit vector of previous path line segment
     float previous_nominal_speed;         // Nominal speed of previous path line segment
+    float previous_millimeters;           // Length of previous path line segment
 } planner_t;
 static planner_t pl;
 
 // Returns the index of the next block in the ring buffer. Also called by stepper segment buffer.
-uint8_t plan_next_block_index(uint8_t block_index) {
+uint16_t plan_next_block_index(uint16_t block_index) {
     block_index++;
-    if (block_index == BLOCK_BUFFER_SIZE) {
+    if (block_index == block_buffer_size) {
         block_index = 0;
     }
     return block_index;
 }
 
 // Returns the index of the previous block in the ring buffer
-static uint8_t plan_prev_block_index(uint8_t block_index) {
+static uint16_t plan_prev_block_index(uint16_t block_index) {
     if (block_index == 0) {
-        block_index = BLOCK_BUFFER_SIZE;
+        block_index = block_buffer_size;
     }
     block_index--;
     return block_index;
 }
 
+// Allocates the block ring buffer. The size comes from the $Planner/Blocks setting, so a
+// change to that setting takes effect at the next restart. The buffer is placed in PSRAM
+// when the board has it, whatever its size, since only the main loop (never the stepper ISR)
+// touches planner blocks. If the allocation fails we fall back to the compiled-in default size,
+// and if that fails too Grbl stops here, since nothing can move without the buffer.
+void plan_init() {
+    if (block_buffer != NULL) {
+        return;  // Already allocated. The size cannot change while running.
+    }
+    uint16_t size  = planner_blocks->get();
+    size_t   bytes = size * sizeof(plan_block_t);
+    if (psramFound()) {
+        block_buffer = (plan_block_t*)heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    if (block_buffer == NULL) {
+        block_buffer = (plan_block_t*)heap_caps_malloc(bytes, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if (block_buffer == NULL) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Planner: cannot allocate %d blocks, using %d", size, BLOCK_BUFFER_SIZE);
+        size         = BLOCK_BUFFER_SIZE;
+        block_buffer = (plan_block_t*)malloc(size * sizeof(plan_block_t));
+    }
+    if (block_buffer == NULL) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Planner: cannot allocate %d blocks, halted", size);
+        while (true) {
+            delay(1000);
+        }
+    }
+    block_buffer_size = size;
+    grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Planner blocks %d", block_buffer_size);
+}
+
+/*
+  A jerk-limited ramp raises the acceleration at the block jerk, holds it at the block
+  acceleration, and lowers it back to zero at the end. A short ramp lowers it again before it
+  gets to the block acceleration. The ramp is symmetric about its midpoint, so it covers its time
+  at the average of its speeds.
+*/
+
+// Time for a jerk-limited ramp to change speed by delta_speed
+float plan_ramp_time(float delta_speed, float acceleration, float jerk) {
+    if (delta_speed * jerk < acceleration * acceleration) {
+        return 2.0 * sqrt(delta_speed / jerk);  // Peaks below the acceleration
+    }
+    return delta_speed / acceleration + acceleration / jerk;
+}
+
+// Distance a jerk-limited ramp between the two speeds covers
+float plan_ramp_distance(float speed_0, float speed_1, float acceleration, float jerk) {
+    return 0.5 * (speed_0 + speed_1) * plan_ramp_time(fabs(speed_1 - speed_0), acceleration, jerk);
+}
+
+// Highest speed a jerk-limited ramp from speed gets to in distance. The inverse of
+// plan_ramp_distance() for ramps that speed up.
+float plan_ramp_speed(float speed, float distance, float acceleration, float jerk) {
+    float full_speed = acceleration * acceleration / jerk;  // Speed change of a ramp that just peaks at the acceleration
+    if (distance >= (2.0 * speed + full_speed) * acceleration / jerk) {
+        // (2 * speed + dv) * (dv + full_speed) = 2 * acceleration * distance
+        float b = 2.0 * speed - full_speed;
+        return 0.5 * (sqrt(b * b + 8.0 * acceleration * distance) - full_speed);
+    }
+    // x^3 + 2 * speed * x = distance * sqrt(jerk), with x = sqrt(dv), solved by Cardano's method in a
+    // form that does not lose precision when speed is large.
+    float h = 0.5 * distance * sqrt(jerk);
+    float m = 2.0 * speed / 3.0;
+    float u = cbrtf(h + sqrt(h * h + m * m * m));
+    float w = m / u;
+    float x = 2.0 * h / (u * u + m + w * w);
+    return speed + x * x;
+}
+
+// Highest speed squared the block gets to over its length from speed_sqr at either end
+static float plan_reach_speed_sqr(const plan_block_t* block, float speed_sqr) {
+    if (block->jerk <= 0.0) {
+        return speed_sqr + 2 * block->acceleration * block->millimeters;
+    }
+    float speed = plan_ramp_speed(sqrt(speed_sqr), block->millimeters, block->acceleration, block->jerk);
+    return speed * speed;
+}
+
 /*                            PLANNER SPEED DEFINITION
                                      +--------+   <- current->nominal_speed
                                     /          \
@@ -127,7 +209,7 @@ static uint8_t plan_prev_block_index(uint8_t block_index) {
 */
 static void planner_recalculate() {
     // Initialize block index to the last block in the planner buffer.
-    uint8_t block_index = plan_prev_block_index(block_buffer_head);
+    uint16_t block_index = plan_prev_block_index(block_buffer_head);
     // Bail. Can't do anything with one only one plan-able block.
     if (block_index == block_buffer_planned) {
         return;
@@ -139,7 +221,7 @@ static void planner_recalculate() {
     plan_block_t* next;
     plan_block_t* current = &block_buffer[block_index];
     // Calculate maximum entry speed for last block in buffer, where the exit speed is always zero.
-    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, 2 * current->acceleration * current->millimeters);
+    current->entry_speed_sqr = MIN(current->max_entry_speed_sqr, plan_reach_speed_sqr(current, 0.0));
     block_index              = plan_prev_block_index(block_index);
     if (block_index == block_buffer_planned) {  // Only two plannable blocks in buffer. Reverse pass complete.
         // Check if the first block is the tail. If so, notify stepper to update its current parameters.
@@ -157,7 +239,7 @@ static void planner_recalculate() {
             }
             // Compute maximum entry speed decelerating over the current block from its exit speed.
             if (current->entry_speed_sqr != current->max_entry_speed_sqr) {
-                entry_speed_sqr = next->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
+                entry_speed_sqr = plan_reach_speed_sqr(current, next->entry_speed_sqr);
                 if (entry_speed_sqr < current->max_entry_speed_sqr) {
                     current->entry_speed_sqr = entry_speed_sqr;
                 } else {
@@ -177,7 +259,7 @@ static void planner_recalculate() {
         // pointer forward, since everything before this is all optimal. In other words, nothing
         // can improve the plan from the buffer tail to the planned pointer by logic.
         if (current->entry_speed_sqr < next->entry_speed_sqr) {
-            entry_speed_sqr = current->entry_speed_sqr + 2 * current->acceleration * current->millimeters;
+            entry_speed_sqr = plan_reach_speed_sqr(current, current->entry_speed_sqr);
             // If true, current block is full-acceleration and we can move the planned pointer forward.
             if (entry_speed_sqr < next->entry_speed_sqr) {
                 next->entry_speed_sqr = entry_speed_sqr;  // Always <= max_entry_speed_sqr. Backward pass sets this.
@@ -209,7 +291,7 @@ void plan_reset_buffer() {
 
 void plan_discard_current_block() {
     if (block_buffer_head != block_buffer_tail) {  // Discard non-empty buffer.
-        uint8_t block_index = plan_next_block_index(block_buffer_tail);
+        uint16_t block_index = plan_next_block_index(block_buffer_tail);
         // Push block_buffer_planned pointer, if encountered.
         if (block_buffer_tail == block_buffer_planned) {
             block_buffer_planned = block_index;
@@ -232,7 +314,7 @@ plan_block_t* plan_get_current_block() {
 }
 
 float plan_get_exec_block_exit_speed_sqr() {
-    uint8_t block_index = plan_next_block_index(block_buffer_tail);
+    uint16_t block_index = plan_next_block_index(block_buffer_tail);
     if (block_index == block_buffer_head) {
         return 0.0f;
     }
@@ -281,7 +363,7 @@ static void plan_compute_profile_parameters(plan_block_t* block, float nominal_s
 
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters() {
-    uint8_t       block_index = block_buffer_tail;
+    uint16_t      block_index = block_buffer_tail;
     plan_block_t* block;
     float         nominal_speed;
     float         prev_nominal_speed = SOME_LARGE_VALUE;  // Set high for first block nominal speed calculation.
@@ -313,19 +395,20 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     uint8_t idx;
     // Copy position data based on type of motion being planned.
     if (block->motion.systemMotion) {
-        memcpy(position_steps, sys_position, sizeof(sys_position));
+        st_get_position(position_steps);
     } else {
         memcpy(position_steps, pl.position, sizeof(pl.position));
     }
-    auto n_axis = number_axis->get();
+    const MotionConfig* config = motion_config;
+    auto                n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : config->n_axis;
     for (idx = 0; idx < n_axis; idx++) {
         // Calculate target position in absolute steps, number of steps for each axis, and determine max step events.
         // Also, compute individual axes distance for move and prep unit vector calculations.
         // NOTE: Computes true distance from converted step values.
-        target_steps[idx]       = lround(target[idx] * axis_settings[idx]->steps_per_mm->get());
+        target_steps[idx]       = lround(target[idx] * config->steps_per_mm[idx]);
         block->steps[idx]       = labs(target_steps[idx] - position_steps[idx]);
         block->step_event_count = MAX(block->step_event_count, block->steps[idx]);
-        delta_mm                = (target_steps[idx] - position_steps[idx]) / axis_settings[idx]->steps_per_mm->get();
+        delta_mm                = (target_steps[idx] - position_steps[idx]) * config->mm_per_step[idx];
         unit_vec[idx]           = delta_mm;  // Store unit vector numerator
         // Set direction bits. Bit enabled always means direction is negative.
         if (delta_mm < 0.0) {
@@ -341,9 +424,10 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     // down such that no individual axes maximum values are exceeded with respect to the line direction.
     // NOTE: This calculation assumes all axes are orthogonal (Cartesian) and works with ABC-axes,
     // if they are also orthogonal/independent. Operates on the absolute value of the unit vector.
-    block->millimeters  = convert_delta_vector_to_unit_vector(unit_vec);
-    block->acceleration = limit_acceleration_by_axis_maximum(unit_vec);
-    block->rapid_rate   = limit_rate_by_axis_maximum(unit_vec);
+    block->millimeters  = convert_delta_vector_to_unit_vector<AXIS_LOOP_COUNT>(unit_vec);
+    block->acceleration = limit_acceleration_by_axis_maximum<AXIS_LOOP_COUNT>(unit_vec);
+    block->jerk         = limit_jerk_by_axis_maximum<AXIS_LOOP_COUNT>(unit_vec);
+    block->rapid_rate   = limit_rate_by_axis_maximum<AXIS_LOOP_COUNT>(unit_vec);
     // Store programmed rate.
     if (block->motion.rapidMotion) {
         block->programmed_rate = block->rapid_rate;
@@ -372,10 +456,10 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         //
         // NOTE: If the junction deviation value is finite, Grbl executes the motions in an exact path
         // mode (G61). If the junction deviation value is zero, Grbl will execute the motion in an exact
-        // stop mode (G61.1) manner. In the future, if continuous mode (G64) is desired, the math here
-        // is exactly the same. Instead of motioning all the way to junction point, the machine will
-        // just follow the arc circle defined here. The Arduino doesn't have the CPU cycles to perform
-        // a continuous mode path, but ARM-based microcontrollers most certainly do.
+        // stop mode (G61.1) manner. In continuous mode (G64 P), the math is exactly the same, but the
+        // deviation is the larger of junction deviation and the P tolerance. The blend circle must
+        // also touch each segment no further than halfway along it, so that consecutive blends never
+        // overlap; this keeps short, nearly collinear CAM segments fast without cutting real corners.
         //
         // NOTE: The max junction speed is a fixed value, since machine acceleration limits cannot be
         // changed dynamically during operation nor can the line move geometry. This must be kept in
@@ -396,12 +480,18 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
                 // Junction is a straight line or 180 degrees. Junction speed is infinite.
                 block->max_junction_speed_sqr = SOME_LARGE_VALUE;
             } else {
-                convert_delta_vector_to_unit_vector(junction_unit_vec);
-                float junction_acceleration = limit_acceleration_by_axis_maximum(junction_unit_vec);
+                convert_delta_vector_to_unit_vector<AXIS_LOOP_COUNT>(junction_unit_vec);
+                float junction_acceleration = limit_acceleration_by_axis_maximum<AXIS_LOOP_COUNT>(junction_unit_vec);
                 float sin_theta_d2          = sqrt(0.5 * (1.0 - junction_cos_theta));  // Trig half angle identity. Always positive.
+                float junction_radius       = config->junction_deviation * sin_theta_d2 / (1.0 - sin_theta_d2);
+                if (pl_data->path_tolerance > config->junction_deviation) {  // G64 P blending
+                    float cos_theta_d2 = sqrt(0.5 * (1.0 + junction_cos_theta));  // Always positive here.
+                    float blend_radius = pl_data->path_tolerance * sin_theta_d2 / (1.0 - sin_theta_d2);
+                    float max_radius   = 0.5 * MIN(pl.previous_millimeters, block->millimeters) * sin_theta_d2 / cos_theta_d2;
+                    junction_radius    = MAX(junction_radius, MIN(blend_radius, max_radius));
+                }
                 block->max_junction_speed_sqr =
-                    MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED,
-                        (junction_acceleration * junction_deviation->get() * sin_theta_d2) / (1.0 - sin_theta_d2));
+                    MAX(MINIMUM_JUNCTION_SPEED * MINIMUM_JUNCTION_SPEED, junction_acceleration * junction_radius);
             }
         }
     }
@@ -412,6 +502,7 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
         pl.previous_nominal_speed = nominal_speed;
         // Update previous path unit_vector and planner position.
         memcpy(pl.previous_unit_vec, unit_vec, sizeof(unit_vec));  // pl.previous_unit_vec[] = unit_vec[]
+        pl.previous_millimeters = block->millimeters;
         memcpy(pl.position, target_steps, sizeof(target_steps));   // pl.position[] = target_steps[]
         // New block is all set. Update buffer head and next buffer head indices.
         block_buffer_head = next_buffer_head;
@@ -422,6 +513,15 @@ uint8_t plan_buffer_line(float* target, plan_line_data_t* pl_data) {
     return PLAN_OK;
 }
 
+// Returns the end of the last planned line in millimeters.
+void plan_get_planner_mpos(float* target) {
+    uint8_t idx;
+    auto    n_axis = motion_config->n_axis;
+    for (idx = 0; idx < n_axis; idx++) {
+        target[idx] = pl.position[idx] * motion_config->mm_per_step[idx];
+    }
+}
+
 // Reset the planner position vectors. Called by the system abort/initialization routine.
 void plan_sync_position() {
     // TODO: For motor configurations not in the same coordinate frame as the machine position,
@@ -434,9 +534,9 @@ void plan_sync_position() {
 }
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available() {
+uint16_t plan_get_block_buffer_available() {
     if (block_buffer_head >= block_buffer_tail) {
-        return (BLOCK_BUFFER_SIZE - 1) - (block_buffer_head - block_buffer_tail);
+        return (block_buffer_size - 1) - (block_buffer_head - block_buffer_tail);
     } else {
         return block_buffer_tail - block_buffer_head - 1;
     }
@@ -444,11 +544,11 @@ uint8_t plan_get_block_buffer_available() {
 
 // Returns the number of active blocks are in the planner buffer.
 // NOTE: Deprecated. Not used unless classic status reports are enabled in config.h
-uint8_t plan_get_block_buffer_count() {
+uint16_t plan_get_block_buffer_count() {
     if (block_buffer_head >= block_buffer_tail) {
         return block_buffer_head - block_buffer_tail;
     } else {
-        return BLOCK_BUFFER_SIZE - (block_buffer_tail - block_buffer_head);
+        return block_buffer_size - (block_buffer_tail - block_buffer_head);
     }
 }
 
@@ -24,7 +24,10 @@
   along with Grbl.  If not, see <http://www.gnu.org/licenses/>.
 */
 
-// The number of linear motions that can be in the plan at any give time
+// The default number of linear motions that can be in the plan at any give time.
+// The actual size is taken from the $Planner/Blocks setting when the planner is
+// allocated at startup; this value is the default for that setting and the
+// fallback if the requested buffer cannot be allocated.
 #ifndef BLOCK_BUFFER_SIZE
 #    ifdef USE_LINE_NUMBERS
 #        define BLOCK_BUFFER_SIZE 15
@@ -33,6 +36,11 @@
 #    endif
 #endif
 
+// Limits for the $Planner/Blocks setting. Each block costs sizeof(plan_block_t) bytes
+// of RAM, so very large values should only be used on boards with PSRAM.
+const int MIN_BLOCK_BUFFER_SIZE = 8;
+const int MAX_BLOCK_BUFFER_SIZE = 1000;
+
 // Returned status message from planner.
 const int PLAN_OK          = true;
 const int PLAN_EMPTY_BLOCK = false;
@@ -68,6 +76,7 @@ typedef struct {
     float max_entry_speed_sqr;  // Maximum allowable entry speed based on the minimum of junction limit and
     //   neighboring nominal speeds with overrides in (mm/min)^2
     float acceleration;  // Axis-limit adjusted line acceleration in (mm/min^2). Does not change.
+    float jerk;          // Axis-limit adjusted line jerk in (mm/min^3). Zero selects trapezoidal ramps.
     float millimeters;   // The remaining distance for this block to be executed in (mm).
     // NOTE: This value may be altered by stepper algorithm during execution.
 
@@ -83,17 +92,21 @@ typedef struct {
 
 // Planner data prototype. Must be used when passing new motions to the planner.
 typedef struct {
-    float        feed_rate;      // Desired feed rate for line motion. Value is ignored, if rapid motion.
-    uint32_t     spindle_speed;  // Desired spindle speed through line motion.
-    PlMotion     motion;         // Bitflag variable to indicate motion conditions. See defines above.
-    SpindleState spindle;        // Spindle enable state
-    CoolantState coolant;        // Coolant state
+    float        feed_rate;       // Desired feed rate for line motion. Value is ignored, if rapid motion.
+    uint32_t     spindle_speed;   // Desired spindle speed through line motion.
+    PlMotion     motion;          // Bitflag variable to indicate motion conditions. See defines above.
+    SpindleState spindle;         // Spindle enable state
+    CoolantState coolant;         // Coolant state
+    float        path_tolerance;  // G64 P blending tolerance in mm. Zero in exact path mode.
 #ifdef USE_LINE_NUMBERS
     int32_t line_number;  // Desired line number to report when executing.
 #endif
     bool         is_jog;         // true if this was generated due to a jog command
 } plan_line_data_t;
 
+// Allocate the block ring buffer using the $Planner/Blocks setting. Called once at startup.
+void plan_init();
+
 // Initialize and reset the motion plan subsystem
 void plan_reset();         // Reset all
 void plan_reset_buffer();  // Reset buffer only.
@@ -114,7 +127,7 @@ plan_block_t* plan_get_system_motion_block();
 plan_block_t* plan_get_current_block();
 
 // Called periodically by step segment buffer. Mostly used internally by planner.
-uint8_t plan_next_block_index(uint8_t block_index);
+uint16_t plan_next_block_index(uint16_t block_index);
 
 // Called by step segment buffer when computing executing block velocity profile.
 float plan_get_exec_block_exit_speed_sqr();
@@ -122,6 +135,11 @@ float plan_get_exec_block_exit_speed_sqr();
 // Called by main program during planner calculations and step segment buffer during initialization.
 float plan_compute_profile_nominal_speed(plan_block_t* block);
 
+// Time, distance and reachable speed of a jerk-limited ramp. Used by the planner and step segment buffer.
+float plan_ramp_time(float delta_speed, float acceleration, float jerk);
+float plan_ramp_distance(float speed_0, float speed_1, float acceleration, float jerk);
+float plan_ramp_speed(float speed, float distance, float acceleration, float jerk);
+
 // Re-calculates buffered motions profile parameters upon a motion-based override change.
 void plan_update_velocity_profile_parameters();
 
@@ -132,11 +150,11 @@ void plan_sync_position();
 void plan_cycle_reinitialize();
 
 // Returns the number of available blocks are in the planner buffer.
-uint8_t plan_get_block_buffer_available();
+uint16_t plan_get_block_buffer_available();
 
 // Returns the number of active blocks are in the planner buffer.
 // NOTE: Deprecated. Not used unless classic status reports are enabled in config.h
-uint8_t plan_get_block_buffer_count();
+uint16_t plan_get_block_buffer_count();
 
 // Returns the status of the block ring buffer. True, if buffer is full.
 uint8_t plan_check_full_buffer();
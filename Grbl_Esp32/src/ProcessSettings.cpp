@@ -55,6 +55,7 @@ void settings_restore(uint8_t restore_flag) {
                 }
             }
         }
+        motion_config_update();
         grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Settings reset done");
     }
     if (restore_flag & SettingsRestore::Parameters) {
@@ -84,6 +85,7 @@ void settings_init() {
     WebUI::make_web_settings();
     make_grbl_commands();
     load_settings();
+    motion_config_update();
 }
 
 // TODO Settings - jog may need to be special-cased in the parser, since
@@ -314,6 +316,35 @@ Error restore_settings(const char* value, WebUI::AuthenticationLevel auth_level,
     return Error::Ok;
 }
 
+Error report_coalesce_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    grbl_sendf(out->client(), "[MSG: Coalesce Lines in: %u Blocks out: %u]\r\n", mc_lines_in, mc_blocks_out);
+    // Each report covers the lines since the previous one, so a job can be measured on its own.
+    mc_lines_in   = 0;
+    mc_blocks_out = 0;
+    return Error::Ok;
+}
+
+#ifdef ENABLE_STEPPER_ISR_STATS
+Error report_stepper_stats(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
+    if (!value) {
+        report_stepper_isr_stats(out->client());
+        return Error::Ok;
+    }
+    if (strcasecmp(value, "RESET") == 0) {
+        st_isr_stats_reset();
+        return Error::Ok;
+    }
+    // Timing the same job both ways gives the cost of the per-motor pin writes
+    bool batch = strcasecmp(value, "BATCHED") == 0;
+    if (batch || strcasecmp(value, "UNBATCHED") == 0) {
+        motors_set_gpio_batching(batch);
+        st_isr_stats_reset();
+        return Error::Ok;
+    }
+    return Error::InvalidStatement;
+}
+#endif
+
 Error showState(const char* value, WebUI::AuthenticationLevel auth_level, WebUI::ESPResponseStream* out) {
     grbl_sendf(out->client(), "State 0x%x\r\n", sys.state);
     return Error::Ok;
@@ -445,6 +476,10 @@ void make_grbl_commands() {
     new GrblCommand("X", "Alarm/Disable", disable_alarm_lock, anyState);
     new GrblCommand("NVX", "Settings/Erase", Setting::eraseNVS, idleOrAlarm, WA);
     new GrblCommand("V", "Settings/Stats", Setting::report_nvs_stats, idleOrAlarm);
+    new GrblCommand("PC", "Planner/Coalesce/Stats", report_coalesce_stats, anyState);
+#ifdef ENABLE_STEPPER_ISR_STATS
+    new GrblCommand("SS", "Stepper/Stats", report_stepper_stats, anyState);
+#endif
     new GrblCommand("#", "GCode/Offsets", report_ngc, idleOrAlarm);
     new GrblCommand("H", "Home", home_all, idleOrAlarm);
     new GrblCommand("MD", "Motor/Disable", motor_disable, idleOrAlarm);
@@ -24,6 +24,8 @@
 
 #include "Grbl.h"
 
+#include <cmath>
+
 static void protocol_exec_rt_suspend();
 
 static char    line[LINE_BUFFER_SIZE];     // Line to be executed. Zero-terminated.
@@ -82,6 +84,7 @@ Error execute_line(char* line, uint8_t client, WebUI::AuthenticationLevel auth_l
     }
     // Grbl '$' or WebUI '[ESPxxx]' system command
     if (line[0] == '$' || line[0] == '[') {
+        mc_flush_held_line();  // System commands act on the planned motion.
         return system_execute_line(line, client, auth_level);
     }
     // Everything else is gcode. Block if in alarm or jog mode.
@@ -91,6 +94,174 @@ Error execute_line(char* line, uint8_t client, WebUI::AuthenticationLevel auth_l
     return gc_execute_line(line, client);
 }
 
+#ifdef ENABLE_SD_CARD
+// Runs the lines of an SD job back to back, each as soon as the one before returns, until the
+// planner is full. Reading ahead then fills the SD line queue while the planner drains. An error
+// closes the file where it is reported, which stops the job at the line that caused it.
+static void protocol_execute_sd() {
+    for (int lines = 0; SD_ready_next && lines < SDLineCount; lines++) {
+        if (plan_check_full_buffer()) {
+            break;
+        }
+        char                 fileLine[255];
+        gc_compiled_motion_t compiled;
+        compiled.motion = Motion::None;
+        if (!(SD_compiled ? readCompiledRecord(fileLine, 255, &compiled) : readFileLine(fileLine, 255))) {
+            if (get_sd_state(false) == SDState::BusyPrinting) {  // Errors close the file where they are reported
+                char temp[50];
+                sd_get_current_filename(temp);
+                grbl_notifyf("SD print done", "%s print is successful", temp);
+                closeFile();  // close file and clear SD ready/running flags
+            }
+            return;
+        }
+        SD_ready_next = false;
+        Error status;
+        if (compiled.motion == Motion::None) {
+            status = execute_line(fileLine, SD_client, SD_auth_level);
+        } else if (sys.state == State::Alarm || sys.state == State::Jog) {
+            status = Error::SystemGcLock;  // A compiled motion is g-code like its line
+        } else {
+            status = gc_execute_compiled(&compiled);
+        }
+        report_status_message(status, SD_client);
+        protocol_execute_realtime();  // Runtime command check point.
+        if (sys.abort) {
+            return;
+        }
+    }
+    if (SD_ready_next && !SD_compiled) {
+        sd_read_ahead();
+    }
+}
+#endif
+
+#ifdef ENABLE_BINARY_STREAM
+// The records in a frame of the binary stream follow each other. A record starts with a byte of
+// flags and a byte with the axis words of a motion, or the length of a text. The values the flags
+// ask for follow, in the order of the flags, and then an int32 per axis word, lowest axis first,
+// in steps of 0.1 um. Values are little-endian. Axis values are absolute work coordinates.
+enum BinaryRecordFlags : uint8_t {
+    BinaryRecordKind       = 0x03,    // Mask for the kind of record, one of the three below.
+    BinaryRecordLinear     = 0,       // G1
+    BinaryRecordSeek       = 1,       // G0
+    BinaryRecordText       = 2,       // A line of text, executed like a line from the client.
+    BinaryRecordHasLine    = bit(2),  // int32 line number
+    BinaryRecordHasFeed    = bit(3),  // float feed rate in mm/min
+    BinaryRecordHasSpindle = bit(4),  // float spindle speed
+};
+
+// Reads a value of a record. Returns false past the end of the frame.
+template <typename T>
+static bool read_record_value(const binary_frame_t* frame, uint8_t* offset, T* value) {
+    if (*offset + sizeof(T) > frame->length) {
+        return false;
+    }
+    memcpy(value, &frame->payload[*offset], sizeof(T));  // Little-endian, as the ESP32 is
+    *offset += sizeof(T);
+    return true;
+}
+
+// Executes the record at offset in a frame, and moves offset to the next one. A record that does
+// not fit the frame ends it.
+static Error execute_record(const binary_frame_t* frame, uint8_t* offset, uint8_t client) {
+    uint8_t flags, words;
+    if (!read_record_value(frame, offset, &flags) || !read_record_value(frame, offset, &words)) {
+        *offset = frame->length;
+        return Error::InvalidStatement;
+    }
+    uint8_t kind = flags & BinaryRecordKind;
+    if (kind == BinaryRecordText) {
+        if (*offset + words > frame->length) {
+            *offset = frame->length;
+            return Error::InvalidStatement;
+        }
+        if (words >= LINE_BUFFER_SIZE) {
+            *offset += words;
+            return Error::Overflow;  // As a client line too long for the line buffer
+        }
+        memcpy(line, &frame->payload[*offset], words);
+        line[words] = '\0';
+        *offset += words;
+        return execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST);
+    }
+    int32_t line_number   = 0;
+    float   feed_rate     = gc_state.feed_rate;
+    float   spindle_speed = gc_state.spindle_speed;
+    float   target[MAX_N_AXIS];
+    bool    ok = kind == BinaryRecordLinear || kind == BinaryRecordSeek;
+    if (ok && (flags & BinaryRecordHasLine)) {
+        ok = read_record_value(frame, offset, &line_number);
+    }
+    if (ok && (flags & BinaryRecordHasFeed)) {
+        ok = read_record_value(frame, offset, &feed_rate);
+    }
+    if (ok && (flags & BinaryRecordHasSpindle)) {
+        ok = read_record_value(frame, offset, &spindle_speed);
+    }
+    for (uint8_t idx = 0; ok && idx < MAX_N_AXIS; idx++) {
+        int32_t steps;
+        if (bit_istrue(words, bit(idx)) && (ok = read_record_value(frame, offset, &steps))) {
+            // Rounded as read_float() rounds the same number written with four decimals
+            if (labs(steps) < (1L << 24)) {
+                target[idx] = float(steps) / 1e4f;
+            } else {
+                target[idx] = double(steps) / 1e4;
+            }
+        }
+    }
+    if (!ok) {
+        *offset = frame->length;
+        return Error::InvalidStatement;
+    }
+    // The checks the g-code parser makes of F and S words
+    if (std::isnan(feed_rate) || std::isnan(spindle_speed)) {
+        return Error::BadNumberFormat;
+    }
+    if (feed_rate < 0.0 || spindle_speed < 0.0) {
+        return Error::NegativeValue;
+    }
+    if (sys.state == State::Alarm || sys.state == State::Jog) {
+        return Error::SystemGcLock;
+    }
+    Motion motion = kind == BinaryRecordSeek ? Motion::Seek : Motion::Linear;
+    return gc_execute_motion(motion, target, words, feed_rate, spindle_speed, line_number);
+}
+
+// Executes the frames of the binary client in order, and acknowledges each. Errors are reported
+// as [ERR:<seq>,<record index>,<error code>], and do not stop the records after them.
+static void protocol_execute_binary() {
+    uint8_t client = client_binary();
+    if (client == CLIENT_ALL) {
+        return;
+    }
+    binary_frame_t* frame;
+    while ((frame = client_peek_frame()) != NULL) {
+        protocol_execute_realtime();  // Runtime command check point.
+        if (sys.abort) {
+            return;
+        }
+        if (frame->type == BinaryFrame::Records) {
+            uint8_t index = 0;
+            for (uint8_t offset = 0; offset < frame->length; index++) {
+                Error status = execute_record(frame, &offset, client);
+                if (sys.abort) {
+                    return;
+                }
+                if (status != Error::Ok) {
+                    grbl_sendf(client, "[ERR:%d,%d,%d]\r\n", frame->seq, index, static_cast<int>(status));
+                }
+            }
+        } else {
+            client_end_binary();
+        }
+        uint8_t seq = frame->seq;
+        client_release_frame();
+        grbl_sendf(client, "[ACK:%d]\r\n", seq);
+    }
+}
+#endif
+
 bool can_park() {
     return
 #ifdef ENABLE_PARKING_OVERRIDE_CONTROL
@@ -138,55 +309,91 @@ void protocol_main_loop() {
     int c;
     for (;;) {
 #ifdef ENABLE_SD_CARD
-        if (SD_ready_next) {
-            char fileLine[255];
-            if (readFileLine(fileLine, 255)) {
-                SD_ready_next = false;
-                report_status_message(execute_line(fileLine, SD_client, SD_auth_level), SD_client);
-            } else {
-                char temp[50];
-                sd_get_current_filename(temp);
-                grbl_notifyf("SD print done", "%s print is successful", temp);
-                closeFile();  // close file and clear SD ready/running flags
-            }
+        protocol_execute_sd();
+        if (sys.abort) {
+            return;  // Bail to calling function upon system abort
         }
 #endif
         // Receive one line of incoming serial data, as the data becomes available.
-        // Filtering, if necessary, is done later in gc_execute_line(), so the
-        // filtering is the same with serial and file input.
+        // Filtering, if necessary, is done later in gc_execute_line(), see collapseGCode().
+        // A complete line is executed where it sits in the client read buffer. Lines that
+        // cannot be, and lines that arrive in pieces, are assembled one character at a time.
         uint8_t client = CLIENT_SERIAL;
         char*   line;
+        size_t  size;
         for (client = 0; client < CLIENT_COUNT; client++) {
-            while ((c = client_read(client)) != -1) {
-                Error res = add_char_to_line(c, client);
-                switch (res) {
-                    case Error::Ok:
-                        break;
-                    case Error::Eol:
-                        protocol_execute_realtime();  // Runtime command check point.
-                        if (sys.abort) {
-                            return;  // Bail to calling function upon system abort
-                        }
-                        line = client_lines[client].buffer;
+            for (;;) {
+                client_line_t* cl = &client_lines[client];
+                line              = NULL;
+                size              = 0;
+                if (cl->len == 0) {
+                    // Longer lines are read a character at a time to report the overflow.
+                    line = client_peek_line(client, &size, LINE_BUFFER_SIZE - 1);
+                }
+                if (line != NULL) {
+                    protocol_execute_realtime();  // Runtime command check point.
+                    if (sys.abort) {
+                        return;  // Bail to calling function upon system abort
+                    }
 #ifdef REPORT_ECHO_RAW_LINE_RECEIVED
-                        report_echo_line_received(line, client);
+                    report_echo_line_received(line, client);
 #endif
-                        // auth_level can be upgraded by supplying a password on the command line
-                        report_status_message(execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST), client);
-                        empty_line(client);
-                        break;
-                    case Error::Overflow:
-                        report_status_message(Error::Overflow, client);
-                        empty_line(client);
-                        break;
-                    default:
-                        break;
+                    // auth_level can be upgraded by supplying a password on the command line
+                    report_status_message(execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST), client);
+                    client_release_line(client, size);
+                    cl->line_number++;
+                    continue;
+                }
+                if (cl->len == 0 && size == 0) {
+                    break;  // No complete line yet. Leave partial input in the buffer.
                 }
-            }  // while serial read
-        }      // for clients
+                bool eol = false;
+                while (!eol && (c = client_read(client)) != -1) {
+                    Error res = add_char_to_line(c, client);
+                    switch (res) {
+                        case Error::Ok:
+                            break;
+                        case Error::Eol:
+                            eol = true;
+                            protocol_execute_realtime();  // Runtime command check point.
+                            if (sys.abort) {
+                                return;  // Bail to calling function upon system abort
+                            }
+                            line = client_lines[client].buffer;
+#ifdef REPORT_ECHO_RAW_LINE_RECEIVED
+                            report_echo_line_received(line, client);
+#endif
+                            // auth_level can be upgraded by supplying a password on the command line
+                            report_status_message(execute_line(line, client, WebUI::AuthenticationLevel::LEVEL_GUEST), client);
+                            empty_line(client);
+                            break;
+                        case Error::Overflow:
+                            eol = true;
+                            report_status_message(Error::Overflow, client);
+                            empty_line(client);
+                            break;
+                        default:
+                            break;
+                    }
+                }  // while serial read
+                if (!eol) {
+                    break;  // Out of characters in the middle of a line
+                }
+            }
+        }  // for clients
+#ifdef ENABLE_BINARY_STREAM
+        protocol_execute_binary();
+        if (sys.abort) {
+            return;  // Bail to calling function upon system abort
+        }
+#endif
         // If there are no more characters in the serial read buffer to be processed and executed,
         // this indicates that g-code streaming has either filled the planner buffer or has
-        // completed. In either case, auto-cycle start, if enabled, any queued moves.
+        // completed. In either case, auto-cycle start, if enabled, any queued moves. The arc or
+        // spline in progress gets segments as the planner drains. A line held back for coalescing is planned
+        // once the stepper is about to go idle or no more input came for a while.
+        mc_continue_curve();
+        mc_flush_stale_held_line();
         protocol_auto_cycle_start();
         protocol_execute_realtime();  // Runtime command check point.
         if (sys.abort) {
@@ -205,6 +412,7 @@ void protocol_main_loop() {
 // Block until all buffered steps are executed or in a cycle state. Works with feed hold
 // during a synchronize call, if it should happen. Also, waits for clean cycle end.
 void protocol_buffer_synchronize() {
+    mc_flush_held_line();
     // If system is queued, ensure cycle resumes if the auto start flag is present.
     protocol_auto_cycle_start();
     do {
@@ -291,6 +499,7 @@ void protocol_exec_rt_system() {
                 // If in CYCLE or JOG states, immediately initiate a motion HOLD.
                 if (sys.state == State::Cycle || sys.state == State::Jog) {
                     if (!(sys.suspend.bit.motionCancel || sys.suspend.bit.jogCancel)) {  // Block, if already holding.
+                        st_hold_ramp();                     // Slow down the steps already queued for output.
                         st_update_plan_block_parameters();  // Notify stepper module to recompute for hold deceleration.
                         sys.step_control             = {};
                         sys.step_control.executeHold = true;  // Initiate suspend state with active flag.
@@ -339,6 +548,7 @@ void protocol_exec_rt_system() {
 #ifdef PARKING_ENABLE
                                 // Set hold and reset appropriate control flags to restart parking sequence.
                                 if (sys.step_control.executeSysMotion) {
+                                    st_hold_ramp();                     // Slow down the steps already queued for output.
                                     st_update_plan_block_parameters();  // Notify stepper module to recompute for hold deceleration.
                                     sys.step_control                  = {};
                                     sys.step_control.executeHold      = true;
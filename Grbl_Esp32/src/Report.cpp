@@ -69,7 +69,7 @@ void grbl_sendf(uint8_t client, const char* format, ...) {
     va_list copy;
     va_start(arg, format);
     va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
+    size_t len = vsnprintf(NULL, 0, format, copy);
     va_end(copy);
     if (len >= sizeof(loc_buf)) {
         temp = new char[len + 1];
@@ -102,7 +102,7 @@ void grbl_msg_sendf(uint8_t client, MsgLevel level, const char* format, ...) {
     va_list copy;
     va_start(arg, format);
     va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
+    size_t len = vsnprintf(NULL, 0, format, copy);
     va_end(copy);
     if (len >= sizeof(loc_buf)) {
         temp = new char[len + 1];
@@ -132,7 +132,7 @@ void grbl_notifyf(const char* title, const char* format, ...) {
     va_list copy;
     va_start(arg, format);
     va_copy(copy, arg);
-    size_t len = vsnprintf(NULL, 0, format, arg);
+    size_t len = vsnprintf(NULL, 0, format, copy);
     va_end(copy);
     if (len >= sizeof(loc_buf)) {
         temp = new char[len + 1];
@@ -217,14 +217,15 @@ void report_status_message(Error status_code, uint8_t client) {
 #ifdef ENABLE_SD_CARD
             // do we need to stop a running SD job?
             if (get_sd_state(false) == SDState::BusyPrinting) {
+                // The status of a line of the job only goes to the client that runs it
                 if (status_code == Error::GcodeUnsupportedCommand) {
                     grbl_sendf(client, "error:%d\r\n", status_code);  // most senders seem to tolerate this error and keep on going
-                    grbl_sendf(CLIENT_ALL, "error:%d in SD file at line %d\r\n", status_code, sd_get_current_line_number());
+                    grbl_sendf(client, "error:%d in SD file at line %d\r\n", status_code, sd_get_current_line_number());
                     // don't close file
                     SD_ready_next = true;  // flag so system_execute_line() will send the next line
                 } else {
                     grbl_notifyf("SD print error", "Error:%d during SD file at line: %d", status_code, sd_get_current_line_number());
-                    grbl_sendf(CLIENT_ALL, "error:%d in SD file at line %d\r\n", status_code, sd_get_current_line_number());
+                    grbl_sendf(client, "error:%d in SD file at line %d\r\n", status_code, sd_get_current_line_number());
                     closeFile();
                 }
                 return;
@@ -343,7 +344,7 @@ void report_ngc_parameters(uint8_t client) {
 // Print current gcode parser mode state
 void report_gcode_modes(uint8_t client) {
     char        temp[20];
-    char        modes_rpt[75];
+    char        modes_rpt[100];
     const char* mode = "";
     strcpy(modes_rpt, "[GC:");
 
@@ -363,6 +364,12 @@ void report_gcode_modes(uint8_t client) {
         case Motion::CcwArc:
             mode = "G3";
             break;
+        case Motion::CubicSpline:
+            mode = "G5";
+            break;
+        case Motion::QuadraticSpline:
+            mode = "G5.1";
+            break;
         case Motion::ProbeToward:
             mode = "G38.1";
             break;
@@ -432,6 +439,24 @@ void report_gcode_modes(uint8_t client) {
     }
     strcat(modes_rpt, mode);
 
+    switch (gc_state.modal.control) {
+        case ControlMode::ExactPath:
+            mode = " G61";
+            break;
+        case ControlMode::ContinuousPath:
+            mode = " G64";
+            break;
+    }
+    strcat(modes_rpt, mode);
+    if (gc_state.modal.control == ControlMode::ContinuousPath && gc_state.path_tolerance > 0.0) {
+        if (report_inches->get()) {
+            snprintf(temp, sizeof(temp), " P%.4f", gc_state.path_tolerance / MM_PER_INCH);
+        } else {
+            snprintf(temp, sizeof(temp), " P%.3f", gc_state.path_tolerance);
+        }
+        strcat(modes_rpt, temp);
+    }
+
     //report_util_gcode_modes_M();
     switch (gc_state.modal.program_flow) {
         case ProgramFlow::Running:
@@ -786,8 +811,10 @@ void report_realtime_status(uint8_t client) {
 void report_realtime_steps() {
     uint8_t idx;
     auto    n_axis = number_axis->get();
+    int32_t steps[MAX_N_AXIS];
+    st_get_position(steps);
     for (idx = 0; idx < n_axis; idx++) {
-        grbl_sendf(CLIENT_ALL, "%ld\n", sys_position[idx]);  // OK to send to all ... debug stuff
+        grbl_sendf(CLIENT_ALL, "%ld\n", steps[idx]);  // OK to send to all ... debug stuff
     }
 }
 
@@ -809,6 +836,39 @@ void report_machine_type(uint8_t client) {
     grbl_msg_sendf(client, MsgLevel::Info, "Using machine:%s", MACHINE_NAME);
 }
 
+#ifdef ENABLE_STEPPER_ISR_STATS
+static void report_isr_histogram(uint8_t client, const char* name, const isr_histogram_t& histogram) {
+    if (histogram.count == 0) {
+        grbl_sendf(client, "[MSG:%s cycles none]\r\n", name);
+        return;
+    }
+    grbl_sendf(client,
+               "[MSG:%s cycles min:%u mean:%u max:%u]\r\n",
+               name,
+               histogram.min,
+               uint32_t(histogram.total / histogram.count),
+               histogram.max);
+    // Non-empty bins only, as 2^n:count
+    char bins[ISR_STATS_BINS * 16];
+    int  len = 0;
+    for (int bin = 0; bin < ISR_STATS_BINS; bin++) {
+        if (histogram.bins[bin]) {
+            len += snprintf(bins + len, sizeof(bins) - len, " 2^%d:%u", bin, histogram.bins[bin]);
+        }
+    }
+    grbl_sendf(client, "[MSG:%s histogram%s]\r\n", name, bins);
+}
+
+void report_stepper_isr_stats(uint8_t client) {
+    // Read once, since the ISR keeps updating them
+    stepper_isr_stats_t stats = stepper_isr_stats;
+    grbl_sendf(client, "[MSG:Step ISR calls:%u skipped:%u cpu:%uMHz]\r\n", stats.duration.count, stats.skipped, ESP.getCpuFreqMHz());
+    report_isr_histogram(client, "Duration", stats.duration);
+    report_isr_histogram(client, "Jitter", stats.jitter);
+    report_isr_histogram(client, "Pins", stats.pins);
+}
+#endif
+
 /*
     Print a message in hex format
     Ex: report_hex_msg(msg, "Rx:", 6);
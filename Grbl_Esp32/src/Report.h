@@ -119,6 +119,10 @@ void report_realtime_debug();
 
 void report_machine_type(uint8_t client);
 
+#ifdef ENABLE_STEPPER_ISR_STATS
+void report_stepper_isr_stats(uint8_t client);
+#endif
+
 void report_hex_msg(char* buf, const char* prefix, int len);
 void report_hex_msg(uint8_t* buf, const char* prefix, int len);
 
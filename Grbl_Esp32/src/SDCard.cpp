@@ -28,6 +28,138 @@ uint8_t                    SD_client     = CLIENT_SERIAL;
 WebUI::AuthenticationLevel SD_auth_level = WebUI::AuthenticationLevel::LEVEL_GUEST;
 uint32_t                   sd_current_line_number;     // stores the most recent line number read from the SD
 static char                comment[LINE_BUFFER_SIZE];  // Line to be executed. Zero-terminated.
+bool                       SD_compiled = false;
+static uint32_t            sd_source_size;       // Size and position in the source file of a compiled job
+static uint32_t            sd_source_position;   //
+static uint32_t            sd_compiled_records;  // Records of the compiled job not read yet
+
+/*
+  Text files are read a block at a time by sdPrefetchTask, on the core that does not run the
+  protocol loop, into two buffers. sd_read_ahead() scans one buffer for lines while the task fills
+  the other, instead of reading the file a byte at a time through the file system layers. Blocks
+  are a multiple of the 512-byte sector, and are read in order from the start of the file, or of
+  the sector a resumed job starts in, so every read is sector-aligned.
+*/
+const int SDBlockSize  = 4096;
+const int SDBlockCount = 2;
+
+typedef struct {
+    uint8_t index;   // Buffer of the block
+    int32_t length;  // Bytes read into it, zero at the end of the file
+} sd_block_t;
+
+static uint8_t       sd_buffers[SDBlockCount][SDBlockSize];
+static QueueHandle_t sd_empty_blocks = NULL;  // Buffers for sdPrefetchTask to fill, in file order
+static QueueHandle_t sd_full_blocks  = NULL;  // Blocks it has read, in file order
+static int           sd_blocks_out;           // Blocks sdPrefetchTask has not handed back
+static bool          sd_reading;              // sdPrefetchTask reads the open file
+static sd_block_t    sd_block;                // The block sd_read_ahead() scans, and its next byte
+static int32_t       sd_block_pos;            //
+static int32_t       sd_block_skip;           // Bytes of the first block before where reading starts
+static uint32_t      sd_file_size;            // Size of the open file
+static uint32_t      sd_file_position;        // Bytes of it read into the line queue
+
+/*
+  readFileLine() hands out the lines of a text file from a queue, which sd_read_ahead() fills
+  while the planner is full, so that the protocol loop runs the lines of a job back to back. The
+  g-code lines in the queue are already collapsed. Errors reading a line are queued with it, and
+  reported when the job gets to it.
+*/
+typedef struct {
+    char     text[LINE_BUFFER_SIZE];
+    uint32_t number;    // Line number in the file
+    uint32_t position;  // Position in the file after the line
+    Error    status;    // Error reading the line
+} sd_line_t;
+
+static sd_line_t sd_lines[SDLineCount];
+static int       sd_line_head;         // Next line readFileLine() hands out
+static int       sd_line_count;        // Lines in the queue
+static bool      sd_lines_end;         // The queue has the last line of the file, or an error
+static uint32_t  sd_read_line_number;  // Lines read into the queue
+static uint32_t  sd_line_position;     // Position in the file after the line handed out last
+
+/*
+  The index of a text file is a sidecar file with the position of every SDIndexLines-th line,
+  and the modal state that the lines before it leave, so that a job resumes from a line without
+  reading the file from the top. A run from the top of a file of at least SDIndexMinSize bytes
+  that has no complete index writes one as the file is read, and $SD/Index writes it on demand.
+  Entries are flushed as they are written, so a run that is cut short leaves an index of the
+  lines it got to. An index is for the size and last write time of its file.
+
+  The modal state comes from a scan of the modal words of the lines, without parsing them: the
+  motion mode, plane, units, distance mode, work coordinate system, feed rate mode, feed rate,
+  G49, spindle and coolant. Offsets that G10, G28.1, G30.1, G43.1 and G92 set are not followed,
+  so a job does not resume from a line after one of them.
+*/
+const uint32_t IndexMagic     = 0x4A444921;  // "!IDJ"
+const uint32_t SDIndexLines   = 1000;
+const uint32_t SDIndexMinSize = 32768;  // Smaller files are quick to scan from the top
+const uint8_t  SDModalUnset   = 0xff;
+
+typedef struct {
+    float   feed_rate;      // F in mm/min, negative until set
+    float   spindle_speed;  // S, negative until set
+    uint8_t motion;         // G0-G3, G5 or G80
+    uint8_t plane;          // G17-G19
+    uint8_t units;          // G20 or G21
+    uint8_t distance;       // G90 or G91
+    uint8_t coord_select;   // G54-G59
+    uint8_t feed_mode;      // G93 or G94
+    uint8_t tool_length;    // G49
+    uint8_t spindle;        // M3-M5
+    uint8_t coolant;        // bit(0) for M7 mist, bit(1) for M8 flood
+    uint8_t offsets;        // Non-zero after a G10, G28.1, G30.1, G43.1 or G92 line
+} sd_modal_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t header_size;  // sizeof(index_header_t)
+    uint16_t entry_size;   // sizeof(index_entry_t)
+    uint32_t interval;     // SDIndexLines
+    uint32_t source_size;  // Bytes in the source file
+    uint32_t source_time;  // Last write time of the source file
+    uint32_t lines;        // Lines in the source file, zero until the index is complete
+} index_header_t;
+
+// Entry n is for line (n + 1) * SDIndexLines + 1
+typedef struct {
+    uint32_t   position;  // Position of the line in the source file
+    sd_modal_t modal;     // Modal state before the line
+} index_entry_t;
+
+static File       sd_index;  // Index the reader writes, while open
+static sd_modal_t sd_modal;  // Modal state the lines read so far leave
+
+/*
+  A compiled job is the source file parsed once, by $SD/Compile. It is a header, and then a
+  record for each line of the source file that is not empty. The record of a line that is only a
+  motion in the motion mode holds the motion with its target and offsets resolved, which
+  $SD/RunCompiled plans without parsing it. The record of any other line holds its text, which
+  runs like the line of a source file. Each record keeps the number of its line and where it ends
+  in the source file, so line numbers and progress reports are the ones of the source file.
+
+  The motions only come out right from the same parser state, settings and stored coordinate
+  systems, so a job does not run when any of them has changed. The structures are written as
+  they are in memory, so a job only runs on the build that compiled it.
+*/
+const uint32_t CompiledMagic = 0x4A434721;  // "!GCJ"
+
+typedef struct {
+    uint32_t       magic;          // Written last, when the job is complete
+    uint16_t       header_size;    // sizeof(compiled_header_t)
+    uint16_t       motion_size;    // sizeof(gc_compiled_motion_t)
+    uint32_t       settings_hash;  // sd_settings_hash() when compiled
+    uint32_t       source_size;    // Bytes in the source file
+    uint32_t       records;        // Records that follow
+    parser_state_t state;          // Parser state the job starts from
+} compiled_header_t;
+
+typedef struct {
+    uint32_t line;    // Line number in the source file
+    uint32_t offset;  // Position in the source file after the line
+    uint16_t length;  // Bytes of text that follow. A gc_compiled_motion_t follows instead when zero.
+} compiled_record_t;
 
 // attempt to mount the SD card
 /*bool sd_mount()
@@ -63,6 +195,66 @@ void listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client) {
     }
 }
 
+static void sdPrefetchTask(void* pvParameters) {
+    uint8_t index;
+    while (true) {
+        xQueueReceive(sd_empty_blocks, &index, portMAX_DELAY);
+        sd_block_t block = { index, (int32_t)myFile.read(sd_buffers[index], SDBlockSize) };
+        xQueueSend(sd_full_blocks, &block, portMAX_DELAY);
+    }
+}
+
+// Has sdPrefetchTask read the open file from the start, into every buffer
+static void sd_start_reading() {
+    if (!sd_full_blocks) {
+        sd_empty_blocks = xQueueCreate(SDBlockCount, sizeof(uint8_t));
+        sd_full_blocks  = xQueueCreate(SDBlockCount, sizeof(sd_block_t));
+        xTaskCreatePinnedToCore(sdPrefetchTask,    // task
+                                "sdPrefetchTask",  // name for task
+                                4096,              // size of task stack
+                                NULL,              // parameters
+                                1,                 // priority
+                                NULL,
+                                0  // the core that does not run the protocol loop
+        );
+    }
+    for (uint8_t index = 0; index < SDBlockCount; index++) {
+        xQueueSend(sd_empty_blocks, &index, portMAX_DELAY);
+    }
+    sd_blocks_out = SDBlockCount;
+    sd_reading    = true;
+}
+
+// Waits until sdPrefetchTask has handed back every block, and so no longer reads the open file
+static void sd_stop_reading() {
+    sd_block_t block;
+    while (sd_blocks_out) {
+        xQueueReceive(sd_full_blocks, &block, portMAX_DELAY);
+        sd_blocks_out--;
+    }
+    sd_reading       = false;
+    sd_block.length  = 0;
+    sd_block_pos     = 0;
+    sd_file_position = 0;
+}
+
+// Moves on to the next block of the open file. Returns false at its end.
+static bool sd_next_block() {
+    if (!sd_reading) {
+        sd_start_reading();
+    } else if (sd_block.length == 0) {
+        return false;  // The end of the file was reached before
+    } else {
+        xQueueSend(sd_empty_blocks, &sd_block.index, portMAX_DELAY);
+        sd_blocks_out++;
+    }
+    xQueueReceive(sd_full_blocks, &sd_block, portMAX_DELAY);
+    sd_blocks_out--;
+    sd_block_pos  = (sd_block_skip < sd_block.length) ? sd_block_skip : sd_block.length;
+    sd_block_skip = 0;
+    return sd_block.length > sd_block_pos;
+}
+
 boolean openFile(fs::FS& fs, const char* path) {
     myFile = fs.open(path);
     if (!myFile) {
@@ -72,6 +264,14 @@ boolean openFile(fs::FS& fs, const char* path) {
     set_sd_state(SDState::BusyPrinting);
     SD_ready_next          = false;  // this will get set to true when Grbl issues "ok" message
     sd_current_line_number = 0;
+    sd_file_size           = myFile.size();
+    sd_file_position       = 0;
+    sd_line_head           = 0;
+    sd_line_count          = 0;
+    sd_lines_end           = false;
+    sd_read_line_number    = 0;
+    sd_line_position       = 0;
+    sd_block_skip          = 0;
     return true;
 }
 
@@ -79,40 +279,245 @@ boolean closeFile() {
     if (!myFile) {
         return false;
     }
+    sd_stop_reading();
+    sd_line_count = 0;
+    if (sd_index) {
+        sd_index.close();  // What it has so far is still good
+    }
     set_sd_state(SDState::Idle);
     SD_ready_next          = false;
+    SD_compiled            = false;
     sd_current_line_number = 0;
+    gc_compiled_end();
     myFile.close();
     SD.end();
     return true;
 }
 
+// A modal state where nothing is set
+static void sd_clear_modal(sd_modal_t* modal) {
+    memset(modal, SDModalUnset, sizeof(sd_modal_t));
+    modal->feed_rate     = -1.0;
+    modal->spindle_speed = -1.0;
+    modal->offsets       = 0;
+}
+
+// Follows the modal words of a line of text in modal, leaving out comments
+static void sd_scan_modal(const char* text, sd_modal_t* modal) {
+    if (text[0] == '$' || text[0] == '[') {
+        return;  // System commands
+    }
+    char    words[LINE_BUFFER_SIZE];  // The line without spaces and comments, in upper case
+    uint8_t length  = 0;
+    bool    comment = false;
+    for (; *text != '\0' && *text != ';'; text++) {
+        if (*text == '(') {
+            comment = true;
+        } else if (*text == ')') {
+            comment = false;
+        } else if (!comment && !isspace(*text)) {
+            words[length++] = toupper(*text);
+        }
+    }
+    words[length] = '\0';
+    float feed_rate    = -1.0;
+    bool  inverse_time = modal->feed_mode == 93;
+    for (uint8_t counter = 0; words[counter] != '\0';) {
+        char  letter = words[counter++];
+        float value;
+        if (!read_float(words, &counter, &value)) {
+            continue;
+        }
+        int number = (int)value;
+        int tenths = lroundf(value * 10);
+        if (letter == 'F') {
+            feed_rate = value;
+        } else if (letter == 'S') {
+            modal->spindle_speed = value;
+        } else if (letter == 'G' && (number == 10 || number == 92 || tenths == 281 || tenths == 301 || tenths == 431)) {
+            modal->offsets = 1;
+        } else if (value < 0 || value != number) {
+            continue;  // G38.2, G59.1 and the like are not followed
+        } else if (letter == 'G') {
+            if (number <= 3 || number == 5 || number == 80) {
+                modal->motion = number;
+            } else if (number >= 17 && number <= 19) {
+                modal->plane = number;
+            } else if (number == 20 || number == 21) {
+                modal->units = number;
+            } else if (number == 90 || number == 91) {
+                modal->distance = number;
+            } else if (number >= 54 && number <= 59) {
+                modal->coord_select = number;
+            } else if (number == 93 || number == 94) {
+                modal->feed_mode = number;
+            } else if (number == 49) {
+                modal->tool_length = number;
+            }
+        } else if (letter == 'M') {
+            if (number >= 3 && number <= 5) {
+                modal->spindle = number;
+            } else if (number == 7 || number == 8) {
+                modal->coolant = (modal->coolant == SDModalUnset) ? bit(number - 7) : (modal->coolant | bit(number - 7));
+            } else if (number == 9) {
+                modal->coolant = 0;
+            } else if (number == 2 || number == 30) {
+                // Program end sets the modes the way gc_execute_line() does
+                modal->motion       = 1;
+                modal->plane        = 17;
+                modal->distance     = 90;
+                modal->coord_select = 54;
+                modal->feed_mode    = 94;
+                modal->spindle      = 5;
+                modal->coolant      = 0;
+            }
+        }
+    }
+    if (modal->feed_mode == 93) {
+        modal->feed_rate = -1.0;  // An inverse time feed rate is for its own line only
+    } else if (feed_rate >= 0) {
+        modal->feed_rate = (modal->units == 20) ? feed_rate * MM_PER_INCH : feed_rate;  // In the units of the line
+    } else if (inverse_time) {
+        modal->feed_rate = -1.0;  // G94 after G93 leaves it unset until an F word
+    }
+}
+
+static index_header_t sd_index_header(uint32_t lines) {
+    index_header_t header = {
+        IndexMagic, sizeof(index_header_t), sizeof(index_entry_t), SDIndexLines, sd_file_size, (uint32_t)myFile.getLastWrite(), lines
+    };
+    return header;
+}
+
+// An index header is good when it is for this firmware and the open file, complete or not
+static bool sd_index_header_valid(const index_header_t* header) {
+    index_header_t expected = sd_index_header(header->lines);
+    return memcmp(header, &expected, sizeof(index_header_t)) == 0;
+}
+
+// Adds a line the reader read, which starts at position, to the index being written
+static void sd_index_line(uint32_t number, uint32_t position, const char* text) {
+    if (number > 1 && (number - 1) % SDIndexLines == 0) {
+        index_entry_t entry = { position, sd_modal };
+        sd_index.write((uint8_t*)&entry, sizeof(entry));
+        sd_index.flush();  // A job cut short keeps the index of the lines it got to
+    }
+    sd_scan_modal(text, &sd_modal);
+}
+
+// Closes the index being written, with the number of lines in the file when it is complete
+static void sd_end_index(bool complete) {
+    if (!sd_index) {
+        return;
+    }
+    if (complete) {
+        index_header_t header = sd_index_header(sd_read_line_number - 1);
+        sd_index.seek(0);
+        sd_index.write((uint8_t*)&header, sizeof(header));
+    }
+    sd_index.close();
+}
+
+// Reads the next line of the open file into line, without its line ending, LF or CRLF. Returns
+// false at the end of the file. A line too long for the queue, or a file that ends early, is read
+// as its error, which ends the reading.
+static bool sd_read_line(sd_line_t* line) {
+    char*    text    = line->text;
+    int      len     = 0;
+    bool     newline = false;
+    uint32_t start = sd_file_position;
+    line->number   = ++sd_read_line_number;
+    line->status   = Error::Ok;
+    while (!newline) {
+        if (sd_block_pos == sd_block.length && !sd_next_block()) {
+            if (sd_file_position != sd_file_size) {
+                line->status = Error::FsFailedRead;
+            }
+            break;
+        }
+        // Copy up to the end of the line, or of the block when the line goes on in the next one
+        const uint8_t* start = &sd_buffers[sd_block.index][sd_block_pos];
+        int32_t        count = sd_block.length - sd_block_pos;
+        const uint8_t* end   = (const uint8_t*)memchr(start, '\n', count);
+        if (end) {
+            count   = end - start;
+            newline = true;
+        }
+        if (len + count >= LINE_BUFFER_SIZE) {
+            line->status = Error::Overflow;
+            break;
+        }
+        memcpy(text + len, start, count);
+        len += count;
+        sd_block_pos += count + newline;
+        sd_file_position += count + newline;
+    }
+    line->position = sd_file_position;
+    if (line->status != Error::Ok) {
+        sd_end_index(false);
+        sd_lines_end = true;
+        return true;
+    }
+    if (len && text[len - 1] == '\r') {
+        len--;
+    }
+    text[len] = '\0';
+    // A line with a comment is collapsed when it runs, so that the comment is reported then
+    if (isalpha(text[0]) && !strpbrk(text, "(;")) {
+        collapseGCode(text);
+    }
+    if (!len && sd_file_position == sd_file_size) {
+        sd_end_index(true);
+        return false;
+    }
+    if (sd_index) {
+        sd_index_line(line->number, start, text);
+    }
+    return true;
+}
+
+// Reads lines of the open file into the queue until it is full
+void sd_read_ahead() {
+    while (myFile && !sd_lines_end && sd_line_count < SDLineCount) {
+        if (!sd_read_line(&sd_lines[(sd_line_head + sd_line_count) % SDLineCount])) {
+            sd_lines_end = true;
+            break;
+        }
+        sd_line_count++;
+    }
+}
+
 /*
-  read a line from the SD card
-  strip whitespace
-  strip comments per http://linuxcnc.org/docs/ja/html/gcode/overview.html#gcode:comments
-  make uppercase
-  return true if a line is
+  read the next line of the SD card from the queue
+  return true if a line is, false at the end of the file and after an error, which is reported
+  and ends the job: a line longer than maxlen - 1 characters, or a file that ends early
 */
 boolean readFileLine(char* line, int maxlen) {
     if (!myFile) {
         report_status_message(Error::FsFailedRead, SD_client);
         return false;
     }
-    sd_current_line_number += 1;
-    int len = 0;
-    while (myFile.available()) {
-        if (len >= maxlen) {
+    if (sd_line_count == 0) {
+        sd_read_ahead();
+        if (sd_line_count == 0) {
             return false;
         }
-        char c = myFile.read();
-        if (c == '\n') {
-            break;
-        }
-        line[len++] = c;
     }
-    line[len] = '\0';
-    return len || myFile.available();
+    sd_line_t* next = &sd_lines[sd_line_head];
+    sd_line_head    = (sd_line_head + 1) % SDLineCount;
+    sd_line_count--;
+    sd_current_line_number = next->number;
+    sd_line_position       = next->position;
+    Error status           = next->status;
+    if (status == Error::Ok && strlen(next->text) >= (size_t)maxlen) {
+        status = Error::Overflow;
+    }
+    if (status != Error::Ok) {
+        report_status_message(status, SD_client);
+        return false;
+    }
+    strcpy(line, next->text);
+    return true;
 }
 
 // return a percentage complete 50.5 = 50.5%
@@ -120,7 +525,10 @@ float sd_report_perc_complete() {
     if (!myFile) {
         return 0.0;
     }
-    return (float)myFile.position() / (float)myFile.size() * 100.0f;
+    if (SD_compiled) {
+        return sd_source_size ? (float)sd_source_position / (float)sd_source_size * 100.0f : 100.0f;
+    }
+    return sd_file_size ? (float)sd_line_position / (float)sd_file_size * 100.0f : 100.0f;
 }
 
 uint32_t sd_get_current_line_number() {
@@ -171,4 +579,343 @@ void sd_get_current_filename(char* name) {
         name[0] = 0;
     }
 }
+
+static String sd_sidecar_path(String path, const char* extension) {
+    int dot = path.lastIndexOf('.');
+    if (dot > path.lastIndexOf('/')) {
+        path.remove(dot);
+    }
+    return path + extension;
+}
+
+// The compiled job of /job.nc is /job.gcj
+String sd_compiled_path(String path) {
+    return sd_sidecar_path(path, ".gcj");
+}
+
+// The index of /job.nc is /job.idx
+String sd_index_path(String path) {
+    return sd_sidecar_path(path, ".idx");
+}
+
+static uint32_t sd_hash(uint32_t hash, const void* data, size_t size) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    while (size--) {
+        hash = (hash ^ *bytes++) * 16777619;  // FNV-1a
+    }
+    return hash;
+}
+
+// Hashes what a compiled job depends on besides the parser state: the settings, and the stored
+// coordinate systems a G54-G59, G28 or G30 in the job loads.
+static uint32_t sd_settings_hash() {
+    uint32_t hash = 2166136261;
+    for (Setting* s = Setting::List; s; s = s->next()) {
+        if (s->getType() == GRBL || s->getType() == EXTENDED) {
+            const char* name  = s->getName();
+            const char* value = s->getStringValue();
+            hash              = sd_hash(hash, name, strlen(name) + 1);
+            hash              = sd_hash(hash, value, strlen(value) + 1);
+        }
+    }
+    for (CoordIndex index = CoordIndex::Begin; index < CoordIndex::End; ++index) {
+        hash = sd_hash(hash, coords[index]->get(), MAX_N_AXIS * sizeof(float));
+    }
+    return hash;
+}
+
+static bool sd_same_floats(const float* a, const float* b, int count) {
+    for (int i = 0; i < count; i++) {
+        if (a[i] != b[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The compiled targets hold the units, distance mode and offsets the job was compiled with, so
+// those must be the same. G54-G59 load their offsets from the stored ones, which
+// sd_settings_hash() covers. The position may differ: see gc_compiled_begin().
+static bool sd_same_parser_state(const parser_state_t* state) {
+    return state->modal.units == gc_state.modal.units && state->modal.distance == gc_state.modal.distance &&
+           state->modal.coord_select == gc_state.modal.coord_select && state->tool_length_offset == gc_state.tool_length_offset &&
+           sd_same_floats(state->coord_system, gc_state.coord_system, MAX_N_AXIS) &&
+           sd_same_floats(state->coord_offset, gc_state.coord_offset, MAX_N_AXIS);
+}
+
+// Sets the parser modes a compiled job was compiled in that do not drive an output, so that its
+// motions and lines run in them. Spindle state and speed, coolant and tool stay as they are, as
+// for a text job.
+static void sd_load_parser_state(const parser_state_t* state) {
+    gc_state.modal.motion       = state->modal.motion;
+    gc_state.modal.feed_rate    = state->modal.feed_rate;
+    gc_state.modal.plane_select = state->modal.plane_select;
+    gc_state.modal.control      = state->modal.control;
+    gc_state.feed_rate          = state->feed_rate;
+    gc_state.path_tolerance     = state->path_tolerance;
+    memcpy(gc_state.spline_control, state->spline_control, sizeof(gc_state.spline_control));
+}
+
+// Compiles the open file into its compiled job, from the current parser state, which is kept.
+// Lines fail to compile where they would fail to run, except for unsupported commands, which
+// a job skips over.
+Error compileFile(fs::FS& fs) {
+    String path = sd_compiled_path(myFile.name());
+    File   job  = fs.open(path.c_str(), FILE_WRITE);
+    if (!job) {
+        return Error::FsFailedOpenFile;
+    }
+    compiled_header_t header;
+    memset(&header, 0, sizeof(header));
+    header.header_size   = sizeof(compiled_header_t);
+    header.motion_size   = sizeof(gc_compiled_motion_t);
+    header.settings_hash = sd_settings_hash();
+    header.source_size   = myFile.size();
+    memcpy(&header.state, &gc_state, sizeof(parser_state_t));
+    job.write((uint8_t*)&header, sizeof(header));
+
+    Error status = Error::Ok;
+    char  line[255];
+    char  text[255];
+    while (readFileLine(line, 255)) {
+        protocol_execute_realtime();  // Status reports and resets go on while compiling
+        if (sys.abort) {
+            break;
+        }
+        size_t length = strlen(line);
+        if (length == 0) {
+            continue;
+        }
+        compiled_record_t    record = { sd_current_line_number, sd_line_position, 0 };
+        gc_compiled_motion_t compiled;
+        compiled.motion = Motion::None;
+        if (line[0] == '$' || line[0] == '[') {
+            status = Error::CompileUnsupported;  // System commands act on the machine, not the parser
+        } else {
+            memcpy(text, line, length + 1);
+            status = gc_compile_line(line, SD_client, &compiled);
+        }
+        if (status != Error::Ok && status != Error::GcodeUnsupportedCommand) {
+            grbl_sendf(SD_client, "error:%d in SD file at line %d\r\n", status, sd_current_line_number);
+            break;
+        }
+        status = Error::Ok;
+        if (compiled.motion == Motion::None) {
+            record.length = length;
+            job.write((uint8_t*)&record, sizeof(record));
+            job.write((uint8_t*)text, length);
+        } else {
+            job.write((uint8_t*)&record, sizeof(record));
+            job.write((uint8_t*)&compiled, sizeof(compiled));
+        }
+        header.records++;
+    }
+    if (status == Error::Ok && !myFile) {
+        status = Error::FsFailedRead;  // readFileLine() reported an error and closed the file
+    }
+    memcpy(&gc_state, &header.state, sizeof(parser_state_t));
+    if (status == Error::Ok && !sys.abort) {
+        header.magic = CompiledMagic;
+        job.seek(0);
+        job.write((uint8_t*)&header, sizeof(header));
+    }
+    job.close();
+    if (status != Error::Ok) {
+        fs.remove(path.c_str());
+    }
+    return status;
+}
+
+// Checks that the open file is a compiled job that runs the same as when it was compiled.
+Error readCompiledHeader() {
+    compiled_header_t header;
+    if (myFile.read((uint8_t*)&header, sizeof(header)) != sizeof(header) || header.magic != CompiledMagic ||
+        header.header_size != sizeof(compiled_header_t) || header.motion_size != sizeof(gc_compiled_motion_t)) {
+        return Error::CompiledJobInvalid;
+    }
+    if (header.settings_hash != sd_settings_hash() || !sd_same_parser_state(&header.state)) {
+        return Error::CompiledJobStale;
+    }
+    sd_load_parser_state(&header.state);
+    gc_compiled_begin(header.state.position);
+    SD_compiled        = true;
+    sd_source_size      = header.source_size;
+    sd_source_position  = 0;
+    sd_compiled_records = header.records;
+    return Error::Ok;
+}
+
+// Reads the next record of a compiled job: the motion of a motion record, with a motion of None
+// and the text in line for a text record. Returns false after the last record the header counts,
+// and reports an error, which ends the job, for a record that cannot be read before that.
+boolean readCompiledRecord(char* line, int maxlen, gc_compiled_motion_t* compiled) {
+    if (sd_compiled_records == 0) {
+        return false;
+    }
+    sd_compiled_records--;
+    compiled_record_t record;
+    Error             status = Error::Ok;
+    if (myFile.read((uint8_t*)&record, sizeof(record)) != sizeof(record)) {
+        status = Error::FsFailedRead;
+    } else {
+        sd_current_line_number = record.line;
+        sd_source_position     = record.offset;
+        if (record.length >= maxlen) {
+            status = Error::CompiledJobInvalid;
+        } else if (record.length) {
+            if (myFile.read((uint8_t*)line, record.length) != record.length) {
+                status = Error::FsFailedRead;
+            }
+            line[record.length] = '\0';
+            compiled->motion    = Motion::None;
+        } else if (myFile.read((uint8_t*)compiled, sizeof(gc_compiled_motion_t)) != sizeof(gc_compiled_motion_t)) {
+            status = Error::FsFailedRead;
+        }
+    }
+    if (status != Error::Ok) {
+        report_status_message(status, SD_client);
+        return false;
+    }
+    return true;
+}
+
+// Has the reader write the index of the open file, which it reads from the top, unless rebuild is
+// false and the file is small or has a complete one.
+void beginIndex(fs::FS& fs, bool rebuild) {
+    if (!rebuild && sd_file_size < SDIndexMinSize) {
+        return;
+    }
+    String path = sd_index_path(myFile.name());
+    if (!rebuild) {
+        File           index = fs.open(path.c_str());
+        index_header_t header;
+        bool complete = index && index.read((uint8_t*)&header, sizeof(header)) == sizeof(header) && sd_index_header_valid(&header) &&
+                        header.lines;
+        index.close();
+        if (complete) {
+            return;
+        }
+    }
+    sd_index = fs.open(path.c_str(), FILE_WRITE);
+    if (sd_index) {
+        index_header_t header = sd_index_header(0);
+        sd_index.write((uint8_t*)&header, sizeof(header));
+        sd_clear_modal(&sd_modal);
+    }
+}
+
+// Writes the index of the open file
+Error indexFile(fs::FS& fs) {
+    beginIndex(fs, true);
+    if (!sd_index) {
+        return Error::FsFailedOpenFile;
+    }
+    char line[LINE_BUFFER_SIZE];
+    while (readFileLine(line, LINE_BUFFER_SIZE)) {
+        protocol_execute_realtime();  // Status reports and resets go on while indexing
+        if (sys.abort) {
+            break;
+        }
+    }
+    return (myFile && !sd_index) ? Error::Ok : Error::FsFailedRead;
+}
+
+// Runs a line that sets modal state. Unsupported commands are skipped over, as in a job.
+static Error sd_restore_line(char* line) {
+    Error status = execute_line(line, SD_client, SD_auth_level);
+    return (status == Error::GcodeUnsupportedCommand) ? Error::Ok : status;
+}
+
+// Runs g-code that sets the modal state a scan followed. An arc or spline motion mode is left
+// to the lines that follow, since G2, G3 and G5 take axis words.
+static Error sd_restore_modal(const sd_modal_t* modal) {
+    char          line[LINE_BUFFER_SIZE] = "";
+    char*         end                    = line;
+    const uint8_t modes[]                = {
+        modal->units, modal->distance, modal->coord_select, modal->plane, modal->feed_mode, modal->tool_length, modal->motion
+    };
+    for (uint8_t mode : modes) {
+        if (mode != SDModalUnset && mode != 2 && mode != 3 && mode != 5) {
+            end += sprintf(end, "G%d", mode);
+        }
+    }
+    if (modal->feed_mode == 93) {
+        end += sprintf(end, "F1");  // G93 with a motion mode wants an F word, which is for this line only
+    } else if (modal->feed_rate >= 0) {
+        end += sprintf(end, "F%.6f", (modal->units == 20) ? modal->feed_rate / MM_PER_INCH : modal->feed_rate);
+    }
+    Error status = sd_restore_line(line);
+    end          = line;
+    if (modal->spindle_speed >= 0) {
+        end += sprintf(end, "S%.3f", modal->spindle_speed);
+    }
+    if (modal->spindle != SDModalUnset) {
+        end += sprintf(end, "M%d", modal->spindle);
+    }
+    if (status == Error::Ok && end != line) {
+        status = sd_restore_line(line);
+    }
+    // M7 and M8 are in the same modal group, so each goes on its own line
+    for (int coolant = 7; coolant <= 9 && status == Error::Ok && modal->coolant != SDModalUnset; coolant++) {
+        if ((coolant == 9) ? (modal->coolant == 0) : bit_istrue(modal->coolant, bit(coolant - 7))) {
+            sprintf(line, "M%d", coolant);
+            status = sd_restore_line(line);
+        }
+    }
+    return status;
+}
+
+// Has the open text file run from a line, in the modal state the lines before it leave. Reading
+// starts from the last entry of the index of the file before the line, when it has an index.
+Error resumeFile(fs::FS& fs, uint32_t line) {
+    uint32_t position = 0;
+    uint32_t number   = 1;
+    sd_clear_modal(&sd_modal);
+    File index = fs.open(sd_index_path(myFile.name()).c_str());
+    if (index) {
+        index_header_t header;
+        if (index.read((uint8_t*)&header, sizeof(header)) == sizeof(header) && sd_index_header_valid(&header)) {
+            uint32_t      entries = (index.size() - sizeof(header)) / sizeof(index_entry_t);
+            uint32_t      entry   = (line - 1) / SDIndexLines;  // Entries for lines up to the line
+            index_entry_t last;
+            if (entry > entries) {
+                entry = entries;
+            }
+            if (entry && index.seek(sizeof(header) + (entry - 1) * sizeof(index_entry_t)) &&
+                index.read((uint8_t*)&last, sizeof(last)) == sizeof(last)) {
+                position = last.position;
+                number   = entry * SDIndexLines + 1;
+                sd_modal = last.modal;
+            }
+        }
+        index.close();
+    }
+    // Reading starts at the sector the line is in
+    sd_read_line_number    = number - 1;
+    sd_current_line_number = number - 1;
+    sd_file_position       = position;
+    sd_line_position       = position;
+    sd_block_skip          = position % 512;
+    myFile.seek(position - sd_block_skip);
+
+    char text[LINE_BUFFER_SIZE];
+    while (sd_current_line_number + 1 < line) {
+        if (!readFileLine(text, LINE_BUFFER_SIZE)) {
+            return myFile ? Error::ResumeLineNotFound : Error::FsFailedRead;
+        }
+        sd_scan_modal(text, &sd_modal);
+        protocol_execute_realtime();  // Status reports and resets go on while scanning
+        if (sys.abort) {
+            return Error::Ok;  // The reset closed the file
+        }
+    }
+    if (sd_modal.offsets) {
+        return Error::ResumeOffsetsChanged;
+    }
+    Error status = sd_restore_modal(&sd_modal);
+    if (status == Error::Ok) {
+        SD_ready_next = true;  // Protocol.cpp runs the job from the line
+    }
+    return status;
+}
 #endif  //ENABLE_SD_CARD
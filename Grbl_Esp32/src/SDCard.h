@@ -23,6 +23,8 @@
 //#define SDCARD_DET_PIN -1
 const int SDCARD_DET_VAL = 0;  // for now, CD is close to ground
 
+const int SDLineCount = 8;  // Lines of a text file read ahead of the one that runs
+
 enum class SDState : uint8_t {
     Idle          = 0,
     NotPresent    = 1,
@@ -35,6 +37,7 @@ enum class SDState : uint8_t {
 extern bool                       SD_ready_next;  // Grbl has processed a line and is waiting for another
 extern uint8_t                    SD_client;
 extern WebUI::AuthenticationLevel SD_auth_level;
+extern bool                       SD_compiled;  // The open file is a compiled job
 
 //bool sd_mount();
 SDState  get_sd_state(bool refresh);
@@ -43,7 +46,16 @@ void     listDir(fs::FS& fs, const char* dirname, uint8_t levels, uint8_t client
 boolean  openFile(fs::FS& fs, const char* path);
 boolean  closeFile();
 boolean  readFileLine(char* line, int len);
+void     sd_read_ahead();
 void     readFile(fs::FS& fs, const char* path);
 float    sd_report_perc_complete();
 uint32_t sd_get_current_line_number();
 void     sd_get_current_filename(char* name);
+String   sd_compiled_path(String path);
+Error    compileFile(fs::FS& fs);
+Error    readCompiledHeader();
+boolean  readCompiledRecord(char* line, int maxlen, gc_compiled_motion_t* compiled);
+String   sd_index_path(String path);
+void     beginIndex(fs::FS& fs, bool rebuild);
+Error    indexFile(fs::FS& fs);
+Error    resumeFile(fs::FS& fs, uint32_t line);
@@ -52,7 +52,26 @@
 
   The main protocol loop reads from client_buffer[]
 
-
+  Binary streaming
+
+  With ENABLE_BINARY_STREAM, a client can send the BinaryStream realtime command to stream
+  motion that the sender has already parsed. Grbl answers [BIN:<window>,<max payload>], or
+  [BIN:0,0] when another client streams binary or an SD card job runs. From then on the client
+  sends frames:
+
+    SYNC (0xA5), type, sequence number, payload length, payload, CRC low, CRC high
+
+  The CRC is CRC-16/CCITT-FALSE of the type through the payload. Sequence numbers start at 0
+  and wrap at 256. The sender may have up to <window> frames unacknowledged. Grbl sends
+  [ACK:<seq>] when all the records of a frame are executed. A frame with a bad CRC, or one that
+  skips a sequence number, is dropped and answered by [NAK:<expected seq>], after which the
+  sender resends from that frame. Later frames are dropped silently until it does. A frame that
+  was already received is dropped too, and its ACK is sent again if it may have been lost.
+  An 'E' frame returns the client to text mode once acknowledged. So does a reset.
+
+  Realtime commands can be sent between frames. After a NAK, only a reset is acted upon until
+  a good frame is received, since the bytes of a damaged frame could look like commands.
+  The records in a frame are executed by the protocol loop. See Protocol.cpp.
 */
 
 #include "Grbl.h"
@@ -128,6 +147,133 @@ void client_init() {
     );
 }
 
+#ifdef ENABLE_BINARY_STREAM
+enum class BinaryState : uint8_t {
+    Hunt,  // Between frames
+    Type,
+    Seq,
+    Length,
+    Payload,
+    CrcLow,
+    CrcHigh,
+};
+
+// The frames are received by clientCheckTask() into the slot after the queued ones, so there
+// is one more slot than the window.
+static volatile uint8_t binary_client = CLIENT_ALL;
+static binary_frame_t   binary_frames[BinaryWindow + 1];
+static uint8_t          binary_head  = 0;  // The oldest queued frame
+static uint8_t          binary_tail  = 0;  // The frame being received
+static volatile uint8_t binary_count = 0;  // Queued frames
+static BinaryState      binary_state;
+static uint8_t          binary_expected;   // Sequence number of the next frame
+static bool             binary_nak_sent;   // Until a good frame is received
+static uint8_t          binary_received;   // Payload bytes of the frame being received
+static uint16_t         binary_crc;
+static uint16_t         binary_frame_crc;
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF, not reflected
+static uint16_t binary_crc_update(uint16_t crc, uint8_t data) {
+    crc ^= data << 8;
+    for (int i = 0; i < 8; i++) {
+        crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static void binary_start(uint8_t client) {
+    bool busy = binary_client != CLIENT_ALL;
+#    ifdef ENABLE_SD_CARD
+    busy = busy || get_sd_state(false) >= SDState::Busy;
+#    endif
+    if (busy) {
+        grbl_send(client, "[BIN:0,0]\r\n");
+        return;
+    }
+    binary_state    = BinaryState::Hunt;
+    binary_expected = 0;
+    binary_nak_sent = false;
+    binary_tail     = 0;
+    vTaskEnterCritical(&myMutex);
+    binary_head   = 0;
+    binary_count  = 0;
+    binary_client = client;
+    vTaskExitCritical(&myMutex);
+    grbl_sendf(client, "[BIN:%d,%d]\r\n", BinaryWindow, client == CLIENT_WEBUI ? 128 : BinaryMaxPayload);
+}
+
+// Queues a frame that arrived whole, or answers it
+static void binary_frame_received(binary_frame_t* frame, bool crc_ok) {
+    bool valid = crc_ok && (frame->type == BinaryFrame::Records || frame->type == BinaryFrame::End);
+    if (valid && frame->seq == binary_expected) {
+        if (binary_count < BinaryWindow) {
+            binary_tail     = (binary_tail + 1) % (BinaryWindow + 1);
+            binary_nak_sent = false;
+            binary_expected++;
+            vTaskEnterCritical(&myMutex);
+            binary_count++;
+            vTaskExitCritical(&myMutex);
+            return;
+        }
+        // The sender did not wait for the window
+    } else if (valid && uint8_t(binary_expected - frame->seq) <= BinaryWindow) {
+        // Resent. Once all frames are executed, the ACK of this one was sent and may have been lost.
+        if (binary_count == 0) {
+            grbl_sendf(binary_client, "[ACK:%d]\r\n", uint8_t(binary_expected - 1));
+        }
+        return;
+    }
+    if (!binary_nak_sent) {
+        binary_nak_sent = true;
+        grbl_sendf(binary_client, "[NAK:%d]\r\n", binary_expected);
+    }
+}
+
+// Decodes a byte from the binary client
+static void binary_receive(uint8_t data) {
+    binary_frame_t* frame = &binary_frames[binary_tail];
+    switch (binary_state) {
+        case BinaryState::Hunt:
+            if (data == BinarySync) {
+                binary_crc   = 0xFFFF;
+                binary_state = BinaryState::Type;
+            } else if (binary_nak_sent ? data == static_cast<uint8_t>(Cmd::Reset) : is_realtime_command(data)) {
+                execute_realtime_command(static_cast<Cmd>(data), binary_client);
+            }
+            return;  // Text is dropped
+        case BinaryState::Type:
+            frame->type  = static_cast<BinaryFrame>(data);
+            binary_state = BinaryState::Seq;
+            break;
+        case BinaryState::Seq:
+            frame->seq   = data;
+            binary_state = BinaryState::Length;
+            break;
+        case BinaryState::Length:
+            frame->length   = data;
+            binary_received = 0;
+            binary_state    = data ? BinaryState::Payload : BinaryState::CrcLow;
+            break;
+        case BinaryState::Payload:
+            frame->payload[binary_received++] = data;
+            if (binary_received == frame->length) {
+                binary_state = BinaryState::CrcLow;
+            }
+            break;
+        case BinaryState::CrcLow:
+            binary_frame_crc = data;
+            binary_state     = BinaryState::CrcHigh;
+            return;
+        case BinaryState::CrcHigh:
+            binary_frame_crc |= data << 8;
+            binary_state = BinaryState::Hunt;
+            binary_frame_received(frame, binary_frame_crc == binary_crc);
+            return;
+    }
+    binary_crc = binary_crc_update(binary_crc, data);
+}
+#endif
+
 static uint8_t getClientChar(uint8_t* data) {
     int res;
 #ifdef REVERT_TO_ARDUINO_SERIAL
@@ -174,6 +320,12 @@ void clientCheckTask(void* pvParameters) {
     static UBaseType_t uxHighWaterMark = 0;
     while (true) {  // run continuously
         while ((client = getClientChar(&data)) != CLIENT_ALL) {
+#ifdef ENABLE_BINARY_STREAM
+            if (client == binary_client) {
+                binary_receive(data);
+                continue;
+            }
+#endif
             // Pick off realtime command characters directly from the serial stream. These characters are
             // not passed into the main buffer, but these set system state flag bits for realtime execution.
             if (is_realtime_command(data)) {
@@ -218,6 +370,11 @@ void client_reset_read_buffer(uint8_t client) {
     for (uint8_t client_num = 0; client_num < CLIENT_COUNT; client_num++) {
         if (client == client_num || client == CLIENT_ALL) {
             client_buffer[client_num].begin();
+#ifdef ENABLE_BINARY_STREAM
+            if (client_num == binary_client) {
+                client_end_binary();
+            }
+#endif
         }
     }
 }
@@ -230,6 +387,50 @@ int client_read(uint8_t client) {
     return data;
 }
 
+// Returns the first complete line in the client read buffer, parsed in place, or NULL.
+// See InputBuffer::line(). Called by protocol loop.
+char* client_peek_line(uint8_t client, size_t* size, size_t max_size) {
+    vTaskEnterCritical(&myMutex);
+    char* line = client_buffer[client].line(size, max_size);
+    vTaskExitCritical(&myMutex);
+    return line;
+}
+
+// Drops a line returned by client_peek_line() once it has been executed.
+void client_release_line(uint8_t client, size_t size) {
+    vTaskEnterCritical(&myMutex);
+    client_buffer[client].release_line(size);
+    vTaskExitCritical(&myMutex);
+}
+
+#ifdef ENABLE_BINARY_STREAM
+uint8_t client_binary() {
+    return binary_client;
+}
+
+// Returns the oldest queued frame of the binary client, or NULL. Called by protocol loop.
+binary_frame_t* client_peek_frame() {
+    vTaskEnterCritical(&myMutex);
+    binary_frame_t* frame = binary_count ? &binary_frames[binary_head] : NULL;
+    vTaskExitCritical(&myMutex);
+    return frame;
+}
+
+// Drops a frame returned by client_peek_frame() once it has been executed.
+void client_release_frame() {
+    vTaskEnterCritical(&myMutex);
+    binary_head = (binary_head + 1) % (BinaryWindow + 1);
+    binary_count--;
+    vTaskExitCritical(&myMutex);
+}
+
+void client_end_binary() {
+    vTaskEnterCritical(&myMutex);
+    binary_client = CLIENT_ALL;
+    vTaskExitCritical(&myMutex);
+}
+#endif
+
 // checks to see if a character is a realtime character
 bool is_realtime_command(uint8_t data) {
     if (data >= 0x80) {
@@ -263,6 +464,11 @@ void execute_realtime_command(Cmd command, uint8_t client) {
                 sys_rt_exec_state.bit.motionCancel = true;
             }
             break;
+        case Cmd::BinaryStream:
+#ifdef ENABLE_BINARY_STREAM
+            binary_start(client);
+#endif
+            break;
         case Cmd::DebugReport:
 #ifdef DEBUG
             sys_rt_exec_debug = true;
@@ -41,6 +41,41 @@ void client_write(uint8_t client, const char* text);
 // Fetches the first byte in the serial read buffer. Called by main program.
 int client_read(uint8_t client);
 
+// Returns the first complete line in the serial read buffer, in place, or NULL if it must be read
+// one byte at a time. The line stays buffered until client_release_line() is called with size.
+char* client_peek_line(uint8_t client, size_t* size, size_t max_size);
+void  client_release_line(uint8_t client, size_t size);
+
+#ifdef ENABLE_BINARY_STREAM
+// Binary stream frames. See Serial.cpp.
+const uint8_t BinarySync       = 0xA5;
+const int     BinaryWindow     = 4;    // Frames the sender may have unacknowledged
+const int     BinaryMaxPayload = 255;  // 128 from the WebSocket, whose input buffer is smaller
+
+enum class BinaryFrame : uint8_t {
+    Records = 'R',  // Motion and text records
+    End     = 'E',  // Back to text mode
+};
+
+typedef struct {
+    BinaryFrame type;
+    uint8_t     seq;
+    uint8_t     length;
+    uint8_t     payload[BinaryMaxPayload];
+} binary_frame_t;
+
+// Returns the client that streams binary frames, or CLIENT_ALL.
+uint8_t client_binary();
+
+// Returns the oldest frame received from the binary client, or NULL. The frame stays queued
+// until client_release_frame() is called.
+binary_frame_t* client_peek_frame();
+void            client_release_frame();
+
+// Returns the binary client to text mode.
+void client_end_binary();
+#endif
+
 // See if the character is an action command like feedhold or jogging. If so, do the action and return true
 uint8_t check_action_command(uint8_t data);
 
@@ -37,6 +37,9 @@ IntSetting* laser_full_power;
 IntSetting*   status_mask;
 FloatSetting* junction_deviation;
 FloatSetting* arc_tolerance;
+IntSetting*   planner_blocks;
+IntSetting*   i2s_dmabuf_count;
+FloatSetting* coalesce_tolerance;
 
 FloatSetting*    homing_feed_rate;
 FloatSetting*    homing_seek_rate;
@@ -106,6 +109,7 @@ typedef struct {
     float       steps_per_mm;
     float       max_rate;
     float       acceleration;
+    float       jerk;
     float       max_travel;
     float       home_mpos;
     float       run_current;
@@ -117,6 +121,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_X_STEPS_PER_MM,
                                       DEFAULT_X_MAX_RATE,
                                       DEFAULT_X_ACCELERATION,
+                                      DEFAULT_X_JERK,
                                       DEFAULT_X_MAX_TRAVEL,
                                       DEFAULT_X_HOMING_MPOS,
                                       DEFAULT_X_CURRENT,
@@ -127,6 +132,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_Y_STEPS_PER_MM,
                                       DEFAULT_Y_MAX_RATE,
                                       DEFAULT_Y_ACCELERATION,
+                                      DEFAULT_Y_JERK,
                                       DEFAULT_Y_MAX_TRAVEL,
                                       DEFAULT_Y_HOMING_MPOS,
                                       DEFAULT_Y_CURRENT,
@@ -137,6 +143,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_Z_STEPS_PER_MM,
                                       DEFAULT_Z_MAX_RATE,
                                       DEFAULT_Z_ACCELERATION,
+                                      DEFAULT_Z_JERK,
                                       DEFAULT_Z_MAX_TRAVEL,
                                       DEFAULT_Z_HOMING_MPOS,
                                       DEFAULT_Z_CURRENT,
@@ -147,6 +154,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_A_STEPS_PER_MM,
                                       DEFAULT_A_MAX_RATE,
                                       DEFAULT_A_ACCELERATION,
+                                      DEFAULT_A_JERK,
                                       DEFAULT_A_MAX_TRAVEL,
                                       DEFAULT_A_HOMING_MPOS,
                                       DEFAULT_A_CURRENT,
@@ -157,6 +165,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_B_STEPS_PER_MM,
                                       DEFAULT_B_MAX_RATE,
                                       DEFAULT_B_ACCELERATION,
+                                      DEFAULT_B_JERK,
                                       DEFAULT_B_MAX_TRAVEL,
                                       DEFAULT_B_HOMING_MPOS,
                                       DEFAULT_B_CURRENT,
@@ -167,6 +176,7 @@ axis_defaults_t axis_defaults[] = { { "X",
                                       DEFAULT_C_STEPS_PER_MM,
                                       DEFAULT_C_MAX_RATE,
                                       DEFAULT_C_ACCELERATION,
+                                      DEFAULT_C_JERK,
                                       DEFAULT_C_MAX_TRAVEL,
                                       DEFAULT_C_HOMING_MPOS,
                                       DEFAULT_C_CURRENT,
@@ -226,7 +236,7 @@ static const char* makeGrblName(int axisNum, int base) {
     // if (axisNum > 2) return NULL;
     char buf[4];
     snprintf(buf, 4, "%d", axisNum + base);
-    char* retval = (char*)malloc(strlen(buf));
+    char* retval = (char*)malloc(strlen(buf) + 1);
     return strcpy(retval, buf);
 }
 
@@ -301,35 +311,46 @@ void make_settings() {
     }
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def          = &axis_defaults[axis];
-        auto setting = new FloatSetting(GRBL, WG, makeGrblName(axis, 130), makename(def->name, "MaxTravel"), def->max_travel, 0, 100000.0);
+        auto setting = new FloatSetting(
+            GRBL, WG, makeGrblName(axis, 130), makename(def->name, "MaxTravel"), def->max_travel, 0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->max_travel = setting;
     }
 
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def          = &axis_defaults[axis];
-        auto setting = new FloatSetting(EXTENDED, WG, NULL, makename(def->name, "Home/Mpos"), def->home_mpos, -100000.0, 100000.0);
+        auto setting = new FloatSetting(
+            EXTENDED, WG, NULL, makename(def->name, "Home/Mpos"), def->home_mpos, -100000.0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->home_mpos = setting;
     }
 
+    for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
+        def          = &axis_defaults[axis];
+        auto setting = new FloatSetting(
+            EXTENDED, WG, NULL, makename(def->name, "Jerk"), def->jerk, 0.0, 10000000.0, postMotionSetting);  // mm/sec^3
+        setting->setAxis(axis);
+        axis_settings[axis]->jerk = setting;
+    }
+
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def = &axis_defaults[axis];
-        auto setting =
-            new FloatSetting(GRBL, WG, makeGrblName(axis, 120), makename(def->name, "Acceleration"), def->acceleration, 1.0, 100000.0);
+        auto setting = new FloatSetting(
+            GRBL, WG, makeGrblName(axis, 120), makename(def->name, "Acceleration"), def->acceleration, 1.0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->acceleration = setting;
     }
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def          = &axis_defaults[axis];
-        auto setting = new FloatSetting(GRBL, WG, makeGrblName(axis, 110), makename(def->name, "MaxRate"), def->max_rate, 1.0, 100000.0);
+        auto setting = new FloatSetting(
+            GRBL, WG, makeGrblName(axis, 110), makename(def->name, "MaxRate"), def->max_rate, 1.0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->max_rate = setting;
     }
     for (axis = MAX_N_AXIS - 1; axis >= 0; axis--) {
         def = &axis_defaults[axis];
-        auto setting =
-            new FloatSetting(GRBL, WG, makeGrblName(axis, 100), makename(def->name, "StepsPerMm"), def->steps_per_mm, 1.0, 100000.0);
+        auto setting = new FloatSetting(
+            GRBL, WG, makeGrblName(axis, 100), makename(def->name, "StepsPerMm"), def->steps_per_mm, 1.0, 100000.0, postMotionSetting);
         setting->setAxis(axis);
         axis_settings[axis]->steps_per_mm = setting;
     }
@@ -378,7 +399,7 @@ void make_settings() {
     homing_squared_axes = new AxisMaskSetting(EXTENDED, WG, NULL, "Homing/Squared", DEFAULT_HOMING_SQUARED_AXES);
 
     // TODO Settings - need to call st_generate_step_invert_masks()
-    homing_dir_mask = new AxisMaskSetting(GRBL, WG, "23", "Homing/DirInvert", DEFAULT_HOMING_DIR_MASK);
+    homing_dir_mask = new AxisMaskSetting(GRBL, WG, "23", "Homing/DirInvert", DEFAULT_HOMING_DIR_MASK, postMotionSetting);
 
     // TODO Settings - need to call limits_init();
     homing_enable = new FlagSetting(GRBL, WG, "22", "Homing/Enable", DEFAULT_HOMING_ENABLE);
@@ -390,18 +411,28 @@ void make_settings() {
     report_inches = new FlagSetting(GRBL, WG, "13", "Report/Inches", DEFAULT_REPORT_INCHES);
     // TODO Settings - also need to clear, but not set, soft_limits
     arc_tolerance      = new FloatSetting(GRBL, WG, "12", "GCode/ArcTolerance", DEFAULT_ARC_TOLERANCE, 0, 1);
-    junction_deviation = new FloatSetting(GRBL, WG, "11", "GCode/JunctionDeviation", DEFAULT_JUNCTION_DEVIATION, 0, 10);
+    junction_deviation = new FloatSetting(GRBL, WG, "11", "GCode/JunctionDeviation", DEFAULT_JUNCTION_DEVIATION, 0, 10, postMotionSetting);
     status_mask        = new IntSetting(GRBL, WG, "10", "Report/Status", DEFAULT_STATUS_REPORT_MASK, 0, 3);
 
+    // The planner buffer is allocated once at startup, so a new value is used after the next restart
+    planner_blocks =
+        new IntSetting(EXTENDED, WG, NULL, "Planner/Blocks", DEFAULT_PLANNER_BLOCKS, MIN_BLOCK_BUFFER_SIZE, MAX_BLOCK_BUFFER_SIZE);
+    coalesce_tolerance = new FloatSetting(EXTENDED, WG, NULL, "Planner/Coalesce/Tolerance", DEFAULT_COALESCE_TOLERANCE, 0, 1);
+
     probe_invert                 = new FlagSetting(GRBL, WG, "6", "Probe/Invert", DEFAULT_INVERT_PROBE_PIN);
     limit_invert                 = new FlagSetting(GRBL, WG, "5", "Limits/Invert", DEFAULT_INVERT_LIMIT_PINS);
     step_enable_invert           = new FlagSetting(GRBL, WG, "4", "Stepper/EnableInvert", DEFAULT_INVERT_ST_ENABLE);
     dir_invert_mask              = new AxisMaskSetting(GRBL, WG, "3", "Stepper/DirInvert", DEFAULT_DIRECTION_INVERT_MASK, postMotorSetting);
     step_invert_mask             = new AxisMaskSetting(GRBL, WG, "2", "Stepper/StepInvert", DEFAULT_STEPPING_INVERT_MASK, postMotorSetting);
     stepper_idle_lock_time       = new IntSetting(GRBL, WG, "1", "Stepper/IdleTime", DEFAULT_STEPPER_IDLE_LOCK_TIME, 0, 255);
-    pulse_microseconds           = new IntSetting(GRBL, WG, "0", "Stepper/Pulse", DEFAULT_STEP_PULSE_MICROSECONDS, 3, 1000);
-    direction_delay_microseconds = new IntSetting(EXTENDED, WG, NULL, "Stepper/Direction/Delay", STEP_PULSE_DELAY, 0, 1000);
+    pulse_microseconds =
+        new IntSetting(GRBL, WG, "0", "Stepper/Pulse", DEFAULT_STEP_PULSE_MICROSECONDS, 3, 1000, postMotionSetting);
+    direction_delay_microseconds =
+        new IntSetting(EXTENDED, WG, NULL, "Stepper/Direction/Delay", STEP_PULSE_DELAY, 0, 1000, postMotionSetting);
     enable_delay_microseconds = new IntSetting(EXTENDED, WG, NULL, "Stepper/Enable/Delay", DEFAULT_STEP_ENABLE_DELAY, 0, 1000);  // microseconds
+    // The I2S DMA buffers are allocated at startup, so a new value is used after the next restart
+    i2s_dmabuf_count = new IntSetting(
+        EXTENDED, WG, NULL, "Stepper/I2S/Buffers", DEFAULT_I2S_DMABUF_COUNT, I2S_OUT_DMABUF_COUNT_MIN, I2S_OUT_DMABUF_COUNT_MAX);
 
     stallguard_debug_mask = new AxisMaskSetting(EXTENDED, WG, NULL, "Report/StallGuard", 0, postMotorSetting);
 
@@ -40,6 +40,9 @@ extern IntSetting*  laser_full_power;
 extern IntSetting*   status_mask;
 extern FloatSetting* junction_deviation;
 extern FloatSetting* arc_tolerance;
+extern IntSetting*   planner_blocks;
+extern IntSetting*   i2s_dmabuf_count;
+extern FloatSetting* coalesce_tolerance;
 
 extern FloatSetting* homing_feed_rate;
 extern FloatSetting* homing_seek_rate;
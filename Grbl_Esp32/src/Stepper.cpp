@@ -38,6 +38,12 @@ typedef struct {
     uint32_t step_event_count;
     uint8_t  direction_bits;
     uint8_t  is_pwm_rate_adjusted;  // Tracks motions that require constant laser power/rate
+#ifdef USE_STEP_QUEUE
+    uint32_t events_expanded;  // Step events of the block already expanded into the step queue, without AMASS
+#endif
+#ifdef USE_RMT_STEPS
+    uint8_t step_train_axes;  // The moving axes, if they all step on every step event, else 0
+#endif
 } st_block_t;
 static st_block_t st_block_buffer[SEGMENT_BUFFER_SIZE - 1];
 
@@ -51,6 +57,11 @@ typedef struct {
     uint8_t  st_block_index;  // Stepper block data index. Uses this information to execute this segment.
     uint8_t  amass_level;     // AMASS level for the ISR to execute this segment
     uint16_t spindle_rpm;     // TODO get rid of this.
+#ifdef USE_STEP_QUEUE
+    float    entry_speed;  // Speed at the start of the segment (mm/min)
+    float    exit_speed;   // Speed at the end of the segment (mm/min)
+    uint64_t start_time;   // Step queue time of the start of the segment, set when it is expanded
+#endif
 } segment_t;
 static segment_t segment_buffer[SEGMENT_BUFFER_SIZE];
 
@@ -67,30 +78,136 @@ typedef struct {
     uint8_t  dir_outbits;
     uint32_t steps[MAX_N_AXIS];
 
+#ifdef STEPPER_BATCHED_POSITION
+    uint16_t segment_steps[MAX_N_AXIS];  // Steps taken in the executing segment, not yet in sys_position
+#endif
+
     uint16_t    step_count;        // Steps remaining in line segment motion
     uint8_t     exec_block_index;  // Tracks the current st_block index. Change indicates new block.
     st_block_t* exec_block;        // Pointer to the block data for the segment being executed
     segment_t*  exec_segment;      // Pointer to the segment being executed
+
+#ifdef USE_RMT_STEPS
+    bool step_train_period;  // The timer period covers a step train instead of one step event
+#endif
 } stepper_t;
 static stepper_t st;
 
 // Step segment ring buffer indices
 static volatile uint8_t segment_buffer_tail;
-static uint8_t          segment_buffer_head;
+static volatile uint8_t segment_buffer_head;
 static uint8_t          segment_next_head;
 
 // Used to avoid ISR nesting of the "Stepper Driver Interrupt". Should never occur though.
 static std::atomic<bool> busy;
 
+#ifdef USE_I2S_STEPS
+// Set when a feed hold slowed down the I2S stream. The segments ahead of hold_ramp_head were
+// prepared before the hold and play at the slower rate. The ones after are planned from it.
+static volatile bool hold_ramp_active;
+static uint8_t       hold_ramp_head;
+#endif
+
+#ifdef STEPPER_BATCHED_POSITION
+// Odd while the ISR moves segment steps into sys_position, so that st_get_position()
+// can tell that its copy straddled the move and retry.
+static volatile uint32_t position_sequence;
+#endif
+
+#ifdef ENABLE_STEPPER_ISR_STATS
+stepper_isr_stats_t stepper_isr_stats;
+static uint32_t     isr_last_entry;        // CCOUNT at the previous ISR entry
+static bool         isr_last_entry_valid;  // False until the ISR runs after the timer (re)starts
+static uint32_t     isr_period;            // Step timer period from the previous ISR entry to the next
+static uint32_t     isr_cycles_per_tick;   // CPU cycles per step timer tick
+#endif
+
+#ifdef USE_STEP_QUEUE
+// A run of steps on one axis. Step j of the run, counting from 0, is at
+// first + j * interval + add * j * (j - 1) / 2. Times are in step timer ticks << stepQueueTimeShift.
+typedef struct {
+    uint64_t          first;     // Time of the first step
+    int64_t           interval;  // Time from the first step to the second
+    int32_t           add;       // Change of the interval after each step
+    volatile uint32_t count;     // Steps in the run. The newest run of an axis may still grow.
+} step_run_t;
+
+// A segment is split into at most 1 << STEP_QUEUE_SPLITS runs per axis when one run does not fit.
+const int STEP_QUEUE_SPLITS       = 2;
+const int STEP_QUEUE_SEGMENT_RUNS = 1 << STEP_QUEUE_SPLITS;
+const int STEP_QUEUE_RUNS         = STEP_QUEUE_SEGMENT_RUNS * SEGMENT_BUFFER_SIZE;
+
+// Per-axis step queue. st_queue_expand() adds runs at the head, and the stepper ISR takes
+// them from the tail. The run at the tail is the one being replayed, or the last one replayed.
+typedef struct {
+    step_run_t       runs[STEP_QUEUE_RUNS];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+} step_queue_t;
+static step_queue_t step_queue[MAX_N_AXIS];
+
+// Replay state of each axis in the stepper ISR
+typedef struct {
+    uint64_t next;      // Time of the next step
+    int64_t  interval;  // Time from the next step to the one after it
+    int32_t  add;
+    uint32_t done;    // Steps taken from the run at the queue tail
+    bool     active;  // False once the run at the tail is used up
+} step_replay_t;
+static step_replay_t step_replay[MAX_N_AXIS];
+
+static uint64_t step_queue_now;          // Time of the step event the ISR last scheduled
+static uint64_t step_queue_segment_end;  // End of the segment the ISR is executing
+static uint32_t step_queue_min_period;   // Shortest time between step events, in timer ticks
+const uint16_t  stepQueueRetryTicks = 50 * ticksPerMicrosecond;  // ISR period while waiting for the expander
+
+// Expander state. Only st_queue_expand() and st_reset() touch it, under step_queue_mutex.
+static volatile uint8_t  segment_buffer_expanded;            // Segments from the tail up to here are in the step queue
+static uint64_t          step_queue_clock;                   // Start time of the next segment to expand
+static bool              step_queue_extendable[MAX_N_AXIS];  // The newest run of the axis may still grow
+static SemaphoreHandle_t step_queue_mutex;
+static TaskHandle_t      step_queue_task_handle;
+#endif
+
+// Progress of the step pulse being timed by the pulse timer. st.step_bits holds the
+// step bits that are waiting out the direction delay.
+enum class PulsePhase : uint8_t {
+    Idle,            // Step pins are low
+    DirectionDelay,  // Direction pins changed, step pins not yet raised
+    StepHigh,        // Step pins raised, waiting for the end of the pulse
+};
+static volatile PulsePhase pulse_phase;
+static int64_t             pulse_deadline;  // esp_timer_get_time() at the end of the current phase
+
 // Pointers for the step segment being prepped from the planner buffer. Accessed only by the
 // main program. Pointers may be planning segments or planner blocks ahead of what being executed.
 static plan_block_t* pl_block;       // Pointer to the planner block being prepped
 static st_block_t*   st_prep_block;  // Pointer to the stepper block data being prepped
 
 // esp32 work around for disable in main loop
-uint64_t stepper_idle_counter;  // used to count down until time to disable stepper drivers
+int64_t  stepper_idle_counter;  // used to count down until time to disable stepper drivers
 bool     stepper_idle;
 
+// Jerk-limited ramp data. When a block has a jerk limit, its acceleration and deceleration ramps
+// are each split into three phases: jerk up to the peak acceleration, constant acceleration, and
+// jerk back down to zero. Together with cruising this gives the seven-phase S-curve profile.
+// A ramp too short to reach the acceleration limit has no constant phase. The profile gives each
+// ramp the length plan_ramp_distance() does, which is what the planner planned the block with.
+typedef struct {
+    uint8_t active;     // Ramp is being executed as an S-curve
+    float   start_mm;   // Ramp start measured from end of block (mm)
+    float   end_mm;     // Ramp end measured from end of block (mm)
+    float   v0;         // Ramp start speed (mm/min)
+    float   v1;         // Ramp end speed (mm/min)
+    float   duration;   // Ramp duration (min)
+    float   jerk_time;  // Duration of each jerk phase (min)
+    float   accel;      // Signed peak acceleration (mm/min^2)
+    float   jerk;       // Signed jerk (mm/min^3)
+    float   time;       // Time elapsed in the ramp (min)
+} st_scurve_t;
+
+const int SCURVE_SOLVE_STEPS = 20;  // Bisection steps for the peak and lowest speeds of jerk-limited profiles
+
 // Segment preparation data struct. Contains all the necessary information to compute new segments
 // based on the current executing planner block.
 typedef struct {
@@ -118,6 +235,8 @@ typedef struct {
     float accelerate_until;  // Acceleration ramp end measured from end of block (mm)
     float decelerate_after;  // Deceleration ramp start measured from end of block (mm)
 
+    st_scurve_t scurve;  // Jerk-limited shape of the current acceleration or deceleration ramp
+
     float inv_rate;  // Used by PWM laser mode to speed up segment calculations.
     //uint16_t current_spindle_pwm;  // todo remove
     float current_spindle_rpm;
@@ -191,11 +310,182 @@ stepper_id_t current_stepper = DEFAULT_STEPPER;
 */
 
 static void stepper_pulse_func();
+static void pulse_timer_finish();
+
+#ifdef USE_I2S_STEPS
+// Called as a segment is loaded. Ends the slower rate at the first segment planned after the hold.
+static inline void IRAM_ATTR hold_ramp_check_segment() {
+    if (hold_ramp_active && segment_buffer_tail == hold_ramp_head) {
+        hold_ramp_active = false;
+        i2s_out_set_period_scale(I2S_OUT_PERIOD_SCALE_ONE);
+    }
+}
+#endif
+
+#ifdef STEPPER_BATCHED_POSITION
+// Adds the steps of the executing segment to sys_position. Called when the segment completes,
+// and when the steppers stop part way through one.
+static void IRAM_ATTR st_fold_segment_steps() {
+    position_sequence++;
+    std::atomic_thread_fence(std::memory_order_release);
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        if (st.dir_outbits & bit(axis)) {
+            sys_position[axis] -= st.segment_steps[axis];
+        } else {
+            sys_position[axis] += st.segment_steps[axis];
+        }
+        st.segment_steps[axis] = 0;
+    }
+    std::atomic_thread_fence(std::memory_order_release);
+    position_sequence++;
+}
+#endif
+
+// Copies the real-time machine position in steps. With STEPPER_BATCHED_POSITION, sys_position
+// only moves at segment boundaries, so the steps of the executing segment are added here.
+void IRAM_ATTR st_get_position(int32_t* position) {
+#ifdef STEPPER_BATCHED_POSITION
+    uint32_t sequence;
+    do {
+        sequence = position_sequence;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint8_t dir_bits = st.dir_outbits;
+        for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+            int32_t steps  = st.segment_steps[axis];
+            position[axis] = sys_position[axis] + ((dir_bits & bit(axis)) ? -steps : steps);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || sequence != position_sequence);
+#else
+    memcpy(position, sys_position, sizeof(sys_position));
+#endif
+}
+
+#ifndef USE_STEP_QUEUE
+// Runs the Bresenham line tracer of each axis for one ISR tick and returns the axes that step.
+// Inlined into the ISR, with the loop bounded by AXIS_LOOP_COUNT so that it can be unrolled.
+static inline uint8_t IRAM_ATTR st_bresenham_tick() {
+    auto    n_axis   = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : motion_config->n_axis;
+    uint8_t step_out = 0;
+    for (int axis = 0; axis < n_axis; axis++) {
+        // Execute step displacement profile by Bresenham line algorithm
+        st.counter[axis] += st.steps[axis];
+        if (st.counter[axis] > st.exec_block->step_event_count) {
+            step_out |= bit(axis);
+            st.counter[axis] -= st.exec_block->step_event_count;
+#ifdef STEPPER_BATCHED_POSITION
+            st.segment_steps[axis]++;
+#else
+            if (st.exec_block->direction_bits & bit(axis)) {
+                sys_position[axis]--;
+            } else {
+                sys_position[axis]++;
+            }
+#endif
+        }
+    }
+    return step_out;
+}
+#endif
+
+// Discards the executing segment once its steps are done, and advances segment indexing
+static inline void IRAM_ATTR st_segment_complete() {
+#ifdef STEPPER_BATCHED_POSITION
+    st_fold_segment_steps();
+#endif
+    st.exec_segment = NULL;
+    if (++segment_buffer_tail == SEGMENT_BUFFER_SIZE) {
+        segment_buffer_tail = 0;
+    }
+}
+
+#if defined(USE_RMT_STEPS) && !defined(USE_STEP_QUEUE)
+// Hands the next steps of the executing segment to the RMT channels as one step train, when
+// every moving axis steps on every step event. Those axes then step once in each 1 << AMASS
+// level ISR ticks, all at the same offset, and the ISR can sleep through the ticks the train
+// covers. Returns false, leaving the steps to the ISR, if the train would be too short or the
+// motors cannot send it.
+static bool IRAM_ATTR st_step_train() {
+    uint8_t axes = st.exec_block->step_train_axes;
+    if (axes == 0 || current_stepper != ST_RMT || sys.state == State::Homing || sys_probe_state == Probe::Active) {
+        return false;
+    }
+    uint8_t  amass_level = st.exec_segment->amass_level;
+    uint16_t count       = st.step_count >> amass_level;
+    if (count > MAX_STEP_TRAIN_STEPS) {
+        count = MAX_STEP_TRAIN_STEPS;
+    }
+    if (count < stepTrainMinSteps) {
+        return false;
+    }
+
+    // Find the first step on the counter of one of the axes. They are all the same.
+    // Over the whole train it comes back to where it is now, so it is not updated.
+    uint8_t  axis    = __builtin_ctz(axes);
+    uint32_t counter = st.counter[axis];
+    uint32_t offset  = 0;  // ISR ticks before the one with the first step
+    while ((counter += st.steps[axis]) <= st.exec_block->step_event_count) {
+        offset++;
+    }
+
+    // The steps of an ISR tick go out at the start of the next one
+    uint32_t period = st.exec_segment->isrPeriod;
+    if (!motors_step_train(axes, (offset + 1) * period, period << amass_level, count)) {
+        return false;
+    }
+    for (axis = 0; axis < MAX_N_AXIS; axis++) {
+        if (bitnum_istrue(axes, axis)) {
+#ifdef STEPPER_BATCHED_POSITION
+            st.segment_steps[axis] += count;
+#else
+            if (st.exec_block->direction_bits & bit(axis)) {
+                sys_position[axis] -= count;
+            } else {
+                sys_position[axis] += count;
+            }
+#endif
+        }
+    }
+
+    uint16_t ticks = count << amass_level;
+    st.step_count -= ticks;
+    Stepper_Timer_WritePeriod(ticks * period);
+    st.step_train_period = true;
+    if (st.step_count == 0) {
+        st_segment_complete();
+    }
+    return true;
+}
+#endif
+
+#ifdef ENABLE_STEPPER_ISR_STATS
+static void IRAM_ATTR isr_histogram_add(isr_histogram_t& histogram, uint32_t cycles) {
+    histogram.count++;
+    histogram.total += cycles;
+    if (cycles < histogram.min) {
+        histogram.min = cycles;
+    }
+    if (cycles > histogram.max) {
+        histogram.max = cycles;
+    }
+    int bin = cycles ? 31 - __builtin_clz(cycles) : 0;
+    histogram.bins[bin < ISR_STATS_BINS ? bin : ISR_STATS_BINS - 1]++;
+}
+
+void st_isr_stats_reset() {
+    isr_cycles_per_tick  = ESP.getCpuFreqMHz() / ticksPerMicrosecond;
+    isr_last_entry_valid = false;
+    memset(&stepper_isr_stats, 0, sizeof(stepper_isr_stats));
+    stepper_isr_stats.duration.min = UINT32_MAX;
+    stepper_isr_stats.jitter.min   = UINT32_MAX;
+    stepper_isr_stats.pins.min     = UINT32_MAX;
+}
+#endif
 
-// TODO: Replace direct updating of the int32 position counters in the ISR somehow. Perhaps use smaller
-// int8 variables and update position counters only when a segment completes. This can get complicated
-// with probing and homing cycles that require true real-time positions.
 void IRAM_ATTR onStepperDriverTimer(void* para) {
+#ifdef ENABLE_STEPPER_ISR_STATS
+    uint32_t entry = xthal_get_ccount();
+#endif
     // Timer ISR, normally takes a step.
     //
     // When handling an interrupt within an interrupt serivce routine (ISR), the interrupt status bit
@@ -204,26 +494,236 @@ void IRAM_ATTR onStepperDriverTimer(void* para) {
 
     bool expected = false;
     if (busy.compare_exchange_strong(expected, true)) {
+#ifdef ENABLE_STEPPER_ISR_STATS
+        // The period written during the previous ISR set the time of this one
+        if (isr_last_entry_valid) {
+            int32_t error = int32_t(entry - isr_last_entry - isr_period * isr_cycles_per_tick);
+            isr_histogram_add(stepper_isr_stats.jitter, error < 0 ? -error : error);
+        }
+        isr_last_entry       = entry;
+        isr_last_entry_valid = true;
+#endif
         stepper_pulse_func();
 
         TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
 
         busy.store(false);
+#ifdef ENABLE_STEPPER_ISR_STATS
+        isr_histogram_add(stepper_isr_stats.duration, xthal_get_ccount() - entry);
+    } else {
+        stepper_isr_stats.skipped++;
+#endif
+    }
+}
+
+// Starts the pulse timer for the next phase of the step pulse.
+static void IRAM_ATTR pulse_timer_arm(PulsePhase phase, uint32_t microseconds) {
+    pulse_phase    = phase;
+    pulse_deadline = esp_timer_get_time() + microseconds;
+    timer_set_counter_value(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, 0x00000000ULL);
+    timer_set_alarm_value(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, (uint64_t)microseconds * ticksPerMicrosecond);
+    TIMERG0.hw_timer[PULSE_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
+    timer_start(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+}
+
+// Pulse timer ISR. Raises the step pins once the direction delay has passed, and
+// lowers them at the end of the pulse, so the step ISR does not have to wait for either.
+void IRAM_ATTR onStepperOffTimer(void* para) {
+    TIMERG0.int_clr_timers.t1 = 1;
+
+    switch (pulse_phase) {
+        case PulsePhase::DirectionDelay:
+            if (st.step_bits) {
+                motors_step(st.step_bits);
+                pulse_timer_arm(PulsePhase::StepHigh, motion_config->pulse_microseconds);
+                break;
+            }
+            timer_pause(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+            pulse_phase = PulsePhase::Idle;
+            break;
+        case PulsePhase::StepHigh:
+            timer_pause(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+            motors_unstep();
+            pulse_phase = PulsePhase::Idle;
+            break;
+        case PulsePhase::Idle:
+            // Finished early by pulse_timer_finish()
+            timer_pause(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+            break;
     }
 }
 
+// Completes a step pulse that is still in progress. This happens when the step
+// rate is too high for the pulse and direction timing, and when the steppers go idle.
+// In an ISR, the pulse timer interrupt cannot get in, so the rest of the pulse is
+// timed here. Elsewhere it is left to the pulse timer.
+static void IRAM_ATTR pulse_timer_finish() {
+    if (!xPortInIsrContext()) {
+        while (pulse_phase != PulsePhase::Idle) {
+            NOP();
+        }
+        return;
+    }
+    timer_pause(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+    TIMERG0.int_clr_timers.t1 = 1;  // Drop an alarm that is already pending
+    if (pulse_phase == PulsePhase::DirectionDelay) {
+        while (esp_timer_get_time() - pulse_deadline < 0) {
+            NOP();  // spin here until the direction delay has passed
+        }
+        motors_step(st.step_bits);
+        pulse_deadline = esp_timer_get_time() + motion_config->pulse_microseconds;
+        pulse_phase    = PulsePhase::StepHigh;
+    }
+    if (pulse_phase == PulsePhase::StepHigh) {
+        while (esp_timer_get_time() - pulse_deadline < 0) {
+            NOP();  // spin here until time to turn off step
+        }
+        motors_unstep();
+    }
+    pulse_phase = PulsePhase::Idle;
+}
+
+#ifdef USE_STEP_QUEUE
+// Makes the next steps of an axis ready to replay, moving on to the next run in its queue
+// once the one at the tail is used up. The axis stays inactive until st_queue_expand()
+// extends its last run or adds another.
+static void IRAM_ATTR step_replay_resume(int axis) {
+    step_queue_t&  queue  = step_queue[axis];
+    step_replay_t& replay = step_replay[axis];
+    if (replay.done < queue.runs[queue.tail].count) {
+        replay.active = true;
+        return;
+    }
+    uint8_t tail = queue.tail + 1 == STEP_QUEUE_RUNS ? 0 : queue.tail + 1;
+    if (tail == queue.head) {
+        replay.active = false;
+        return;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const step_run_t& run = queue.runs[tail];
+    replay.next           = run.first;
+    replay.interval       = run.interval;
+    replay.add            = run.add;
+    replay.done           = 0;
+    replay.active         = run.count != 0;
+    queue.tail            = tail;
+}
+
+// Stands in for the Bresenham step in the ISR. Finds the next step event in the step queue,
+// sets st.step_outbits for it and the timer period to reach it. Returns false when the segment
+// buffer is empty.
+static bool IRAM_ATTR step_queue_next_event() {
+    auto     n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : motion_config->n_axis;
+    uint64_t earliest;
+    while (true) {
+        if (st.exec_segment == NULL) {
+            if (segment_buffer_head == segment_buffer_tail) {
+                step_queue_now = step_queue_segment_end;  // The next segment starts when the steppers restart
+                return false;
+            }
+            st.step_outbits = 0;
+            if (segment_buffer_tail == segment_buffer_expanded) {
+                // The expander is behind. Look again shortly, without moving step time on, so the
+                // wait only delays the steps.
+                Stepper_Timer_WritePeriod(stepQueueRetryTicks);
+                return true;
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+#ifdef USE_I2S_STEPS
+            hold_ramp_check_segment();
+#endif
+            st.exec_segment     = &segment_buffer[segment_buffer_tail];
+            st.exec_block_index = st.exec_segment->st_block_index;
+            st.exec_block       = &st_block_buffer[st.exec_block_index];
+            st.dir_outbits      = st.exec_block->direction_bits;
+            step_queue_segment_end =
+                st.exec_segment->start_time + ((uint64_t(st.exec_segment->n_step) * st.exec_segment->isrPeriod) << stepQueueTimeShift);
+            for (int axis = 0; axis < n_axis; axis++) {
+                if (!step_replay[axis].active) {
+                    step_replay_resume(axis);
+                }
+            }
+            // Set real-time spindle output as segment is loaded, just prior to the first step.
+            spindle->set_rpm(st.exec_segment->spindle_rpm);
+        }
+        earliest = UINT64_MAX;
+        for (int axis = 0; axis < n_axis; axis++) {
+            if (step_replay[axis].active && step_replay[axis].next < earliest) {
+                earliest = step_replay[axis].next;
+            }
+        }
+        if (earliest <= step_queue_segment_end) {
+            break;
+        }
+        // Segment is complete. Discard current segment and advance segment indexing.
+        st_fold_segment_steps();
+        st.exec_segment = NULL;
+        if (++segment_buffer_tail == SEGMENT_BUFFER_SIZE) {
+            segment_buffer_tail = 0;
+        }
+    }
+
+    // Steps are rounded to the nearest timer tick, and held back if they come too soon after
+    // the previous event for the step pulse to finish.
+    const uint64_t half       = 1 << (stepQueueTimeShift - 1);
+    uint64_t       now_tick   = step_queue_now >> stepQueueTimeShift;
+    uint64_t       event_tick = max((earliest + half) >> stepQueueTimeShift, now_tick + step_queue_min_period);
+    uint64_t       period     = event_tick - now_tick;
+    st.step_outbits           = 0;
+    if (period > 0xffff) {
+        // Too far off for a 16 bit timer period. Wake part of the way there.
+        Stepper_Timer_WritePeriod(0xffff);
+        step_queue_now += uint64_t(0xffff) << stepQueueTimeShift;
+        return true;
+    }
+    for (int axis = 0; axis < n_axis; axis++) {
+        step_replay_t& replay = step_replay[axis];
+        if (replay.active && replay.next <= step_queue_segment_end && (replay.next + half) >> stepQueueTimeShift <= event_tick) {
+            st.step_outbits |= bit(axis);
+            st.segment_steps[axis]++;
+            replay.done++;
+            replay.next += replay.interval;
+            replay.interval += replay.add;
+            if (replay.done >= step_queue[axis].runs[step_queue[axis].tail].count) {
+                step_replay_resume(axis);
+            }
+        }
+    }
+    Stepper_Timer_WritePeriod(period);
+    step_queue_now = event_tick << stepQueueTimeShift;
+    return true;
+}
+#endif
+
 /**
  * This phase of the ISR should ONLY create the pulses for the steppers.
  * This prevents jitter caused by the interval between the start of the
  * interrupt and the start of the pulses. DON'T add any logic ahead of the
  * call to this method that might cause variation in the timing. The aim
  * is to keep pulse timing as regular as possible.
+ *
+ * With ST_TIMED and ST_I2S_STATIC the pulse timer ends the step pulse, and
+ * raises it after a direction change, so this returns without waiting.
  */
 static void stepper_pulse_func() {
-    auto n_axis = number_axis->get();
+    const MotionConfig* config = motion_config;
+    auto                n_axis = AXIS_LOOP_COUNT ? AXIS_LOOP_COUNT : config->n_axis;
 
+    bool timed_pulse = current_stepper == ST_TIMED || current_stepper == ST_I2S_STATIC;
+    if (timed_pulse && pulse_phase != PulsePhase::Idle) {
+        pulse_timer_finish();
+    }
+
+    bool delay_step = false;
+#ifdef ENABLE_STEPPER_ISR_STATS
+    uint32_t pins_start     = xthal_get_ccount();
+    bool     direction_flip = motors_direction(st.dir_outbits);
+    uint32_t pins_cycles    = xthal_get_ccount() - pins_start;
+    if (direction_flip) {
+#else
     if (motors_direction(st.dir_outbits)) {
-        auto wait_direction = direction_delay_microseconds->get();
+#endif
+        auto wait_direction = config->direction_delay_microseconds;
         if (wait_direction > 0) {
             // Stepper drivers need some time between changing direction and doing a pulse.
             switch (current_stepper) {
@@ -231,40 +731,77 @@ static void stepper_pulse_func() {
                     i2s_out_push_sample(wait_direction);
                     break;
                 case ST_I2S_STATIC:
-                case ST_TIMED: {
-                    // wait for step pulse time to complete...some time expired during code above
-                    //
-                    // If we are using GPIO stepping as opposed to RMT, record the
-                    // time that we turned on the direction pins so we can delay a bit.
-                    // If we are using RMT, we can't delay here.
-                    auto direction_pulse_start_time = esp_timer_get_time() + wait_direction;
-                    while ((esp_timer_get_time() - direction_pulse_start_time) < 0) {
-                        NOP();  // spin here until time to turn off step
-                    }
+                case ST_TIMED:
+                    // The pulse timer raises the step pins when the delay is over.
+                    st.step_bits = st.step_outbits;
+                    pulse_timer_arm(PulsePhase::DirectionDelay, wait_direction);
+                    delay_step = true;
                     break;
-                }
                 case ST_RMT:
                     break;
             }
         }
     }
 
-    // If we are using GPIO stepping as opposed to RMT, record the
-    // time that we turned on the step pins so we can turn them off
-    // at the end of this routine without incurring another interrupt.
-    // This is unnecessary with RMT and I2S stepping since both of
-    // those methods time the turn off automatically.
-    //
-    // NOTE: We could use direction_pulse_start_time + wait_direction, but let's play it safe
-    uint64_t step_pulse_start_time = esp_timer_get_time();
-    motors_step(st.step_outbits);
+    if (!delay_step) {
+#ifdef ENABLE_STEPPER_ISR_STATS
+        pins_start = xthal_get_ccount();
+        motors_step(st.step_outbits);
+        pins_cycles += xthal_get_ccount() - pins_start;
+#else
+        motors_step(st.step_outbits);
+#endif
+        if (timed_pulse && st.step_outbits) {
+            pulse_timer_arm(PulsePhase::StepHigh, config->pulse_microseconds);
+        }
+    }
+#ifdef ENABLE_STEPPER_ISR_STATS
+    isr_histogram_add(stepper_isr_stats.pins, pins_cycles);
+#endif
 
+#ifdef USE_STEP_QUEUE
+    if (!step_queue_next_event()) {
+        // Segment buffer empty. Shutdown.
+        st_go_idle();
+        if (sys.state != State::Jog) {  // added to prevent ... jog after probing crash
+            // Ensure pwm is set properly upon completion of rate-controlled motion.
+            if (st.exec_block != NULL && st.exec_block->is_pwm_rate_adjusted) {
+                spindle->set_rpm(0);
+            }
+        }
+        cycle_stop = true;
+        return;  // Nothing to do but exit.
+    }
+    // Check probing state.
+    if (sys_probe_state == Probe::Active) {
+        probe_state_monitor();
+    }
+    // During a homing cycle, lock out and prevent desired axes from moving.
+    if (sys.state == State::Homing) {
+        st.step_outbits &= sys.homing_axis_lock;
+    }
+#else
+#ifdef USE_RMT_STEPS
+    if (st.step_train_period && st.exec_segment != NULL) {
+        // The step train is over. Go back to an ISR tick per step event.
+        st.step_train_period = false;
+        Stepper_Timer_WritePeriod(st.exec_segment->isrPeriod);
+    }
+    // A step train is only started once the directions of its segment are out
+    bool segment_loaded = false;
+#endif
     // If there is no step segment, attempt to pop one from the stepper buffer
     if (st.exec_segment == NULL) {
         // Anything in the buffer? If so, load and initialize next step segment.
         if (segment_buffer_head != segment_buffer_tail) {
             // Initialize new step segment and load number of steps to execute
+#ifdef USE_I2S_STEPS
+            hold_ramp_check_segment();
+#endif
             st.exec_segment = &segment_buffer[segment_buffer_tail];
+#ifdef USE_RMT_STEPS
+            segment_loaded = true;
+#endif
             // Initialize step segment timing per step and load number of steps to execute.
             Stepper_Timer_WritePeriod(st.exec_segment->isrPeriod);
             st.step_count = st.exec_segment->n_step;  // NOTE: Can sometimes be zero when moving slow.
@@ -305,19 +842,13 @@ static void stepper_pulse_func() {
     // Reset step out bits.
     st.step_outbits = 0;
 
-    for (int axis = 0; axis < n_axis; axis++) {
-        // Execute step displacement profile by Bresenham line algorithm
-        st.counter[axis] += st.steps[axis];
-        if (st.counter[axis] > st.exec_block->step_event_count) {
-            st.step_outbits |= bit(axis);
-            st.counter[axis] -= st.exec_block->step_event_count;
-            if (st.exec_block->direction_bits & bit(axis)) {
-                sys_position[axis]--;
-            } else {
-                sys_position[axis]++;
-            }
-        }
+#ifdef USE_RMT_STEPS
+    if (!segment_loaded && st_step_train()) {
+        return;
     }
+#endif
+
+    st.step_outbits = st_bresenham_tick();
 
     // During a homing cycle, lock out and prevent desired axes from moving.
     if (sys.state == State::Homing) {
@@ -326,25 +857,19 @@ static void stepper_pulse_func() {
     st.step_count--;  // Decrement step events count
     if (st.step_count == 0) {
         // Segment is complete. Discard current segment and advance segment indexing.
-        st.exec_segment = NULL;
-        if (++segment_buffer_tail == SEGMENT_BUFFER_SIZE) {
-            segment_buffer_tail = 0;
-        }
+        st_segment_complete();
     }
+#endif
 
     switch (current_stepper) {
         case ST_I2S_STREAM:
             // Generate the number of pulses needed to span pulse_microseconds
-            i2s_out_push_sample(pulse_microseconds->get());
+            i2s_out_push_sample(config->pulse_microseconds);
             motors_unstep();
             break;
         case ST_I2S_STATIC:
         case ST_TIMED:
-            // wait for step pulse time to complete...some time expired during code above
-            while (esp_timer_get_time() - step_pulse_start_time < pulse_microseconds->get()) {
-                NOP();  // spin here until time to turn off step
-            }
-            motors_unstep();
+            // The pulse timer turns the step pins off.
             break;
         case ST_RMT:
             break;
@@ -353,6 +878,9 @@ static void stepper_pulse_func() {
 
 void stepper_init() {
     busy.store(false); 
+#ifdef ENABLE_STEPPER_ISR_STATS
+    st_isr_stats_reset();
+#endif
     
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "Axis count %d", number_axis->get());
     grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Info, "%s", stepper_names[current_stepper]);
@@ -360,9 +888,24 @@ void stepper_init() {
 #ifdef USE_I2S_STEPS
     // I2S stepper stream mode use callback but timer interrupt
     i2s_out_set_pulse_callback(stepper_pulse_func);
+    if (i2s_out_set_dmabuf_count(i2s_dmabuf_count->get()) < 0) {
+        grbl_msg_sendf(CLIENT_SERIAL, MsgLevel::Error, "Cannot allocate %d I2S buffers", i2s_dmabuf_count->get());
+    }
 #endif
     // Other stepper use timer interrupt
     Stepper_Timer_Init();
+
+#ifdef USE_STEP_QUEUE
+    step_queue_mutex = xSemaphoreCreateMutex();
+    xTaskCreatePinnedToCore(stepQueueTask,    // task
+                            "stepQueueTask",  // name for task
+                            2048,             // size of task stack
+                            NULL,             // parameters
+                            3,                // priority
+                            &step_queue_task_handle,
+                            0  // the core that does not run motion control
+    );
+#endif
 }
 
 void stepper_switch(stepper_id_t new_stepper) {
@@ -394,14 +937,21 @@ void st_wake_up() {
     // Initialize step pulse timing from settings. Here to ensure updating after re-writing.
 #ifdef USE_RMT_STEPS
     // Step pulse delay handling is not require with ESP32...the RMT function does it.
-    if (direction_delay_microseconds->get() < 1)
+    if (motion_config->direction_delay_microseconds < 1)
     {
         // Set step pulse time. Ad hoc computation from oscilloscope. Uses two's complement.
-        st.step_pulse_time = -(((pulse_microseconds->get() - 2) * ticksPerMicrosecond) >> 3);
+        st.step_pulse_time = -(((motion_config->pulse_microseconds - 2) * ticksPerMicrosecond) >> 3);
     }
 #else  // Normal operation
     // Set step pulse time. Ad hoc computation from oscilloscope. Uses two's complement.
-    st.step_pulse_time = -(((pulse_microseconds->get() - 2) * ticksPerMicrosecond) >> 3);
+    st.step_pulse_time = -(((motion_config->pulse_microseconds - 2) * ticksPerMicrosecond) >> 3);
+#endif
+#ifdef USE_STEP_QUEUE
+    // Room for the step pulse, the low time after it and a direction change before the next one
+    step_queue_min_period = (2 * motion_config->pulse_microseconds + motion_config->direction_delay_microseconds) * ticksPerMicrosecond;
+    if (step_queue_min_period < ticksPerMicrosecond) {
+        step_queue_min_period = ticksPerMicrosecond;
+    }
 #endif
 
     // Enable Stepper Driver Interrupt
@@ -423,6 +973,9 @@ void st_reset() {
     // Initialize stepper algorithm variables.
     memset(&prep, 0, sizeof(st_prep_t));
     memset(&st, 0, sizeof(stepper_t));
+#ifdef USE_I2S_STEPS
+    hold_ramp_active = false;
+#endif
     st.exec_segment     = NULL;
     pl_block            = NULL;  // Planner block pointer used by segment buffer
     segment_buffer_tail = 0;
@@ -431,6 +984,26 @@ void st_reset() {
     st.step_outbits     = 0;
     st.dir_outbits      = 0;  // Initialize direction bits to default.
     // TODO do we need to turn step pins off?
+#ifdef USE_STEP_QUEUE
+    if (step_queue_mutex) {
+        xSemaphoreTake(step_queue_mutex, portMAX_DELAY);
+    }
+    for (int axis = 0; axis < MAX_N_AXIS; axis++) {
+        // The queue always holds the run the ISR replayed last, at first an empty one.
+        step_queue[axis].runs[0].count = 0;
+        step_queue[axis].tail          = 0;
+        step_queue[axis].head          = 1;
+        step_queue_extendable[axis]    = false;
+    }
+    memset(step_replay, 0, sizeof(step_replay));
+    step_queue_now          = 0;
+    step_queue_segment_end  = 0;
+    step_queue_clock        = 0;
+    segment_buffer_expanded = 0;
+    if (step_queue_mutex) {
+        xSemaphoreGive(step_queue_mutex);
+    }
+#endif
 }
 
 // Stepper shutdown
@@ -455,8 +1028,21 @@ void st_go_idle() {
         motors_set_disable(false);
     }
 
+    pulse_timer_finish();
     motors_unstep();
     st.step_outbits = 0;
+#ifdef USE_RMT_STEPS
+    if (st.step_train_period) {
+        // A step train still running finishes by itself. Its long period must not delay
+        // the first ISR after the next wake up.
+        st.step_train_period = false;
+        Stepper_Timer_WritePeriod(amassThreshold);
+    }
+#endif
+#ifdef STEPPER_BATCHED_POSITION
+    // A stop part way through a segment, on reset or abort, keeps the steps already taken
+    st_fold_segment_steps();
+#endif
 }
 
 // Called by planner_recalculate() when the executing block is updated by the new plan.
@@ -468,6 +1054,37 @@ void st_update_plan_block_parameters() {
     }
 }
 
+// Called when a feed hold starts, ahead of st_update_plan_block_parameters(). With the I2S
+// stream, the segments prepared before the hold, past the one being executed, slow down as they
+// are rendered instead of playing out at full speed. The hold deceleration is then planned from
+// the slower speed.
+void st_hold_ramp() {
+#ifdef USE_I2S_STEPS
+    if (current_stepper != ST_I2S_STREAM || pl_block == NULL || prep.current_speed <= 0.0) {
+        return;
+    }
+    float    stop_usec  = prep.current_speed / pl_block->acceleration * 60.0e6;  // Time for a full stop (usec)
+    uint32_t ramp_ticks = 0;                                                      // Step time of the segments ahead
+    uint8_t  index      = segment_buffer_tail;                                    // The segment being executed
+    while (index != segment_buffer_head) {
+        if (++index == SEGMENT_BUFFER_SIZE) {
+            index = 0;
+        }
+        if (index != segment_buffer_head) {
+            ramp_ticks += uint32_t(segment_buffer[index].n_step) * segment_buffer[index].isrPeriod;
+        }
+    }
+    hold_ramp_head   = segment_buffer_head;
+    hold_ramp_active = true;
+    uint32_t scale   = i2s_out_hold_ramp(stop_usec < UINT32_MAX ? uint32_t(stop_usec) : UINT32_MAX, ramp_ticks / ticksPerMicrosecond);
+    if (scale == I2S_OUT_PERIOD_SCALE_ONE) {
+        hold_ramp_active = false;
+        return;
+    }
+    prep.current_speed = prep.current_speed * I2S_OUT_PERIOD_SCALE_ONE / scale;
+#endif
+}
+
 #ifdef PARKING_ENABLE
 // Changes the run state of the step segment buffer to execute the special parking motion.
 void st_parking_setup_buffer() {
@@ -510,6 +1127,177 @@ static uint8_t st_next_block_index(uint8_t block_index) {
     return block_index == (SEGMENT_BUFFER_SIZE - 1) ? 0 : block_index;
 }
 
+// Sets up the S-curve for a ramp from start_mm to end_mm that changes speed from v0 to v1, which
+// the profile sized with plan_ramp_distance(). Leaves the ramp linear if the block has no jerk limit.
+static void st_scurve_begin(float start_mm, float end_mm, float v0, float v1) {
+    st_scurve_t* r = &prep.scurve;
+    r->active      = false;
+    float dv       = fabs(v1 - v0);
+    if (pl_block->jerk <= 0.0 || dv <= 0.0 || start_mm <= end_mm) {
+        return;
+    }
+    r->start_mm  = start_mm;
+    r->end_mm    = end_mm;
+    r->v0        = v0;
+    r->v1        = v1;
+    r->duration  = plan_ramp_time(dv, pl_block->acceleration, pl_block->jerk);
+    r->jerk_time = MIN(pl_block->acceleration / pl_block->jerk, 0.5 * r->duration);
+    r->time      = 0.0;
+    r->accel     = (v1 - v0) / (r->duration - r->jerk_time);  // The acceleration limit, or less for a short ramp
+    r->jerk      = r->accel / r->jerk_time;                   // The jerk limit
+    r->active    = true;
+}
+
+// Highest speed, up to max_speed, of a jerk-limited profile of the block that ramps from v0 up
+// and back down to v1 within length. The speeds must be able to meet within length.
+static float st_scurve_peak_speed(float v0, float v1, float length, float max_speed) {
+    float acceleration = pl_block->acceleration;
+    float jerk         = pl_block->jerk;
+    float low          = MAX(v0, v1);
+    float high         = MIN(max_speed, plan_ramp_speed(MIN(v0, v1), length, acceleration, jerk));
+    for (int i = 0; i < SCURVE_SOLVE_STEPS; i++) {
+        float mid = 0.5 * (low + high);
+        if (plan_ramp_distance(v0, mid, acceleration, jerk) + plan_ramp_distance(v1, mid, acceleration, jerk) <= length) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+// Lowest speed, down to floor, that a jerk-limited ramp of the block slows down to from speed
+// within length, when it cannot get to floor.
+static float st_scurve_lowest_speed(float speed, float length, float floor) {
+    float low  = floor;
+    float high = speed;
+    for (int i = 0; i < SCURVE_SOLVE_STEPS; i++) {
+        float mid = 0.5 * (low + high);
+        if (plan_ramp_distance(mid, speed, pl_block->acceleration, pl_block->jerk) <= length) {
+            high = mid;
+        } else {
+            low = mid;
+        }
+    }
+    return high;
+}
+
+// Jerk-limited counterpart of the velocity profile st_prep_buffer() computes for a trapezoid, for
+// the last length of the block, from entry_speed to exit_speed.
+static void st_scurve_profile(float entry_speed, float length, float exit_speed, float nominal_speed) {
+    float acceleration = pl_block->acceleration;
+    float jerk         = pl_block->jerk;
+    if (entry_speed > nominal_speed) {  // Only occurs during override reductions.
+        prep.accelerate_until = length - plan_ramp_distance(nominal_speed, entry_speed, acceleration, jerk);
+        if (prep.accelerate_until <= 0.0) {  // Deceleration-only.
+            prep.ramp_type                      = RAMP_DECEL;
+            prep.exit_speed                     = st_scurve_lowest_speed(entry_speed, length, nominal_speed);
+            prep.recalculate_flag.decelOverride = 1;  // Flag to load next block as deceleration override.
+        } else {
+            prep.decelerate_after = plan_ramp_distance(exit_speed, nominal_speed, acceleration, jerk);
+            prep.maximum_speed    = nominal_speed;
+            prep.ramp_type        = RAMP_DECEL_OVERRIDE;
+        }
+        return;
+    }
+    float accelerate_mm = plan_ramp_distance(entry_speed, nominal_speed, acceleration, jerk);
+    float decelerate_mm = plan_ramp_distance(exit_speed, nominal_speed, acceleration, jerk);
+    if (accelerate_mm + decelerate_mm <= length) {  // Trapezoid, acceleration-cruise, cruise-deceleration or cruise-only types
+        prep.maximum_speed    = nominal_speed;
+        prep.decelerate_after = decelerate_mm;
+        if (entry_speed == nominal_speed) {
+            prep.ramp_type = RAMP_CRUISE;
+        } else {
+            prep.accelerate_until = length - accelerate_mm;
+        }
+    } else if (exit_speed > entry_speed && plan_ramp_distance(entry_speed, exit_speed, acceleration, jerk) >= length) {
+        prep.accelerate_until = 0.0;  // Acceleration-only type
+        prep.maximum_speed    = exit_speed;
+    } else if (exit_speed < entry_speed && plan_ramp_distance(exit_speed, entry_speed, acceleration, jerk) >= length) {
+        prep.ramp_type = RAMP_DECEL;  // Deceleration-only type
+    } else {                          // Triangle type, with a cruise left by rounding
+        prep.maximum_speed    = st_scurve_peak_speed(entry_speed, exit_speed, length, nominal_speed);
+        prep.accelerate_until = length - plan_ramp_distance(entry_speed, prep.maximum_speed, acceleration, jerk);
+        prep.decelerate_after = plan_ramp_distance(exit_speed, prep.maximum_speed, acceleration, jerk);
+    }
+}
+
+// When the planner updates the block during a jerk-limited acceleration ramp, keeps the ramp going
+// and plans the rest of the block from where it ends, so the acceleration does not drop to zero
+// mid-ramp. Returns false, to have the profile planned from the current speed instead, when the
+// exit speed cannot be reached from the end of the ramp, or the ramp goes past the nominal speed.
+static bool st_scurve_continue(float exit_speed, float nominal_speed) {
+    const st_scurve_t* r            = &prep.scurve;
+    float              acceleration = pl_block->acceleration;
+    float              jerk         = pl_block->jerk;
+    float              ramp_mm      = (exit_speed > r->v1) ? plan_ramp_distance(r->v1, exit_speed, acceleration, jerk)
+                                                           : plan_ramp_distance(exit_speed, r->v1, acceleration, jerk);
+    if (r->v1 > nominal_speed || ramp_mm > r->end_mm) {
+        return false;
+    }
+    st_scurve_profile(r->v1, r->end_mm, exit_speed, nominal_speed);
+    if (prep.ramp_type != RAMP_ACCEL) {  // Cruise or deceleration after the ramp
+        if (prep.ramp_type == RAMP_DECEL) {
+            prep.decelerate_after = r->end_mm;
+        }
+        prep.ramp_type        = RAMP_ACCEL;
+        prep.accelerate_until = r->end_mm;
+        prep.maximum_speed    = r->v1;
+    }
+    return true;
+}
+
+// Speed at time t into the current S-curve ramp.
+static float st_scurve_speed(float t) {
+    st_scurve_t* r = &prep.scurve;
+    if (t < r->jerk_time) {
+        return r->v0 + 0.5 * r->jerk * t * t;
+    }
+    float tau = r->duration - t;
+    if (tau < r->jerk_time) {
+        return r->v1 - 0.5 * r->jerk * tau * tau;
+    }
+    return r->v0 + r->accel * (t - 0.5 * r->jerk_time);
+}
+
+// Distance from end of block at time t into the current S-curve ramp.
+static float st_scurve_mm_remaining(float t) {
+    st_scurve_t* r = &prep.scurve;
+    float        s;
+    if (t < r->jerk_time) {
+        s = t * (r->v0 + r->jerk * t * t / 6.0);
+    } else {
+        float tau = r->duration - t;
+        if (tau < r->jerk_time) {
+            s = (r->start_mm - r->end_mm) - tau * (r->v1 - r->jerk * tau * tau / 6.0);
+        } else {
+            float tj = r->jerk_time;
+            float u  = t - tj;
+            s        = tj * (r->v0 + r->accel * tj / 6.0) + u * (r->v0 + 0.5 * r->accel * (tj + u));
+        }
+    }
+    return r->start_mm - s;
+}
+
+// Advances the current S-curve ramp by time_var. Returns true at the end of the ramp, with
+// time_var trimmed to the time left in the ramp. Otherwise updates mm_remaining and speed.
+static bool st_scurve_step(float& time_var, float& mm_remaining) {
+    st_scurve_t* r    = &prep.scurve;
+    float        t    = r->time + time_var;
+    float        mm_t = st_scurve_mm_remaining(t);
+    if (t >= r->duration || mm_t <= r->end_mm) {
+        time_var     = r->duration - r->time;
+        mm_remaining = r->end_mm;
+        r->time      = r->duration;
+        r->active    = false;
+        return true;
+    }
+    r->time            = t;
+    mm_remaining       = mm_t;
+    prep.current_speed = st_scurve_speed(t);
+    return false;
+}
+
 /* Prepares step segment buffer. Continuously called from main program.
 
    The segment buffer is an intermediary buffer interface between the execution of steps
@@ -532,6 +1320,7 @@ void st_prep_buffer() {
     while (segment_buffer_tail != segment_next_head) {  // Check if we need to fill the buffer.
         // Determine if we need to load a new planner block or if the block needs to be recomputed.
         if (pl_block == NULL) {
+            bool ramp_running = false;  // A recompute finds the block in a jerk-limited acceleration ramp
             // Query planner for a queued block
             if (sys.step_control.executeSysMotion) {
                 pl_block = plan_get_system_motion_block();
@@ -545,6 +1334,7 @@ void st_prep_buffer() {
 
             // Check if we need to only recompute the velocity profile or load a new block.
             if (prep.recalculate_flag.recalculate) {
+                ramp_running = prep.scurve.active && prep.ramp_type == RAMP_ACCEL;
 #ifdef PARKING_ENABLE
                 if (prep.recalculate_flag.parking) {
                     prep.recalculate_flag.recalculate = 0;
@@ -563,7 +1353,7 @@ void st_prep_buffer() {
                 st_prep_block                 = &st_block_buffer[prep.st_block_index];
                 st_prep_block->direction_bits = pl_block->direction_bits;
                 uint8_t idx;
-                auto    n_axis = number_axis->get();
+                auto    n_axis = motion_config->n_axis;
 
                 // Bit-shift multiply all Bresenham data by the max AMASS level so that
                 // we never divide beyond the original data anywhere in the algorithm.
@@ -572,6 +1362,20 @@ void st_prep_buffer() {
                     st_prep_block->steps[idx] = pl_block->steps[idx] << maxAmassLevel;
                 }
                 st_prep_block->step_event_count = pl_block->step_event_count << maxAmassLevel;
+#ifdef USE_STEP_QUEUE
+                st_prep_block->events_expanded = 0;
+#endif
+#ifdef USE_RMT_STEPS
+                st_prep_block->step_train_axes = 0;
+                for (idx = 0; idx < n_axis; idx++) {
+                    if (pl_block->steps[idx] == pl_block->step_event_count) {
+                        st_prep_block->step_train_axes |= bit(idx);
+                    } else if (pl_block->steps[idx] != 0) {
+                        st_prep_block->step_train_axes = 0;
+                        break;
+                    }
+                }
+#endif
 
                 // Initialize segment buffer data for generating the segments.
                 prep.steps_remaining  = (float)pl_block->step_event_count;
@@ -605,13 +1409,23 @@ void st_prep_buffer() {
             */
             prep.mm_complete  = 0.0;  // Default velocity profile complete at 0.0mm from end of block.
             float inv_2_accel = 0.5 / pl_block->acceleration;
+            bool  continued   = false;  // The jerk-limited acceleration ramp of a recomputed block goes on
             if (sys.step_control.executeHold) {  // [Forced Deceleration to Zero Velocity]
                 // Compute velocity profile parameters for a feed hold in-progress. This profile overrides
                 // the planner block profile, enforcing a deceleration to zero speed.
                 prep.ramp_type = RAMP_DECEL;
                 // Compute decelerate distance relative to end of block.
-                float decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
-                if (decel_dist < 0.0) {
+                float decel_dist;
+                if (pl_block->jerk > 0.0) {
+                    decel_dist = pl_block->millimeters -
+                                 plan_ramp_distance(0.0, prep.current_speed, pl_block->acceleration, pl_block->jerk);
+                } else {
+                    decel_dist = pl_block->millimeters - inv_2_accel * pl_block->entry_speed_sqr;
+                }
+                if (decel_dist < 0.0 && pl_block->jerk > 0.0) {
+                    // Deceleration through entire planner block, as a whole jerk-limited ramp.
+                    prep.exit_speed = st_scurve_lowest_speed(prep.current_speed, pl_block->millimeters, 0.0);
+                } else if (decel_dist < 0.0) {
                     // Deceleration through entire planner block. End of feed hold is not in this block.
                     prep.exit_speed = sqrt(pl_block->entry_speed_sqr - 2 * pl_block->acceleration * pl_block->millimeters);
                 } else {
@@ -634,7 +1448,12 @@ void st_prep_buffer() {
                 nominal_speed            = plan_compute_profile_nominal_speed(pl_block);
                 float nominal_speed_sqr  = nominal_speed * nominal_speed;
                 float intersect_distance = 0.5 * (pl_block->millimeters + inv_2_accel * (pl_block->entry_speed_sqr - exit_speed_sqr));
-                if (pl_block->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
+                if (pl_block->jerk > 0.0) {
+                    continued = ramp_running && st_scurve_continue(prep.exit_speed, nominal_speed);
+                    if (!continued) {
+                        st_scurve_profile(prep.current_speed, pl_block->millimeters, prep.exit_speed, nominal_speed);
+                    }
+                } else if (pl_block->entry_speed_sqr > nominal_speed_sqr) {  // Only occurs during override reductions.
                     prep.accelerate_until = pl_block->millimeters - inv_2_accel * (pl_block->entry_speed_sqr - nominal_speed_sqr);
                     if (prep.accelerate_until <= 0.0) {  // Deceleration-only.
                         prep.ramp_type = RAMP_DECEL;
@@ -681,6 +1500,17 @@ void st_prep_buffer() {
                     prep.maximum_speed = prep.exit_speed;
                 }
             }
+            // Shape the first ramp of the profile when the block is jerk limited. A deceleration
+            // ramp that follows acceleration or cruising is shaped when the segment loop reaches it.
+            if (continued) {
+                // The running ramp leads into the recomputed profile.
+            } else if (prep.ramp_type == RAMP_ACCEL || prep.ramp_type == RAMP_DECEL_OVERRIDE) {
+                st_scurve_begin(pl_block->millimeters, prep.accelerate_until, prep.current_speed, prep.maximum_speed);
+            } else if (prep.ramp_type == RAMP_DECEL) {
+                st_scurve_begin(pl_block->millimeters, prep.mm_complete, prep.current_speed, prep.exit_speed);
+            } else {
+                prep.scurve.active = false;
+            }
 
             sys.step_control.updateSpindleRpm = true;  // Force update whenever updating block.
         }
@@ -690,6 +1520,9 @@ void st_prep_buffer() {
 
         // Set new segment to point to the current segment data block.
         prep_segment->st_block_index = prep.st_block_index;
+#ifdef USE_STEP_QUEUE
+        prep_segment->entry_speed = prep.current_speed;
+#endif
 
         /*------------------------------------------------------------------------------------
             Compute the average velocity of this new segment by determining the total distance
@@ -720,6 +1553,13 @@ void st_prep_buffer() {
         do {
             switch (prep.ramp_type) {
                 case RAMP_DECEL_OVERRIDE:
+                    if (prep.scurve.active) {  // Jerk-limited ramp down to the overridden speed
+                        if (st_scurve_step(time_var, mm_remaining)) {
+                            prep.ramp_type     = RAMP_CRUISE;
+                            prep.current_speed = prep.maximum_speed;
+                        }
+                        break;
+                    }
                     speed_var = pl_block->acceleration * time_var;
                     mm_var    = time_var * (prep.current_speed - 0.5 * speed_var);
                     mm_remaining -= mm_var;
@@ -734,22 +1574,35 @@ void st_prep_buffer() {
                     }
                     break;
                 case RAMP_ACCEL:
-                    // NOTE: Acceleration ramp only computes during first do-while loop.
-                    speed_var = pl_block->acceleration * time_var;
-                    mm_remaining -= time_var * (prep.current_speed + 0.5 * speed_var);
-                    if (mm_remaining < prep.accelerate_until) {  // End of acceleration ramp.
-                        // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+                    if (prep.scurve.active) {  // Jerk-limited ramp. Advanced by ramp time instead of speed.
+                        if (!st_scurve_step(time_var, mm_remaining)) {
+                            break;  // Acceleration only.
+                        }
+                        if (prep.scurve.v1 < prep.maximum_speed) {  // Recomputed to a higher speed. Ramp on from here.
+                            prep.current_speed = prep.scurve.v1;
+                            st_scurve_begin(mm_remaining, prep.accelerate_until, prep.current_speed, prep.maximum_speed);
+                            break;
+                        }
+                    } else {
+                        // NOTE: Acceleration ramp only computes during first do-while loop.
+                        speed_var = pl_block->acceleration * time_var;
+                        mm_remaining -= time_var * (prep.current_speed + 0.5 * speed_var);
+                        if (mm_remaining >= prep.accelerate_until) {  // Acceleration only.
+                            prep.current_speed += speed_var;
+                            break;
+                        }
                         mm_remaining = prep.accelerate_until;  // NOTE: 0.0 at EOB
                         time_var     = 2.0 * (pl_block->millimeters - mm_remaining) / (prep.current_speed + prep.maximum_speed);
-                        if (mm_remaining == prep.decelerate_after) {
-                            prep.ramp_type = RAMP_DECEL;
-                        } else {
-                            prep.ramp_type = RAMP_CRUISE;
-                        }
-                        prep.current_speed = prep.maximum_speed;
-                    } else {  // Acceleration only.
-                        prep.current_speed += speed_var;
                     }
+                    // End of acceleration ramp.
+                    // Acceleration-cruise, acceleration-deceleration ramp junction, or end of block.
+                    if (mm_remaining == prep.decelerate_after) {
+                        prep.ramp_type = RAMP_DECEL;
+                        st_scurve_begin(prep.decelerate_after, prep.mm_complete, prep.maximum_speed, prep.exit_speed);
+                    } else {
+                        prep.ramp_type = RAMP_CRUISE;
+                    }
+                    prep.current_speed = prep.maximum_speed;
                     break;
                 case RAMP_CRUISE:
                     // NOTE: mm_var used to retain the last mm_remaining for incomplete segment time_var calculations.
@@ -761,11 +1614,18 @@ void st_prep_buffer() {
                         time_var       = (mm_remaining - prep.decelerate_after) / prep.maximum_speed;
                         mm_remaining   = prep.decelerate_after;  // NOTE: 0.0 at EOB
                         prep.ramp_type = RAMP_DECEL;
+                        st_scurve_begin(prep.decelerate_after, prep.mm_complete, prep.maximum_speed, prep.exit_speed);
                     } else {  // Cruising only.
                         mm_remaining = mm_var;
                     }
                     break;
                 default:  // case RAMP_DECEL:
+                    if (prep.scurve.active) {  // Jerk-limited ramp. Always ends at the end of the block.
+                        if (st_scurve_step(time_var, mm_remaining)) {
+                            prep.current_speed = prep.exit_speed;
+                        }
+                        break;
+                    }
                     // NOTE: mm_var used as a misc worker variable to prevent errors when near zero speed.
                     speed_var = pl_block->acceleration * time_var;  // Used as delta speed (mm/min)
                     if (prep.current_speed > speed_var) {           // Check if at or below zero speed.
@@ -797,6 +1657,9 @@ void st_prep_buffer() {
                 }
             }
         } while (mm_remaining > prep.mm_complete);  // **Complete** Exit loop. Profile complete.
+#ifdef USE_STEP_QUEUE
+        prep_segment->exit_speed = prep.current_speed;
+#endif
 
         /* -----------------------------------------------------------------------------------
           Compute spindle speed PWM output for step segment
@@ -885,10 +1748,19 @@ void st_prep_buffer() {
         prep_segment->isrPeriod = timerTicks > 0xffff ? 0xffff : timerTicks;
 
         // Segment complete! Increment segment buffer indices, so stepper ISR can immediately execute it.
+#ifdef USE_STEP_QUEUE
+        // With the step queue, the ISR waits until stepQueueTask has expanded it.
+        std::atomic_thread_fence(std::memory_order_release);
+#endif
         segment_buffer_head = segment_next_head;
         if (++segment_next_head == SEGMENT_BUFFER_SIZE) {
             segment_next_head = 0;
         }
+#ifdef USE_STEP_QUEUE
+        if (step_queue_task_handle) {
+            xTaskNotifyGive(step_queue_task_handle);
+        }
+#endif
         // Update the appropriate planner and segment data.
         pl_block->millimeters = mm_remaining;
         prep.steps_remaining  = n_steps_remaining;
@@ -920,6 +1792,171 @@ void st_prep_buffer() {
     }
 }
 
+#ifdef USE_STEP_QUEUE
+// A step segment as the expander sees it. Step event counts are without AMASS.
+typedef struct {
+    uint64_t start;         // Time of the start of the segment
+    uint64_t duration;      // Length of the segment
+    uint64_t end;           // start + duration
+    uint32_t block_events;  // Step events of the whole block
+    uint32_t done_events;   // Step events of the block before this segment
+    uint32_t n_events;      // Step events in this segment
+    float    entry_speed;
+    float    exit_speed;
+} step_expand_t;
+
+// Number of steps that the Bresenham line of an axis with the given block steps has taken
+// after the given step events. Step k is taken once (2k - 1) * block_events / (2 * steps)
+// step events have passed.
+static uint32_t step_queue_steps_after(const step_expand_t& seg, uint32_t steps, uint32_t events) {
+    return (2 * uint64_t(steps) * events + seg.block_events - 1) / (2 * uint64_t(seg.block_events));
+}
+
+// Time of step k of an axis. The speed is taken to change at a steady rate over the segment.
+static uint64_t step_queue_step_time(const step_expand_t& seg, uint32_t steps, uint32_t k) {
+    // Fraction of the segment distance covered at the step
+    int64_t  at     = (2 * int64_t(k) - 1) * seg.block_events - 2 * int64_t(steps) * seg.done_events;
+    float    u      = float(at) / (2 * float(steps) * float(seg.n_events));
+    float    v_sum  = seg.entry_speed + seg.exit_speed;
+    float    f_time = u;
+    if (v_sum > 0.0 && seg.entry_speed != seg.exit_speed) {
+        // Solves u = (entry_speed * t + (exit_speed - entry_speed) * t^2 / 2) / (v_sum / 2) for t
+        float root = seg.entry_speed * seg.entry_speed + (seg.exit_speed - seg.entry_speed) * v_sum * u;
+        f_time     = v_sum * u / (seg.entry_speed + sqrtf(root > 0.0 ? root : 0.0));
+    }
+    uint64_t time = seg.start + uint64_t(f_time * seg.duration);
+    // The step lands inside the segment, so the ISR takes it with the direction of the segment
+    return constrain(time, seg.start + 1, seg.end);
+}
+
+static uint64_t step_run_time(const step_run_t& run, int64_t j) {
+    return run.first + j * run.interval + run.add * (j * (j - 1) / 2);
+}
+
+// Checks that steps j0 to j1 of a run, if it were that long, would fall inside the segment
+// with the intervals between them positive.
+static bool step_run_fits(const step_run_t& run, int64_t j0, int64_t j1, const step_expand_t& seg) {
+    return step_run_time(run, j0) > seg.start && step_run_time(run, j1) <= seg.end && run.interval + run.add * j1 >= 0;
+}
+
+static bool step_queue_close(uint64_t a, uint64_t b) {
+    return (a > b ? a - b : b - a) <= stepQueueMaxError;
+}
+
+// Adds a run to the queue of an axis, or extends the last run in the queue with it when that
+// run already puts the new steps within stepQueueMaxError of their times.
+static void step_queue_push(int axis, const step_run_t& run, const step_expand_t& seg) {
+    step_queue_t& queue = step_queue[axis];
+    uint8_t       last  = (queue.head == 0 ? STEP_QUEUE_RUNS : queue.head) - 1;
+    if (step_queue_extendable[axis]) {
+        step_run_t& prev = queue.runs[last];
+        int64_t     j0   = prev.count;
+        int64_t     mid  = run.count / 2;
+        int64_t     last = run.count - 1;
+        if (step_run_fits(prev, j0, j0 + last, seg) && step_queue_close(step_run_time(prev, j0), run.first) &&
+            step_queue_close(step_run_time(prev, j0 + mid), step_run_time(run, mid)) &&
+            step_queue_close(step_run_time(prev, j0 + last), step_run_time(run, last))) {
+            prev.count = prev.count + run.count;
+            return;
+        }
+    }
+    queue.runs[queue.head] = run;
+    std::atomic_thread_fence(std::memory_order_release);
+    queue.head                  = queue.head + 1 == STEP_QUEUE_RUNS ? 0 : queue.head + 1;
+    step_queue_extendable[axis] = true;
+}
+
+// Fits steps k0 + 1 to k1 of an axis in a segment to a run. The run goes through the first,
+// second and last step. If it misses the middle one by more than stepQueueMaxError, the steps
+// are split in two halves, up to `splits` times, and after that spaced evenly.
+static void step_queue_add(int axis, const step_expand_t& seg, uint32_t steps, uint32_t k0, uint32_t k1, int splits) {
+    int64_t    n = k1 - k0;
+    step_run_t run;
+    run.first    = step_queue_step_time(seg, steps, k0 + 1);
+    run.interval = 0;
+    run.add      = 0;
+    run.count    = n;
+    if (n > 1) {
+        int64_t span = step_queue_step_time(seg, steps, k1) - run.first;
+        bool    fits = false;
+        if (n > 2) {
+            int64_t interval = step_queue_step_time(seg, steps, k0 + 2) - run.first;
+            int64_t add      = 2 * (span - (n - 1) * interval) / ((n - 1) * (n - 2));
+            run.add          = add;
+            run.interval     = (span - add * ((n - 1) * (n - 2) / 2)) / (n - 1);
+            fits             = run.add == add && step_run_fits(run, 0, n - 1, seg) &&
+                   step_queue_close(step_run_time(run, n / 2), step_queue_step_time(seg, steps, k0 + 1 + n / 2));
+            if (!fits && splits > 0) {
+                uint32_t k_mid = k0 + n / 2;
+                step_queue_add(axis, seg, steps, k0, k_mid, splits - 1);
+                step_queue_add(axis, seg, steps, k_mid, k1, splits - 1);
+                return;
+            }
+        }
+        if (!fits) {
+            run.add      = 0;
+            run.interval = span / (n - 1);
+        }
+    }
+    step_queue_push(axis, run, seg);
+}
+
+// Expands the segments that st_prep_buffer() has added since the last call into runs in the
+// step queue, and releases them to the stepper ISR. Stops early when a queue is too full for
+// the next segment; the ISR frees runs as it replays them.
+void st_queue_expand() {
+    xSemaphoreTake(step_queue_mutex, portMAX_DELAY);
+    auto n_axis = motion_config->n_axis;
+    while (segment_buffer_expanded != segment_buffer_head) {
+        for (int axis = 0; axis < n_axis; axis++) {
+            int used = step_queue[axis].head - step_queue[axis].tail;
+            if (used < 0) {
+                used += STEP_QUEUE_RUNS;
+            }
+            if (used + STEP_QUEUE_SEGMENT_RUNS > STEP_QUEUE_RUNS - 1) {
+                xSemaphoreGive(step_queue_mutex);
+                return;
+            }
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        segment_t*    segment = &segment_buffer[segment_buffer_expanded];
+        st_block_t*   block   = &st_block_buffer[segment->st_block_index];
+        step_expand_t seg;
+        seg.start        = step_queue_clock;
+        seg.duration     = (uint64_t(segment->n_step) * segment->isrPeriod) << stepQueueTimeShift;
+        seg.end          = seg.start + seg.duration;
+        seg.block_events = block->step_event_count >> maxAmassLevel;
+        seg.done_events  = block->events_expanded;
+        seg.n_events     = segment->n_step >> segment->amass_level;
+        seg.entry_speed  = segment->entry_speed;
+        seg.exit_speed   = segment->exit_speed;
+        for (int axis = 0; axis < n_axis; axis++) {
+            uint32_t steps = block->steps[axis] >> maxAmassLevel;
+            uint32_t k0    = step_queue_steps_after(seg, steps, seg.done_events);
+            uint32_t k1    = step_queue_steps_after(seg, steps, seg.done_events + seg.n_events);
+            if (k1 > k0) {
+                step_queue_add(axis, seg, steps, k0, k1, STEP_QUEUE_SPLITS);
+            }
+        }
+        block->events_expanded += seg.n_events;
+        segment->start_time = seg.start;
+        step_queue_clock    = seg.end;
+        std::atomic_thread_fence(std::memory_order_release);
+        segment_buffer_expanded = segment_buffer_expanded + 1 == SEGMENT_BUFFER_SIZE ? 0 : segment_buffer_expanded + 1;
+    }
+    xSemaphoreGive(step_queue_mutex);
+}
+
+// Keeps the step queue topped up. st_prep_buffer() wakes it for each new segment; the timeout
+// retries a segment that did not fit in the queue.
+void stepQueueTask(void* pvParameters) {
+    while (true) {
+        ulTaskNotifyTake(pdTRUE, 1);
+        st_queue_expand();
+    }
+}
+#endif
+
 // Called by realtime status reporting to fetch the current speed being executed. This value
 // however is not exactly the current speed, but the speed computed in the last step segment
 // in the segment buffer. It will always be behind by up to the number of segment blocks (-1)
@@ -938,16 +1975,19 @@ float st_get_realtime_rate() {
 }
 
 // The argument is in units of ticks of the timer that generates ISRs
-void IRAM_ATTR Stepper_Timer_WritePeriod(uint16_t timerTicks) {
+void IRAM_ATTR Stepper_Timer_WritePeriod(uint32_t timerTicks) {
     if (current_stepper == ST_I2S_STREAM) {
 #ifdef USE_I2S_STEPS
         // 1 tick = fTimers / fStepperTimer
         // Pulse ISR is called for each tick of alarm_val.
         // The argument to i2s_out_set_pulse_period is in units of microseconds
-        i2s_out_set_pulse_period(((uint32_t)timerTicks) / ticksPerMicrosecond);
+        i2s_out_set_pulse_period(timerTicks / ticksPerMicrosecond);
 #endif
     } else {
         timer_set_alarm_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, (uint64_t)timerTicks);
+#ifdef ENABLE_STEPPER_ISR_STATS
+        isr_period = timerTicks;
+#endif
     }
 }
 
@@ -963,6 +2003,13 @@ void IRAM_ATTR Stepper_Timer_Init() {
     timer_set_counter_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, 0x00000000ULL);
     timer_enable_intr(STEP_TIMER_GROUP, STEP_TIMER_INDEX);
     timer_isr_register(STEP_TIMER_GROUP, STEP_TIMER_INDEX, onStepperDriverTimer, NULL, 0, NULL);
+
+    // The pulse timer is one-shot. It is started for each phase of a step pulse.
+    config.auto_reload = false;
+    timer_init(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, &config);
+    timer_set_counter_value(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, 0x00000000ULL);
+    timer_enable_intr(STEP_TIMER_GROUP, PULSE_TIMER_INDEX);
+    timer_isr_register(STEP_TIMER_GROUP, PULSE_TIMER_INDEX, onStepperOffTimer, NULL, 0, NULL);
 }
 
 void IRAM_ATTR Stepper_Timer_Start() {
@@ -974,6 +2021,9 @@ void IRAM_ATTR Stepper_Timer_Start() {
         i2s_out_set_stepping();
 #endif
     } else {
+#ifdef ENABLE_STEPPER_ISR_STATS
+        isr_last_entry_valid = false;  // The wait for the first ISR is not a step period
+#endif
         timer_set_counter_value(STEP_TIMER_GROUP, STEP_TIMER_INDEX, 0x00000000ULL);
         timer_start(STEP_TIMER_GROUP, STEP_TIMER_INDEX);
         TIMERG0.hw_timer[STEP_TIMER_INDEX].config.alarm_en = TIMER_ALARM_EN;
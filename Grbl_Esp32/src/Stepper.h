@@ -64,11 +64,31 @@ const int ticksPerMicrosecond = fStepperTimer / 1000000;
 const uint32_t amassThreshold = fStepperTimer / 8000;
 const int maxAmassLevel = 3;  // Each level increase doubles the threshold
 
+#ifdef USE_RMT_STEPS
+// With RMT steps, evenly spaced runs of at least this many steps are sent as step trains,
+// so that the ISR does not need to run for each one.
+const int stepTrainMinSteps = 8;
+#endif
+
+#ifdef USE_STEP_QUEUE
+#    ifndef STEPPER_BATCHED_POSITION
+#        error USE_STEP_QUEUE requires STEPPER_BATCHED_POSITION
+#    endif
+// Step times in the step queue are in 1/256 of a step timer tick. A run of steps may be
+// merged into the previous run of the same axis if no step moves by more than stepQueueMaxError.
+const int      stepQueueTimeShift = 8;
+const uint32_t stepQueueMaxError  = ticksPerMicrosecond << stepQueueTimeShift;
+#endif
+
 const timer_group_t STEP_TIMER_GROUP = TIMER_GROUP_0;
 const timer_idx_t   STEP_TIMER_INDEX = TIMER_0;
 
+// One-shot timer that ends step pulses, and delays them after a direction change,
+// for the stepper types that drive the step pins directly (ST_TIMED and ST_I2S_STATIC).
+const timer_idx_t PULSE_TIMER_INDEX = TIMER_1;
+
 // esp32 work around for diable in main loop
-extern uint64_t stepper_idle_counter;
+extern int64_t  stepper_idle_counter;
 extern bool     stepper_idle;
 
 //extern uint8_t ganged_mode;
@@ -95,9 +115,16 @@ extern stepper_id_t current_stepper;
 
 // -- Task handles for use in the notifications
 void IRAM_ATTR onSteppertimer();
-void IRAM_ATTR onStepperOffTimer();
+void IRAM_ATTR onStepperOffTimer(void* para);
 
 void stepper_init();
+
+#ifdef USE_STEP_QUEUE
+// Expands new step segments into the step queue. Runs in stepQueueTask.
+void st_queue_expand();
+void stepQueueTask(void* pvParameters);
+#endif
+
 void stepper_switch(stepper_id_t new_stepper);
 
 // Enable steppers, but cycle does not start unless called by motion control or realtime command.
@@ -121,16 +148,46 @@ void st_prep_buffer();
 // Called by planner_recalculate() when the executing block is updated by the new plan.
 void st_update_plan_block_parameters();
 
+// Starts slowing down the steps already queued for output when a feed hold begins.
+void st_hold_ramp();
+
 // Called by realtime status reporting if realtime rate reporting is enabled in config.h.
 float st_get_realtime_rate();
 
+// Copies the real-time machine position in steps, as sys_position would be with every step counted.
+void st_get_position(int32_t* position);
+
 // disable (or enable) steppers via STEPPERS_DISABLE_PIN
 bool get_stepper_disable();  // returns the state of the pin
 
 void set_stepper_pins_on(uint8_t onMask);
 void set_direction_pins_on(uint8_t onMask);
 
-void Stepper_Timer_WritePeriod(uint16_t timerTicks);
+#ifdef ENABLE_STEPPER_ISR_STATS
+// Stepper ISR timing in CPU cycles. Bin n of a histogram counts values from 2^n up to
+// 2^(n+1)-1 cycles; bin 0 also counts 0 and the last bin counts everything above it.
+const int ISR_STATS_BINS = 16;
+
+struct isr_histogram_t {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+    uint32_t bins[ISR_STATS_BINS];
+};
+
+struct stepper_isr_stats_t {
+    isr_histogram_t duration;  // From ISR entry to exit
+    isr_histogram_t jitter;    // Distance of each ISR entry from where the step period put it
+    isr_histogram_t pins;      // Direction and step pin writes of each ISR
+    uint32_t        skipped;   // Interrupts that found the previous ISR still running
+};
+extern stepper_isr_stats_t stepper_isr_stats;
+
+void st_isr_stats_reset();
+#endif
+
+void Stepper_Timer_WritePeriod(uint32_t timerTicks);
 void Stepper_Timer_Init();
 void Stepper_Timer_Start();
 void Stepper_Timer_Stop();
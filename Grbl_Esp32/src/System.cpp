@@ -187,7 +187,9 @@ void system_convert_array_steps_to_mpos(float* position, int32_t* steps) {
 }
 float* system_get_mpos() {
     static float position[MAX_N_AXIS];
-    system_convert_array_steps_to_mpos(position, sys_position);
+    int32_t      steps[MAX_N_AXIS];
+    st_get_position(steps);
+    system_convert_array_steps_to_mpos(position, steps);
     return position;
 };
 
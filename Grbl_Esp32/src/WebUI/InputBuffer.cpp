@@ -27,16 +27,19 @@ namespace WebUI {
     InputBuffer::InputBuffer() {
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
+        _RXlines      = 0;
     }
 
     void InputBuffer::begin() {
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
+        _RXlines      = 0;
     }
 
     void InputBuffer::end() {
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
+        _RXlines      = 0;
     }
 
     InputBuffer::operator bool() const { return true; }
@@ -57,6 +60,9 @@ namespace WebUI {
             _RXbuffer[current] = c;
             current++;
             _RXbufferSize += 1;
+            if (is_eol(c)) {
+                _RXlines++;
+            }
             return 1;
         }
         return 0;
@@ -89,6 +95,9 @@ namespace WebUI {
                 }
                 _RXbuffer[current] = data[i];
                 current++;
+                if (is_eol(data[i])) {
+                    _RXlines++;
+                }
             }
             _RXbufferSize += strlen(data);
             return true;
@@ -104,12 +113,66 @@ namespace WebUI {
                 _RXbufferpos = 0;
             }
             _RXbufferSize--;
+            if (is_eol(v)) {
+                _RXlines--;
+            }
             return v;
         } else {
             return -1;
         }
     }
 
+    // Returns the first line in the buffer, where it is, with its end of line character replaced
+    // by NUL, and sets size to its length including that character. The line stays in the buffer,
+    // so that writes cannot overwrite it, until release_line() is called with size. Returns NULL
+    // with size set to zero if there is no complete line yet. Returns NULL with size set to the
+    // buffered byte count if the line has to be read() a character at a time instead: when it wraps
+    // around the end of the buffer, holds a backspace or is max_size bytes or longer, or when the
+    // buffer is full without a line.
+    char* InputBuffer::line(size_t* size, size_t max_size) {
+        *size = 0;
+        if (_RXlines == 0) {
+            if (_RXbufferSize == RXBUFFERSIZE) {
+                *size = _RXbufferSize;
+            }
+            return NULL;
+        }
+        uint8_t* start      = &_RXbuffer[_RXbufferpos];
+        size_t   contiguous = RXBUFFERSIZE - _RXbufferpos;
+        if (contiguous > _RXbufferSize) {
+            contiguous = _RXbufferSize;
+        }
+        if (contiguous > max_size) {
+            contiguous = max_size;
+        }
+        for (size_t len = 0; len < contiguous; len++) {
+            uint8_t c = start[len];
+            if (is_eol(c)) {
+                start[len] = '\0';
+                *size      = len + 1;
+                return (char*)start;
+            }
+            if (c == '\b') {
+                break;
+            }
+        }
+        *size = _RXbufferSize;
+        return NULL;
+    }
+
+    // Drops the line returned by line() from the buffer.
+    void InputBuffer::release_line(size_t size) {
+        if (size > _RXbufferSize) {
+            return;  // The buffer was reset in the meantime.
+        }
+        _RXbufferpos += size;
+        if (_RXbufferpos > (RXBUFFERSIZE - 1)) {
+            _RXbufferpos -= RXBUFFERSIZE;
+        }
+        _RXbufferSize -= size;
+        _RXlines--;
+    }
+
     void InputBuffer::flush(void) {
         //No need currently
         //keep for compatibility
@@ -118,5 +181,6 @@ namespace WebUI {
     InputBuffer::~InputBuffer() {
         _RXbufferSize = 0;
         _RXbufferpos  = 0;
+        _RXlines      = 0;
     }
 }
@@ -43,6 +43,8 @@ namespace WebUI {
         int           read(void);
         bool          push(const char* data);
         void          flush(void);
+        char*         line(size_t* size, size_t max_size);
+        void          release_line(size_t size);
 
         operator bool() const;
 
@@ -54,6 +56,9 @@ namespace WebUI {
         uint8_t  _RXbuffer[RXBUFFERSIZE];
         uint16_t _RXbufferSize;
         uint16_t _RXbufferpos;
+        uint16_t _RXlines;  // End of line characters in the buffer
+
+        static bool is_eol(uint8_t c) { return c == '\r' || c == '\n'; }
     };
 
     extern InputBuffer inputBuffer;
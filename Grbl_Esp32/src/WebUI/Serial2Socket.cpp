@@ -117,16 +117,18 @@ namespace WebUI {
         }
     }
 
-    bool Serial_2_Socket::push(const char* data) {
+    bool Serial_2_Socket::push(const char* data) { return push((const uint8_t*)data, strlen(data)); }
+
+    // Binary data, such as the frames of the binary stream, is pushed as it is.
+    bool Serial_2_Socket::push(const uint8_t* data, size_t data_size) {
 #    if defined(ENABLE_SERIAL2SOCKET_IN)
-        int data_size = strlen(data);
         if ((data_size + _RXbufferSize) <= RXBUFFERSIZE) {
             int current = _RXbufferpos + _RXbufferSize;
             if (current > RXBUFFERSIZE) {
                 current = current - RXBUFFERSIZE;
             }
 
-            for (int i = 0; i < data_size; i++) {
+            for (size_t i = 0; i < data_size; i++) {
                 if (current > (RXBUFFERSIZE - 1)) {
                     current = 0;
                 }
@@ -134,7 +136,7 @@ namespace WebUI {
                 current++;
             }
 
-            _RXbufferSize += strlen(data);
+            _RXbufferSize += data_size;
             return true;
         }
         return false;
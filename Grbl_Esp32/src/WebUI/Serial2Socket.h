@@ -50,6 +50,7 @@ namespace WebUI {
         int  peek(void);
         int  read(void);
         bool push(const char* data);
+        bool push(const uint8_t* data, size_t data_size);
         void flush(void);
         void handle_flush();
         bool attachWS(WebSocketsServer* web_socket);
@@ -1595,9 +1595,11 @@ namespace WebUI {
             case WStype_BIN:
                 //USE_SERIAL.printf("[%u] get binary length: %u\n", num, length);
                 //hexdump(payload, length);
-
-                // send message to client
-                // webSocket.sendBIN(num, payload, length);
+#    if defined(ENABLE_SERIAL2SOCKET_IN) && defined(ENABLE_BINARY_STREAM)
+                // Frames of the binary stream. A message that does not fit is lost, and resent
+                // by the sender when the frame is not acknowledged.
+                Serial2Socket.push(payload, length);
+#    endif
                 break;
             default:
                 break;
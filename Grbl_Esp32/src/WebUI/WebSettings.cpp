@@ -673,7 +673,7 @@ namespace WebUI {
     }
 
 #ifdef ENABLE_SD_CARD
-    static Error openSDFile(char* parameter) {
+    static Error openSDFile(char* parameter, bool compiled = false) {
         if (*parameter == '\0') {
             webPrintln("Missing file name!");
             return Error::InvalidValue;
@@ -682,6 +682,9 @@ namespace WebUI {
         if (path[0] != '/') {
             path = "/" + path;
         }
+        if (compiled) {
+            path = sd_compiled_path(path);
+        }
         SDState state = get_sd_state(true);
         if (state != SDState::Idle) {
             if (state == SDState::NotPresent) {
@@ -727,9 +730,30 @@ namespace WebUI {
             webPrintln("Busy");
             return Error::IdleError;
         }
+        // <Filename>,line=<N> resumes the file from line N
+        int   line  = 1;
+        char* comma = strrchr(parameter, ',');
+        if (comma && strncasecmp(comma + 1, "line=", 5) == 0) {
+            line = atoi(comma + 6);
+            if (line < 1) {
+                webPrintln("Invalid line number!");
+                return Error::InvalidValue;
+            }
+            *comma = '\0';
+        }
         if ((err = openSDFile(parameter)) != Error::Ok) {
             return err;
         }
+        SD_client     = (espresponse) ? espresponse->client() : CLIENT_ALL;
+        SD_auth_level = auth_level;
+        if (line > 1) {
+            if ((err = resumeFile(SD, line)) != Error::Ok) {
+                closeFile();
+            }
+            webPrintln("");
+            return err;
+        }
+        beginIndex(SD, false);
         char fileLine[255];
         if (!readFileLine(fileLine, 255)) {
             //No need notification here it is just a macro
@@ -737,8 +761,6 @@ namespace WebUI {
             webPrintln("");
             return Error::Ok;
         }
-        SD_client     = (espresponse) ? espresponse->client() : CLIENT_ALL;
-        SD_auth_level = auth_level;
         // execute the first line now; Protocol.cpp handles later ones when SD_ready_next
         report_status_message(execute_line(fileLine, SD_client, SD_auth_level), SD_client);
         report_realtime_status(SD_client);
@@ -746,6 +768,62 @@ namespace WebUI {
         return Error::Ok;
     }
 
+    static Error compileSDFile(char* parameter, AuthenticationLevel auth_level) {  // ESP222
+        if (sys.state != State::Idle) {
+            webPrintln((sys.state == State::Alarm) ? "Alarm" : "Busy");
+            return Error::IdleError;
+        }
+        Error err;
+        if ((err = openSDFile(parameter)) != Error::Ok) {
+            return err;
+        }
+        SD_client = (espresponse) ? espresponse->client() : CLIENT_ALL;
+        err       = compileFile(SD);
+        closeFile();
+        webPrintln("");
+        return err;
+    }
+
+    static Error indexSDFile(char* parameter, AuthenticationLevel auth_level) {  // ESP224
+        if (sys.state != State::Idle) {
+            webPrintln((sys.state == State::Alarm) ? "Alarm" : "Busy");
+            return Error::IdleError;
+        }
+        Error err;
+        if ((err = openSDFile(parameter)) != Error::Ok) {
+            return err;
+        }
+        SD_client = (espresponse) ? espresponse->client() : CLIENT_ALL;
+        err       = indexFile(SD);
+        closeFile();
+        webPrintln("");
+        return err;
+    }
+
+    static Error runCompiledSDFile(char* parameter, AuthenticationLevel auth_level) {  // ESP223
+        Error err;
+        if (sys.state == State::Alarm) {
+            webPrintln("Alarm");
+            return Error::IdleError;
+        }
+        if (sys.state != State::Idle) {
+            webPrintln("Busy");
+            return Error::IdleError;
+        }
+        if ((err = openSDFile(parameter, true)) != Error::Ok) {
+            return err;
+        }
+        if ((err = readCompiledHeader()) != Error::Ok) {
+            closeFile();
+            return err;
+        }
+        SD_client     = (espresponse) ? espresponse->client() : CLIENT_ALL;
+        SD_auth_level = auth_level;
+        SD_ready_next = true;  // Protocol.cpp runs the job from its first record
+        webPrintln("");
+        return Error::Ok;
+    }
+
     static Error deleteSDObject(char* parameter, AuthenticationLevel auth_level) {  // ESP215
         parameter = trim(parameter);
         if (*parameter == '\0') {
@@ -1079,8 +1157,11 @@ namespace WebUI {
         new WebCommand(NULL, WEBCMD, WU, "ESP400", "WebUI/List", listSettings, anyState);
 #endif
 #ifdef ENABLE_SD_CARD
+        new WebCommand("path", WEBCMD, WU, "ESP224", "SD/Index", indexSDFile);
+        new WebCommand("path", WEBCMD, WU, "ESP223", "SD/RunCompiled", runCompiledSDFile);
+        new WebCommand("path", WEBCMD, WU, "ESP222", "SD/Compile", compileSDFile);
         new WebCommand("path", WEBCMD, WU, "ESP221", "SD/Show", showSDFile);
-        new WebCommand("path", WEBCMD, WU, "ESP220", "SD/Run", runSDFile);
+        new WebCommand("path[,line=N]", WEBCMD, WU, "ESP220", "SD/Run", runSDFile);
         new WebCommand("file_or_directory_path", WEBCMD, WU, "ESP215", "SD/Delete", deleteSDObject);
         new WebCommand(NULL, WEBCMD, WU, "ESP210", "SD/List", listSDFiles);
 #endif
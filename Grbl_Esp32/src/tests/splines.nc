@@ -0,0 +1,14 @@
+(G5 cubic and G5.1 quadratic splines)
+G21 G90 G94 G17
+G0 X0 Y0 Z0
+G5 X40 Y0 I10 J30 P-10 Q30 F3000
+(No I/J: continue along the end direction of the previous G5)
+G5 X80 Y0 P-10 Q-30
+G5.1 X100 Y20 I20 J0
+(Z moves along with the curve)
+G5 X60 Y40 Z-2 I0 J10 P20 Q0
+G93 G5 X20 Y20 I-10 J0 P10 Q0 F6
+G94 F2000
+G20 G5 X0 Y0 I-0.2 J0 P0.2 Q0.2
+G21 G0 Z0
+M2
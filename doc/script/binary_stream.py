@@ -0,0 +1,417 @@
+#!/usr/bin/env python3
+"""\
+
+Stream g-code to Grbl_ESP32 in its binary motion format
+
+G0 and G1 lines with only axis, F, S and N words are parsed here and
+sent as binary records: absolute work coordinates in steps of 0.1 um,
+the feed rate, spindle speed and line number. Grbl plans them without
+reading any text. All other lines are sent as text records, and Grbl
+parses them as usual. Records are packed into frames with a CRC and a
+sequence number, and up to the window of frames Grbl asks for is in
+flight. A frame that Grbl rejects is resent, and the frames after it.
+
+The protocol is described in Grbl_Esp32/src/Serial.cpp. The firmware
+must be built with ENABLE_BINARY_STREAM.
+
+The streamer follows the modal state of the program to know which lines
+it can parse: the motion mode, G90/G91, G20/G21 and G93/G94. A text line
+that Grbl rejects can leave Grbl in a different state, so errors are
+reported with their line in the file, and a program with errors should
+be checked (-c) before it is run.
+
+Devices:
+  /dev/ttyUSB0          serial port (pySerial required)
+  192.168.0.1:23        Telnet
+  ws://192.168.0.1:81   WebSocket (websocket-client required)
+
+---------------------
+The MIT License (MIT)
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+---------------------
+"""
+
+import argparse
+import re
+import socket
+import struct
+import sys
+import time
+
+BAUD_RATE = 115200
+BINARY_STREAM = b'\x88'  # Cmd::BinaryStream
+SYNC = 0xA5
+FRAME_RECORDS = ord('R')
+FRAME_END = ord('E')
+
+# Record flags, see Grbl_Esp32/src/Protocol.cpp
+RECORD_LINEAR = 0
+RECORD_SEEK = 1
+RECORD_TEXT = 2
+RECORD_HAS_LINE = 0x04
+RECORD_HAS_FEED = 0x08
+RECORD_HAS_SPINDLE = 0x10
+
+AXES = 'XYZABC'
+MM_PER_INCH = 25.4
+STEPS_PER_MM = 10000
+
+WORD = re.compile(r'([A-Z])([-+]?(?:\d+\.?\d*|\.\d+))')
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE"""
+    crc = 0xFFFF
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+        crc &= 0xFFFF
+    return crc
+
+
+def frame(kind, seq, payload):
+    body = bytes([kind, seq, len(payload)]) + payload
+    return bytes([SYNC]) + body + struct.pack('<H', crc16(body))
+
+
+def float32(value):
+    return struct.unpack('<f', struct.pack('<f', value))[0]
+
+
+class Modal:
+    """The modal state the streamer needs to know which lines it can parse"""
+
+    def __init__(self):
+        self.motion = 0.0
+        self.absolute = True
+        self.inches = False
+        self.inverse_time = False
+
+    def update(self, words):
+        for letter, value in words:
+            if letter == 'G':
+                if value in (0, 1, 2, 3, 5, 5.1, 38.2, 38.3, 38.4, 38.5, 80):
+                    self.motion = value
+                elif value in (90, 91):
+                    self.absolute = value == 90
+                elif value in (20, 21):
+                    self.inches = value == 20
+                elif value in (93, 94):
+                    self.inverse_time = value == 93
+            elif letter == 'M' and value in (2, 30):
+                self.motion = 1
+                self.absolute = True
+                self.inverse_time = False
+
+
+def text_record(text):
+    data = text.encode('ascii', 'replace')
+    if len(data) > 253:
+        raise ValueError('line too long')
+    return bytes([RECORD_TEXT, len(data)]) + data
+
+
+def motion_record(words, modal):
+    """Returns the record of a G0 or G1 line, or None if the line must be sent as text"""
+    letters = [letter for letter, value in words]
+    if len(set(letters)) != len(letters):
+        return None  # Repeated words are Grbl's to report
+    values = dict(words)
+    if 'G' in values:
+        if values['G'] not in (0, 1):
+            return None
+        motion = values['G']
+    else:
+        motion = modal.motion
+    if motion not in (0, 1) or not modal.absolute or modal.inverse_time:
+        return None
+    if any(letter not in AXES + 'FSNG' for letter in letters):
+        return None
+    if not any(letter in AXES for letter in letters):
+        return None
+    flags = RECORD_SEEK if motion == 0 else RECORD_LINEAR
+    body = b''
+    if 'N' in values:
+        if values['N'] != int(values['N']) or not 0 <= values['N'] < 2**31:
+            return None
+        flags |= RECORD_HAS_LINE
+        body += struct.pack('<i', int(values['N']))
+    if 'F' in values:
+        if values['F'] < 0:
+            return None
+        feed = float32(values['F'])
+        if modal.inches:
+            feed *= MM_PER_INCH  # As Grbl scales the float it read
+        flags |= RECORD_HAS_FEED
+        body += struct.pack('<f', feed)
+    if 'S' in values:
+        if values['S'] < 0:
+            return None
+        flags |= RECORD_HAS_SPINDLE
+        body += struct.pack('<f', values['S'])
+    mask = 0
+    for idx, letter in enumerate(AXES):
+        if letter in values:
+            mm = values[letter] * MM_PER_INCH if modal.inches else values[letter]
+            steps = int(round(mm * STEPS_PER_MM))
+            if not -2**31 <= steps < 2**31:
+                return None
+            mask |= 1 << idx
+            body += struct.pack('<i', steps)
+    return bytes([flags, mask]) + body
+
+
+def records(lines):
+    """Yields the record of each line of the program, with the line's number in the file"""
+    modal = Modal()
+    for number, line in enumerate(lines, 1):
+        text = line.strip()
+        if not text:
+            continue
+        if text[0] in '$[':
+            yield number, text_record(text)
+            continue
+        block = re.sub(r'\s|\(.*?\)|;.*', '', text).upper()
+        words = [(letter, float(value)) for letter, value in WORD.findall(block)]
+        record = None
+        if ''.join(letter + value for letter, value in WORD.findall(block)) == block:
+            record = motion_record(words, modal)
+        modal.update(words)
+        yield number, record if record is not None else text_record(text)
+
+
+def frames(lines, max_payload):
+    """Packs records into frame payloads. Yields the payload and the line numbers of its records."""
+    payload, numbers = b'', []
+    for number, record in records(lines):
+        if len(payload) + len(record) > max_payload:
+            yield payload, numbers
+            payload, numbers = b'', []
+        payload += record
+        numbers.append(number)
+    if payload:
+        yield payload, numbers
+
+
+class SerialLink:
+    def __init__(self, device):
+        import serial
+        self.port = serial.Serial(device, BAUD_RATE, timeout=0.1)
+
+    def write(self, data):
+        self.port.write(data)
+
+    def read(self):
+        return self.port.read(self.port.in_waiting or 1)
+
+
+class TelnetLink:
+    def __init__(self, address):
+        host, port = address.rsplit(':', 1)
+        self.sock = socket.create_connection((host, int(port)))
+        self.sock.settimeout(0.1)
+
+    def write(self, data):
+        self.sock.sendall(data)
+
+    def read(self):
+        try:
+            return self.sock.recv(4096)
+        except socket.timeout:
+            return b''
+
+
+class WebSocketLink:
+    def __init__(self, url):
+        import websocket
+        self.ws = websocket.create_connection(url)
+        self.ws.settimeout(0.1)
+        self.timeout_error = websocket.WebSocketTimeoutException
+
+    def write(self, data):
+        # A frame per message, as stream() writes them
+        self.ws.send_binary(data)
+
+    def read(self):
+        try:
+            message = self.ws.recv()
+        except self.timeout_error:
+            return b''
+        return message.encode() if isinstance(message, str) else b''
+
+
+class Lines:
+    """Splits what Grbl sends into lines"""
+
+    def __init__(self, link):
+        self.link = link
+        self.buffer = b''
+
+    def readline(self, timeout):
+        end = time.time() + timeout
+        while b'\n' not in self.buffer:
+            if time.time() > end:
+                return None
+            self.buffer += self.link.read()
+        line, self.buffer = self.buffer.split(b'\n', 1)
+        return line.decode('ascii', 'replace').strip()
+
+
+def open_link(device):
+    if device.startswith('ws://'):
+        return WebSocketLink(device)
+    if re.match(r'^[\w.-]+:\d+$', device):
+        return TelnetLink(device)
+    return SerialLink(device)
+
+
+def command(link, lines, text, verbose):
+    """Sends a line in text mode and waits for its reply"""
+    link.write(text.encode() + b'\n')
+    while True:
+        reply = lines.readline(10)
+        if reply is None:
+            sys.exit('No reply to ' + text)
+        if verbose:
+            print('REC: ' + reply)
+        if reply.startswith('ok') or reply.startswith('error'):
+            return reply
+
+
+def stream(link, lines, program, window, max_payload, timeout, verbose):
+    """Streams the frames with a sliding window. Returns the number of errors."""
+    pending = frames(program, max_payload)
+    unacked = []  # (seq, frame bytes, line numbers), oldest first
+    seq = 0
+    done = False
+    errors = 0
+    progress = time.time()
+    while not done or unacked:
+        while not done and len(unacked) < window:
+            item = next(pending, None)
+            if item is None:
+                data, numbers, done = frame(FRAME_END, seq, b''), [], True
+            else:
+                data, numbers = frame(FRAME_RECORDS, seq, item[0]), item[1]
+            unacked.append((seq, data, numbers))
+            link.write(data)
+            seq = (seq + 1) & 0xFF
+        reply = lines.readline(0.5)
+        if reply is None:
+            if time.time() - progress > timeout:
+                # Resend, in case frames or their ACKs were lost. Grbl drops the copies it has.
+                for _, data, _ in unacked:
+                    link.write(data)
+                progress = time.time()
+            continue
+        match = re.match(r'\[(ACK|NAK|ERR):(\d+)(?:,(\d+),(\d+))?\]', reply)
+        if not match:
+            if verbose:
+                print('MSG: ' + reply)
+            continue
+        kind, frame_seq = match.group(1), int(match.group(2))
+        if kind == 'ACK':
+            # ACKs are cumulative
+            if any(s == frame_seq for s, _, _ in unacked):
+                while unacked:
+                    acked = unacked.pop(0)[0]
+                    if acked == frame_seq:
+                        break
+                progress = time.time()
+        elif kind == 'NAK':
+            resend = False
+            for s, data, _ in unacked:
+                resend = resend or s == frame_seq
+                if resend:
+                    link.write(data)
+            progress = time.time()
+        else:
+            errors += 1
+            line = '?'
+            for s, _, numbers in unacked:
+                if s == frame_seq and int(match.group(3)) < len(numbers):
+                    line = numbers[int(match.group(3))]
+            print('error:%s at line %s' % (match.group(4), line))
+    return errors
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Stream g-code to Grbl_ESP32 as binary motion records.')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'), help='g-code filename to be streamed')
+    parser.add_argument('device', nargs='?', help='serial device path, host:port for Telnet, or ws://host:port')
+    parser.add_argument('-q', '--quiet', action='store_true', default=False, help='suppress output text')
+    parser.add_argument('-c', '--check', action='store_true', default=False, help='stream in check mode')
+    parser.add_argument('-t', '--timeout', type=float, default=10.0,
+                        help='seconds without an ACK before the frames in flight are resent')
+    parser.add_argument('-d', '--dump', type=argparse.FileType('wb'),
+                        help='write the frames to a file instead of streaming them')
+    args = parser.parse_args()
+    verbose = not args.quiet
+    program = args.gcode_file.readlines()
+
+    if args.dump:
+        seq = 0
+        for payload, _ in frames(program, 255):
+            args.dump.write(frame(FRAME_RECORDS, seq, payload))
+            seq = (seq + 1) & 0xFF
+        args.dump.write(frame(FRAME_END, seq, b''))
+        return
+    if not args.device:
+        parser.error('a device is required unless --dump is given')
+
+    link = open_link(args.device)
+    lines = Lines(link)
+    print('Initializing Grbl...')
+    link.write(b'\r\n\r\n')
+    time.sleep(2)
+    while lines.readline(0.2) is not None:
+        pass
+    if args.check and command(link, lines, '$C', verbose).startswith('error'):
+        sys.exit('Failed to set Grbl check-mode. Aborting...')
+
+    link.write(BINARY_STREAM)
+    while True:
+        reply = lines.readline(5)
+        if reply is None:
+            sys.exit('No reply to the binary stream command. Is ENABLE_BINARY_STREAM enabled?')
+        match = re.match(r'\[BIN:(\d+),(\d+)\]', reply)
+        if match:
+            break
+    window, max_payload = int(match.group(1)), int(match.group(2))
+    if window == 0:
+        sys.exit('Grbl is busy with another client or an SD card job')
+
+    start_time = time.time()
+    errors = stream(link, lines, program, window, max_payload, args.timeout, verbose)
+    print('\nG-code streaming finished!')
+    print(' Time elapsed: %.1f s' % (time.time() - start_time))
+    if args.check:
+        if errors:
+            print('CHECK FAILED: %d errors found! See output for details.' % errors)
+        else:
+            print('CHECK PASSED: No errors found in g-code program.')
+        command(link, lines, '$C', verbose)
+    elif errors:
+        print('%d errors. See output for details.' % errors)
+
+
+if __name__ == '__main__':
+    main()